@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+/// Page alignment satisfying CL_DEVICE_MEM_BASE_ADDR_ALIGN of common devices
+inline constexpr std::size_t DEFAULT_HOST_ALIGNMENT = 4096U;
+
+/// Allocator returning memory aligned to Alignment bytes.
+/// Buffers allocated with it can be wrapped by CL_MEM_USE_HOST_PTR
+/// without the runtime falling back to a shadow copy.
+/// @tparam T Element type
+/// @tparam Alignment Alignment in bytes, power of two
+template <typename T, std::size_t Alignment = DEFAULT_HOST_ALIGNMENT>
+struct AlignedAllocator
+{
+    using value_type = T;
+
+    static_assert((Alignment & (Alignment - 1)) == 0, "Alignment must be a power of two");
+
+    template <typename U>
+    struct rebind { using other = AlignedAllocator<U, Alignment>; };
+
+    AlignedAllocator() noexcept = default;
+
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {}
+
+    T* allocate(std::size_t n)
+    {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t{Alignment}));
+    }
+
+    void deallocate(T* p, std::size_t) noexcept
+    {
+        ::operator delete(p, std::align_val_t{Alignment});
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept { return true; }
+};
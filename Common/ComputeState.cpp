@@ -1,8 +1,115 @@
 #include "ComputeState.h"
+#include "CTimer.h"
 #include <iostream>
 #include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <limits>
 #include <CL/Utils/Error.hpp>
 
+namespace {
+
+std::string toLower(std::string text)
+{
+    std::transform(text.begin(), text.end(), text.begin(),
+        [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return text;
+}
+
+bool isIndex(const std::string& text)
+{
+    return !text.empty() && std::all_of(text.begin(), text.end(),
+        [](unsigned char c) { return std::isdigit(c) != 0; });
+}
+
+/// Applies a single option of the selection, returns false if the value is invalid
+bool applyOption(DeviceSelection& selection, const std::string& option, const std::string& value)
+{
+    if (option == "type") {
+        const auto type = toLower(value);
+        if (type == "gpu") {
+            selection.type = CL_DEVICE_TYPE_GPU;
+        } else if (type == "cpu") {
+            selection.type = CL_DEVICE_TYPE_CPU;
+        } else if (type == "accelerator") {
+            selection.type = CL_DEVICE_TYPE_ACCELERATOR;
+        } else if (type == "all") {
+            selection.type = CL_DEVICE_TYPE_ALL;
+        } else {
+            return false;
+        }
+    } else if (option == "platform") {
+        selection.platform = value;
+    } else if (option == "device") {
+        if (toLower(value) == "auto") {
+            selection.automatic = true;
+        } else if (isIndex(value)) {
+            selection.deviceIndex = std::stoull(value);
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Benchmark kernel, a streaming multiply-add as found in every sort pass
+const char* BENCHMARK_SOURCE = R"(
+__kernel void stream(__global const uint* in, __global uint* out)
+{
+    const size_t i = get_global_id(0);
+    out[i] = in[i] * 2654435761u + 1u;
+}
+)";
+
+} // namespace
+
+DeviceSelection DeviceSelection::FromEnvironment()
+{
+    DeviceSelection selection;
+    const std::pair<const char*, const char*> variables[] = {
+        {"RADIXSORT_DEVICE_TYPE", "type"},
+        {"RADIXSORT_PLATFORM", "platform"},
+        {"RADIXSORT_DEVICE", "device"},
+    };
+    for (const auto& [variable, option] : variables) {
+        if (const char* value = std::getenv(variable)) {
+            if (!applyOption(selection, option, value)) {
+                std::cerr << "Ignoring invalid " << variable << "=" << value << "\n";
+            }
+        }
+    }
+    return selection;
+}
+
+DeviceSelection DeviceSelection::FromArguments(std::vector<std::string>& args)
+{
+    auto selection = FromEnvironment();
+    std::vector<std::string> remaining;
+    for (std::size_t i = 0; i < args.size(); i++) {
+        const auto& arg = args[i];
+        const auto hasValue = i + 1 < args.size();
+        if (arg == "--device-type" && hasValue) {
+            if (!applyOption(selection, "type", args[++i])) {
+                std::cerr << "Ignoring invalid device type " << args[i] << "\n";
+            }
+        } else if (arg == "--platform" && hasValue) {
+            applyOption(selection, "platform", args[++i]);
+        } else if (arg == "--device" && hasValue) {
+            if (!applyOption(selection, "device", args[++i])) {
+                std::cerr << "Ignoring invalid device " << args[i] << "\n";
+            }
+        } else if (arg == "--profiling") {
+            selection.queueProperties |= CL_QUEUE_PROFILING_ENABLE;
+        } else if (arg == "--out-of-order") {
+            selection.queueProperties |= CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE;
+        } else {
+            remaining.push_back(arg);
+        }
+    }
+    args = std::move(remaining);
+    return selection;
+}
+
 cl::Platform ComputeState::platform() {
     return cl::Platform(device().getInfo<CL_DEVICE_PLATFORM>());
 }
@@ -11,7 +118,46 @@ cl::Device ComputeState::device() {
     return m_CLDevices.front();
 }
 
-bool ComputeState::init() {
+double ComputeState::BenchmarkDevice(cl::Device Device)
+{
+    constexpr std::size_t numElements = 1U << 22U;
+    constexpr int numRuns = 4;
+    try {
+        cl::Context context(Device);
+        cl::CommandQueue queue(context, Device);
+        cl::Program program(context, BENCHMARK_SOURCE);
+        program.build(Device);
+        cl::Kernel kernel(program, "stream");
+
+        std::vector<cl_uint> host(numElements, 1U);
+        const auto sizeBytes = sizeof(cl_uint) * numElements;
+        cl::Buffer in(context, CL_MEM_READ_WRITE, sizeBytes);
+        cl::Buffer out(context, CL_MEM_READ_WRITE, sizeBytes);
+        kernel.setArg(0, in);
+        kernel.setArg(1, out);
+
+        // The first launch pays for lazy allocation and kernel upload
+        queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(numElements), cl::NullRange);
+        queue.finish();
+
+        CTimer timer;
+        timer.Start();
+        queue.enqueueWriteBuffer(in, CL_FALSE, 0, sizeBytes, host.data());
+        for (int run = 0; run < numRuns; run++) {
+            kernel.setArg(0, run % 2 == 0 ? in : out);
+            kernel.setArg(1, run % 2 == 0 ? out : in);
+            queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(numElements), cl::NullRange);
+        }
+        queue.enqueueReadBuffer(in, CL_TRUE, 0, sizeBytes, host.data());
+        timer.Stop();
+        return timer.GetElapsedMilliseconds();
+    } catch (const cl::Error& e) {
+        std::cerr << "Benchmark failed on " << Device.getInfo<CL_DEVICE_NAME>() << ": " << e.what() << "\n";
+        return std::numeric_limits<double>::infinity();
+    }
+}
+
+bool ComputeState::init(const DeviceSelection& selection) {
 	//////////////////////////////////////////////////////
     {
         cl_int clError{-1};
@@ -22,18 +168,38 @@ bool ComputeState::init() {
             return false;
         }
 
-        // 2. find all available GPU devices
-        cl_device_type deviceType = CL_DEVICE_TYPE_GPU;
-
-        for (auto platform : m_CLPlatforms)
-        {
-            try {
-                decltype(m_CLDevices) devices;
-                platform.getDevices(deviceType, &devices);
-                std::copy(std::begin(devices), std::end(devices), std::back_inserter(m_CLDevices));
-            } catch (const cl::Error&) {
-                // Platform has no GPU devices — skip it.
+        // 2. find all available devices of the selected type on the selected platforms
+        const auto platformMatches = [&](std::size_t index, const cl::Platform& platform) {
+            if (selection.platform.empty()) {
+                return true;
             }
+            if (isIndex(selection.platform)) {
+                return index == std::stoull(selection.platform);
+            }
+            return toLower(platform.getInfo<CL_PLATFORM_NAME>()).find(toLower(selection.platform)) != std::string::npos;
+        };
+        const auto collectDevices = [&](cl_device_type deviceType) {
+            for (std::size_t index = 0; index < m_CLPlatforms.size(); index++)
+            {
+                const auto& platform = m_CLPlatforms[index];
+                if (!platformMatches(index, platform)) {
+                    continue;
+                }
+                try {
+                    decltype(m_CLDevices) devices;
+                    platform.getDevices(deviceType, &devices);
+                    std::copy(std::begin(devices), std::end(devices), std::back_inserter(m_CLDevices));
+                } catch (const cl::Error&) {
+                    // Platform has no devices of this type — skip it.
+                }
+            }
+        };
+
+        m_CLDevices.clear();
+        collectDevices(selection.type.value_or(CL_DEVICE_TYPE_GPU));
+        // Without an explicit type, CPU and accelerator runtimes serve GPU-less hosts
+        if (m_CLDevices.empty() && !selection.type) {
+            collectDevices(CL_DEVICE_TYPE_ALL);
         }
     }
 
@@ -43,6 +209,28 @@ bool ComputeState::init() {
 		return false;
 	}
 
+    // 3. narrow the candidates down to a single device if requested
+    if (selection.deviceIndex) {
+        if (*selection.deviceIndex >= m_CLDevices.size()) {
+            std::cerr << "Device index " << *selection.deviceIndex << " is out of range, "
+                      << m_CLDevices.size() << " devices were found.\n";
+            return false;
+        }
+        m_CLDevices = {m_CLDevices[*selection.deviceIndex]};
+    } else if (selection.automatic) {
+        auto best = m_CLDevices.front();
+        auto bestTime = std::numeric_limits<double>::infinity();
+        for (const auto& candidate : m_CLDevices) {
+            const auto time = BenchmarkDevice(candidate);
+            std::cout << "Benchmark " << candidate.getInfo<CL_DEVICE_NAME>() << ": " << time << " ms\n";
+            if (time < bestTime) {
+                best = candidate;
+                bestTime = time;
+            }
+        }
+        m_CLDevices = {best};
+    }
+
 	// Printing platform and device data.
     {
         auto plat = platform();
@@ -68,8 +256,16 @@ bool ComputeState::init() {
         const auto callback = nullptr;
         const auto userData = nullptr;
 
+        // The context spans every collected device of the selected platform,
+        // so that multi-device sorts can share it
+        std::vector<cl::Device> contextDevices;
+        std::copy_if(std::begin(m_CLDevices), std::end(m_CLDevices), std::back_inserter(contextDevices),
+            [platformId = platform()()](const cl::Device& dev) {
+                return cl::Platform(dev.getInfo<CL_DEVICE_PLATFORM>())() == platformId;
+            });
+
         m_CLContext = cl::Context(
-            device(),
+            contextDevices,
             properties,
             callback,
             userData,
@@ -87,7 +283,12 @@ bool ComputeState::init() {
 
     {
         cl_int clError{-1};
-        const auto properties = 0;
+        // Drop optional properties the device does not support, e.g. out-of-order execution
+        const auto supported = device().getInfo<CL_DEVICE_QUEUE_PROPERTIES>();
+        const auto properties = selection.queueProperties & supported;
+        if (properties != selection.queueProperties) {
+            std::cerr << "Ignoring unsupported command queue properties " << (selection.queueProperties & ~supported) << "\n";
+        }
         m_CLCommandQueue = cl::CommandQueue(
                 m_CLContext,
                 device(),
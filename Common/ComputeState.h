@@ -1,6 +1,44 @@
+#pragma once
+
+#include <optional>
+#include <string>
 #include <vector>
 #include <CL/opencl.hpp>
 
+/**
+ * Which OpenCL device ComputeState::init picks.
+ *
+ * Environment variables:
+ *   RADIXSORT_DEVICE_TYPE  gpu, cpu, accelerator or all
+ *   RADIXSORT_PLATFORM     platform index or part of its name, e.g. pocl
+ *   RADIXSORT_DEVICE       device index among the candidates, or auto
+ *
+ * Command-line arguments of the same meaning:
+ *   --device-type <type> --platform <index|name> --device <index|auto>
+ *   --profiling --out-of-order
+ */
+struct DeviceSelection
+{
+    /// Accepted device types, GPUs with fallback to any other device if unset
+    std::optional<cl_device_type> type;
+    /// Platform index or case-insensitive part of its name, all platforms if empty
+    std::string platform;
+    /// Index among the candidate devices, all candidates of the first platform if unset
+    std::optional<std::size_t> deviceIndex;
+    /// Benchmarks every candidate and selects the fastest
+    bool automatic{false};
+    /// Properties of the command queue, unsupported ones are dropped
+    cl_command_queue_properties queueProperties{0};
+
+    /// Reads the selection from the environment
+    static DeviceSelection FromEnvironment();
+
+    /// Reads the selection from command-line arguments and removes them,
+    /// arguments take precedence over the environment
+    /// @param[in,out] args Arguments, recognized ones are consumed
+    static DeviceSelection FromArguments(std::vector<std::string>& args);
+};
+
 /**
  * Should exist only once
  */
@@ -9,11 +47,15 @@ struct ComputeState
     ComputeState() = default;
     ~ComputeState() = default;
 
-    bool init();
+    bool init(const DeviceSelection& selection = DeviceSelection::FromEnvironment());
 
     cl::Platform platform();
     cl::Device device();
 
+    /// Runs a short transfer and kernel benchmark on a device
+    /// @return Wall clock time in ms, infinity if the device failed
+    static double BenchmarkDevice(cl::Device Device);
+
     cl::Context			m_CLContext;
     cl::CommandQueue	m_CLCommandQueue;
     std::vector<cl::Platform> m_CLPlatforms;
@@ -0,0 +1,219 @@
+#include "MappedFile.h"
+
+#include <string>
+#include <system_error>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace {
+
+[[noreturn]] void throwLastError(const std::string& what)
+{
+#ifdef _WIN32
+    throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), what);
+#else
+    throw std::system_error(errno, std::generic_category(), what);
+#endif
+}
+
+} // namespace
+
+MappedFile::MappedFile(const std::filesystem::path& path, Access access)
+{
+    map(path, access, 0U, false);
+}
+
+MappedFile::MappedFile(const std::filesystem::path& path, std::size_t size)
+{
+    map(path, Access::READ_WRITE, size, true);
+}
+
+MappedFile::~MappedFile()
+{
+    unmap();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other) {
+        unmap();
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0U);
+        m_access = other.m_access;
+#ifdef _WIN32
+        m_file = std::exchange(other.m_file, nullptr);
+        m_mapping = std::exchange(other.m_mapping, nullptr);
+#else
+        m_file = std::exchange(other.m_file, -1);
+#endif
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+
+void MappedFile::map(const std::filesystem::path& path, Access access, std::size_t createSize, bool create)
+{
+    m_access = access;
+    const bool writable = access == Access::READ_WRITE;
+    m_file = CreateFileW(
+        path.c_str(),
+        writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+        FILE_SHARE_READ,
+        nullptr,
+        create ? CREATE_ALWAYS : OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+        nullptr);
+    if (m_file == INVALID_HANDLE_VALUE) {
+        m_file = nullptr;
+        throwLastError("Failed to open " + path.string());
+    }
+
+    LARGE_INTEGER size{};
+    if (create) {
+        size.QuadPart = static_cast<LONGLONG>(createSize);
+        if (!SetFilePointerEx(m_file, size, nullptr, FILE_BEGIN) || !SetEndOfFile(m_file)) {
+            unmap();
+            throwLastError("Failed to resize " + path.string());
+        }
+    } else if (!GetFileSizeEx(m_file, &size)) {
+        unmap();
+        throwLastError("Failed to query size of " + path.string());
+    }
+    m_size = static_cast<std::size_t>(size.QuadPart);
+    if (m_size == 0U) {
+        return;
+    }
+
+    m_mapping = CreateFileMappingW(m_file, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY, 0, 0, nullptr);
+    if (!m_mapping) {
+        unmap();
+        throwLastError("Failed to map " + path.string());
+    }
+    m_data = static_cast<std::byte*>(MapViewOfFile(m_mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0));
+    if (!m_data) {
+        unmap();
+        throwLastError("Failed to map view of " + path.string());
+    }
+}
+
+void MappedFile::unmap() noexcept
+{
+    if (m_data) {
+        UnmapViewOfFile(m_data);
+        m_data = nullptr;
+    }
+    if (m_mapping) {
+        CloseHandle(m_mapping);
+        m_mapping = nullptr;
+    }
+    if (m_file) {
+        CloseHandle(m_file);
+        m_file = nullptr;
+    }
+    m_size = 0U;
+}
+
+void MappedFile::prefetch() const noexcept
+{
+    if (m_data) {
+        WIN32_MEMORY_RANGE_ENTRY range{m_data, m_size};
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+    }
+}
+
+void MappedFile::flush()
+{
+    if (m_data && m_access == Access::READ_WRITE) {
+        if (!FlushViewOfFile(m_data, 0) || !FlushFileBuffers(m_file)) {
+            throwLastError("Failed to flush mapping");
+        }
+    }
+}
+
+#else
+
+void MappedFile::map(const std::filesystem::path& path, Access access, std::size_t createSize, bool create)
+{
+    m_access = access;
+    const bool writable = access == Access::READ_WRITE;
+    const int flags = (writable ? O_RDWR : O_RDONLY) | (create ? O_CREAT | O_TRUNC : 0);
+    m_file = ::open(path.c_str(), flags, 0644);
+    if (m_file < 0) {
+        throwLastError("Failed to open " + path.string());
+    }
+
+    if (create) {
+        if (::ftruncate(m_file, static_cast<off_t>(createSize)) != 0) {
+            unmap();
+            throwLastError("Failed to resize " + path.string());
+        }
+        m_size = createSize;
+    } else {
+        struct stat status{};
+        if (::fstat(m_file, &status) != 0) {
+            unmap();
+            throwLastError("Failed to query size of " + path.string());
+        }
+        m_size = static_cast<std::size_t>(status.st_size);
+    }
+    // empty files cannot be mapped
+    if (m_size == 0U) {
+        return;
+    }
+
+    void* mapping = ::mmap(nullptr, m_size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, m_file, 0);
+    if (mapping == MAP_FAILED) {
+        unmap();
+        throwLastError("Failed to map " + path.string());
+    }
+    m_data = static_cast<std::byte*>(mapping);
+}
+
+void MappedFile::unmap() noexcept
+{
+    if (m_data) {
+        ::munmap(m_data, m_size);
+        m_data = nullptr;
+    }
+    if (m_file >= 0) {
+        ::close(m_file);
+        m_file = -1;
+    }
+    m_size = 0U;
+}
+
+void MappedFile::prefetch() const noexcept
+{
+    if (m_data) {
+        ::madvise(m_data, m_size, MADV_WILLNEED);
+    }
+}
+
+void MappedFile::flush()
+{
+    if (m_data && m_access == Access::READ_WRITE) {
+        if (::msync(m_data, m_size, MS_SYNC) != 0) {
+            throwLastError("Failed to flush mapping");
+        }
+    }
+}
+
+#endif
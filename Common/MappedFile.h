@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+/// Memory mapping of a whole file. The mapping is shared, so writes
+/// reach the file without explicit copies. Throws std::system_error
+/// if the file cannot be opened or mapped.
+class MappedFile
+{
+public:
+    enum class Access {
+        READ_ONLY,
+        READ_WRITE,
+    };
+
+    /// Maps an existing file
+    /// @param path File path
+    /// @param access Requested access, writes need READ_WRITE
+    MappedFile(const std::filesystem::path& path, Access access);
+
+    /// Creates or truncates a file of size bytes and maps it for writing
+    /// @param path File path
+    /// @param size File size in bytes
+    MappedFile(const std::filesystem::path& path, std::size_t size);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    std::byte* data() noexcept { return m_data; }
+    const std::byte* data() const noexcept { return m_data; }
+    std::size_t size() const noexcept { return m_size; }
+
+    /// Views the mapping as elements of T, trailing bytes are ignored
+    template <typename T>
+    std::span<T> as() noexcept
+    {
+        return {reinterpret_cast<T*>(m_data), m_size / sizeof(T)};
+    }
+
+    template <typename T>
+    std::span<const T> as() const noexcept
+    {
+        return {reinterpret_cast<const T*>(m_data), m_size / sizeof(T)};
+    }
+
+    /// Hints the OS to read the whole file ahead
+    void prefetch() const noexcept;
+
+    /// Writes modified pages back to the file
+    void flush();
+
+private:
+    void map(const std::filesystem::path& path, Access access, std::size_t createSize, bool create);
+    void unmap() noexcept;
+
+    std::byte*  m_data{nullptr};
+    std::size_t m_size{0U};
+    Access      m_access{Access::READ_ONLY};
+#ifdef _WIN32
+    void* m_file{nullptr};
+    void* m_mapping{nullptr};
+#else
+    int m_file{-1};
+#endif
+};
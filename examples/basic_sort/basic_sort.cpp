@@ -145,7 +145,7 @@ int main()
     // ------------------------------------------------------------------
     ComputeState compute;
     if (!compute.init()) {
-        std::cerr << "No suitable OpenCL GPU device found.\n";
+        std::cerr << "No suitable OpenCL device found.\n";
         return 1;
     }
 
@@ -0,0 +1,297 @@
+#include "AutoRadixSort.h"
+#include "CRadixSortCPU.h"
+
+#include "Common/CTimer.h"
+#include "Common/CLTypeInformation.h"
+#include <CL/Utils/Error.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+const char* toString(SortBackend backend) noexcept
+{
+    switch (backend) {
+        case SortBackend::HOST_SINGLE_THREADED: return "host-single-threaded";
+        case SortBackend::HOST_MULTITHREADED:   return "host-multithreaded";
+        case SortBackend::DEVICE:               return "device";
+    }
+    return "unknown";
+}
+
+template <typename DataType>
+OperationStatus AutoRadixSort<DataType>::initialize(
+    cl::Device Device,
+    cl::Context Context,
+    const std::string& calibrationFile
+)
+{
+    mDevice = Device;
+    mContext = Context;
+    mCalibrationFile = calibrationFile;
+
+    // the largest buffer the device can allocate bounds the device backend
+    const auto maxAlloc = Device.getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>();
+    mMaxDeviceKeys = maxAlloc / sizeof(DataType) / Parameters::_NUM_ITEMS * Parameters::_NUM_ITEMS;
+
+    // The device sorter starts small and grows with the largest input
+    mCapacity = 0U;
+    const auto status = SortOnDevice(cl::CommandQueue(Context, Device), {});
+    if (status != OperationStatus::OK) {
+        return status;
+    }
+
+    if (LoadCalibration()) {
+        return OperationStatus::OK;
+    }
+    return calibrate(cl::CommandQueue(Context, Device));
+}
+
+template <typename DataType>
+SortBackend AutoRadixSort<DataType>::select(std::size_t numKeys) const noexcept
+{
+    if (numKeys <= mThresholds.maxSingleThreaded) {
+        return SortBackend::HOST_SINGLE_THREADED;
+    }
+    // Inputs exceeding a single device buffer stay on the host
+    if (numKeys <= mThresholds.maxHost || numKeys > mMaxDeviceKeys) {
+        return SortBackend::HOST_MULTITHREADED;
+    }
+    return SortBackend::DEVICE;
+}
+
+template <typename DataType>
+OperationStatus AutoRadixSort<DataType>::sort(
+    cl::CommandQueue CommandQueue,
+    std::span<DataType> keys
+)
+{
+    const auto backend = select(keys.size());
+    auto status = OperationStatus::OK;
+
+    CTimer timer;
+    timer.Start();
+    auto path = SortPath::RADIX;
+    switch (backend) {
+        case SortBackend::HOST_SINGLE_THREADED:
+            path = RadixSortCPU<DataType>::sortAdaptive(keys, 1U);
+            break;
+        case SortBackend::HOST_MULTITHREADED:
+            path = RadixSortCPU<DataType>::sortAdaptive(keys);
+            break;
+        case SortBackend::DEVICE:
+            status = SortOnDevice(CommandQueue, keys);
+            path = mSorter.getRuntimes().path;
+            break;
+    }
+    timer.Stop();
+
+    const DispatchRecord record{keys.size(), backend, path, timer.GetElapsedMilliseconds()};
+    mDecisions.push_back(record);
+    if (mOutStream) {
+        *mOutStream << "Sorted " << record.numKeys << " keys on " << toString(record.backend)
+                    << " (" << toString(record.path) << ") in " << record.time << " ms" << std::endl;
+    }
+    return status;
+}
+
+template <typename DataType>
+OperationStatus AutoRadixSort<DataType>::SortOnDevice(
+    cl::CommandQueue CommandQueue,
+    std::span<DataType> keys
+)
+{
+    using S = OperationStatus;
+    const auto numKeys = keys.size();
+    if (numKeys > mMaxDeviceKeys) {
+        return S::RESIZE_FAILED;
+    }
+
+    // grow in powers of two to limit the number of program rebuilds
+    const auto required = mSorter.Resize(std::max<size_t>(numKeys, Parameters::_NUM_ITEMS));
+    if (required > mCapacity) {
+        const auto capacity = std::min(std::bit_ceil(required), mMaxDeviceKeys);
+        mSorter.release();
+        auto status = mSorter.initialize(mDevice, mContext, capacity, HostSpans<DataType>{});
+        if (status != S::OK) {
+            return status;
+        }
+        cl_int clError{CL_SUCCESS};
+        mKeys = cl::Buffer(mContext, CL_MEM_READ_WRITE, sizeof(DataType) * capacity, nullptr, &clError);
+        if (clError) {
+            std::cerr<<cl::util::Error(clError, "Failed to create dispatch key buffer").what()<<"\n";
+            return S::HOST_BUFFERS_FAILED;
+        }
+        mCapacity = capacity;
+    }
+    if (keys.empty()) {
+        return S::OK;
+    }
+
+    const auto sizeBytes = sizeof(DataType) * keys.size();
+    CommandQueue.enqueueWriteBuffer(mKeys, CL_FALSE, 0, sizeBytes, keys.data());
+    const auto status = mSorter.sortBuffer(CommandQueue, mKeys, 0U, numKeys);
+    if (status != S::OK) {
+        return status;
+    }
+    const auto err = CommandQueue.enqueueReadBuffer(mKeys, CL_TRUE, 0, sizeBytes, keys.data());
+    return err == CL_SUCCESS ? S::OK : S::DATA_DOWNLOAD_FAILED;
+}
+
+template <typename DataType>
+OperationStatus AutoRadixSort<DataType>::calibrate(cl::CommandQueue CommandQueue)
+{
+    constexpr std::size_t minSize = 1U << 10U;
+    constexpr std::size_t maxSize = 1U << 22U;
+    constexpr auto iterations = 3U;
+
+    std::mt19937_64 generator(minSize);
+    std::vector<DataType> reference(maxSize);
+    std::ranges::generate(reference, [&]() { return static_cast<DataType>(generator()); });
+    std::vector<DataType> keys(maxSize);
+
+    const auto measure = [&](std::size_t size, auto&& run) {
+        double best = std::numeric_limits<double>::max();
+        for (auto i = 0U; i < iterations; i++) {
+            std::copy_n(reference.begin(), size, keys.begin());
+            std::span<DataType> span(keys.data(), size);
+            CTimer timer;
+            timer.Start();
+            run(span);
+            timer.Stop();
+            best = std::min(best, timer.GetElapsedMilliseconds());
+        }
+        return best;
+    };
+
+    // Sizes grow by four, a backend keeps its range while it is the fastest
+    DispatchThresholds thresholds{0U, 0U};
+    bool singleAhead = true;
+    bool hostAhead = true;
+    for (auto size = minSize; size <= maxSize; size *= 4U) {
+        const auto single = measure(size, [](auto& span) { RadixSortCPU<DataType>::sort(span); });
+        const auto multi = measure(size, [](auto& span) { RadixSortCPU<DataType>::sortParallel(span); });
+        auto status = OperationStatus::OK;
+        const auto device = measure(size, [&](auto& span) { status = SortOnDevice(CommandQueue, span); });
+        if (status != OperationStatus::OK) {
+            return status;
+        }
+
+        if (singleAhead && single <= multi && single <= device) {
+            thresholds.maxSingleThreaded = size;
+        } else {
+            singleAhead = false;
+        }
+        if (hostAhead && std::min(single, multi) < device) {
+            thresholds.maxHost = size;
+        } else {
+            hostAhead = false;
+        }
+    }
+    // host still faster at the largest size, never use the device
+    if (hostAhead) {
+        thresholds.maxHost = std::numeric_limits<std::size_t>::max();
+    }
+
+    mThresholds = thresholds;
+    if (!mCalibrationFile.empty() && !StoreCalibration()) {
+        std::cerr << "Failed to store calibration in " << mCalibrationFile << "\n";
+    }
+    return OperationStatus::OK;
+}
+
+template <typename DataType>
+std::string AutoRadixSort<DataType>::CalibrationKey() const
+{
+    // whitespace would break the line based file format
+    auto key = mDevice.getInfo<CL_DEVICE_NAME>() + "|"
+        + mDevice.getInfo<CL_DRIVER_VERSION>() + "|"
+        + std::string(TypeNameString<DataType>::open_cl_name);
+    std::ranges::replace_if(key, [](char c) { return std::isspace(static_cast<unsigned char>(c)); }, '_');
+    return key;
+}
+
+template <typename DataType>
+bool AutoRadixSort<DataType>::LoadCalibration()
+{
+    if (mCalibrationFile.empty()) {
+        return false;
+    }
+    std::ifstream file(mCalibrationFile);
+    const auto key = CalibrationKey();
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream entry(line);
+        std::string entryKey;
+        DispatchThresholds thresholds;
+        if (entry >> entryKey >> thresholds.maxSingleThreaded >> thresholds.maxHost && entryKey == key) {
+            mThresholds = thresholds;
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename DataType>
+bool AutoRadixSort<DataType>::StoreCalibration() const
+{
+    // keep entries of other devices and key types
+    const auto key = CalibrationKey();
+    std::vector<std::string> lines;
+    {
+        std::ifstream file(mCalibrationFile);
+        std::string line;
+        while (std::getline(file, line)) {
+            if (line.rfind(key + " ", 0) != 0) {
+                lines.push_back(line);
+            }
+        }
+    }
+    std::ofstream file(mCalibrationFile, std::ios::trunc);
+    for (const auto& line : lines) {
+        file << line << "\n";
+    }
+    file << key << " " << mThresholds.maxSingleThreaded << " " << mThresholds.maxHost << "\n";
+    return static_cast<bool>(file);
+}
+
+template <typename DataType>
+void AutoRadixSort<DataType>::setThresholds(const DispatchThresholds& thresholds) noexcept
+{
+    mThresholds = thresholds;
+}
+
+template <typename DataType>
+const DispatchThresholds& AutoRadixSort<DataType>::thresholds() const noexcept
+{
+    return mThresholds;
+}
+
+template <typename DataType>
+const std::vector<DispatchRecord>& AutoRadixSort<DataType>::decisions() const noexcept
+{
+    return mDecisions;
+}
+
+template <typename DataType>
+void AutoRadixSort<DataType>::setLogStream(std::ostream* out) noexcept
+{
+    mOutStream = out;
+}
+
+template <typename DataType>
+OperationStatus AutoRadixSort<DataType>::release()
+{
+    mKeys = cl::Buffer();
+    mCapacity = 0U;
+    return mSorter.release();
+}
+
+// Specialize AutoRadixSort for the supported types.
+template class AutoRadixSort < int32_t >;
+template class AutoRadixSort < int64_t >;
+template class AutoRadixSort < uint32_t >;
+template class AutoRadixSort < uint64_t >;
@@ -0,0 +1,121 @@
+#pragma once
+
+#define CL_HPP_MINIMUM_OPENCL_VERSION 120
+#define CL_HPP_TARGET_OPENCL_VERSION 120
+#include <CL/opencl.hpp>
+
+#include "RadixSortGPU.h"
+#include "OperationStatus.h"
+
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <span>
+#include <string>
+#include <vector>
+
+/// Implementation a sort call is routed to
+enum class SortBackend {
+    /// RadixSortCPU on the calling thread
+    HOST_SINGLE_THREADED,
+    /// RadixSortCPU on all hardware threads
+    HOST_MULTITHREADED,
+    /// RadixSortGPU on the OpenCL device
+    DEVICE,
+};
+
+/// Returns printable name of a backend
+const char* toString(SortBackend backend) noexcept;
+
+/// Crossover sizes between the backends for one device and key type
+struct DispatchThresholds {
+    /// Largest number of keys sorted on the calling thread
+    std::size_t maxSingleThreaded{0U};
+    /// Largest number of keys sorted on the host, larger inputs go to the device
+    std::size_t maxHost{std::numeric_limits<std::size_t>::max()};
+};
+
+/// Audit record of a single sort call
+struct DispatchRecord {
+    std::size_t numKeys{0U};
+    SortBackend backend{SortBackend::HOST_SINGLE_THREADED};
+    /// Shortcut taken for presorted keys, RADIX if there was none
+    SortPath path{SortPath::RADIX};
+    /// Wall clock time of the call in ms, including transfers
+    double time{0.0};
+};
+
+/// Sorts keys on the host or on the device, whichever is expected to be
+/// fastest for the input size. Crossover sizes are measured once per device
+/// and key type and stored in a calibration file.
+/// @tparam DataType Type of data to be sorted
+template <typename DataType>
+class AutoRadixSort
+{
+public:
+    /// Default calibration file, relative to the working directory
+    inline static const std::string DEFAULT_CALIBRATION_FILE = "radixsort_calibration.txt";
+
+    /// Loads thresholds of the device from the calibration file,
+    /// or measures and stores them if the file has no entry yet
+    /// @param Device OpenCL device
+    /// @param Context OpenCL context
+    /// @param calibrationFile Path of the calibration file, empty to not persist
+    OperationStatus initialize(
+        cl::Device Device,
+        cl::Context Context,
+        const std::string& calibrationFile = DEFAULT_CALIBRATION_FILE
+    );
+
+    /// Sorts keys in place on the selected backend
+    /// @param CommandQueue OpenCL Command Queue used by the device backend
+    /// @param keys Keys to be sorted
+    OperationStatus sort(
+        cl::CommandQueue CommandQueue,
+        std::span<DataType> keys
+    );
+
+    /// Returns backend a call with numKeys keys is routed to
+    SortBackend select(std::size_t numKeys) const noexcept;
+
+    /// Measures thresholds on the device and updates the calibration file
+    OperationStatus calibrate(cl::CommandQueue CommandQueue);
+
+    /// Overrides the thresholds, e.g. loaded from elsewhere
+    void setThresholds(const DispatchThresholds& thresholds) noexcept;
+    const DispatchThresholds& thresholds() const noexcept;
+
+    /// Returns one record per sort call, in call order
+    const std::vector<DispatchRecord>& decisions() const noexcept;
+
+    /// Sets output log stream receiving a line per decision
+    /// @param[in,out] out Log text stream
+    void setLogStream(std::ostream* out) noexcept;
+
+    /// Frees device buffers
+    OperationStatus release();
+
+private:
+    using Parameters = AlgorithmParameters<DataType>;
+
+    /// Sorts on the device, growing its buffers if needed
+    OperationStatus SortOnDevice(cl::CommandQueue CommandQueue, std::span<DataType> keys);
+    /// Key identifying device and key type in the calibration file
+    std::string CalibrationKey() const;
+    bool LoadCalibration();
+    bool StoreCalibration() const;
+
+    RadixSortGPU<DataType> mSorter;
+    cl::Device mDevice;
+    cl::Context mContext;
+    /// Device keys, holds mCapacity keys
+    cl::Buffer mKeys;
+    size_t mCapacity{0U};
+    /// Keys fitting into the largest device buffer
+    size_t mMaxDeviceKeys{0U};
+
+    DispatchThresholds mThresholds{};
+    std::string mCalibrationFile;
+    std::vector<DispatchRecord> mDecisions;
+    std::ostream* mOutStream{nullptr};
+};
@@ -1,14 +1,21 @@
 ﻿#pragma once
 
 #include "Parameters.h"
+#include "Presortedness.h"
+#include "Merge.h"
+#include "CountingSort.h"
 
 #include <vector>
 #include <algorithm>
+#include <bit>
 #include <span>
 #include <ranges>
 #include <cstdlib>
 #include <cmath>
 #include <cstdint>
+#include <limits>
+#include <thread>
+#include <type_traits>
 
 namespace {
 
@@ -57,29 +64,213 @@ public:
 	template<typename ElemType>
 	static void sort(std::span<ElemType>& arr)
 	{
-		// Find the maximum number to know number of digits
-		// in O(nkeys)
-		const auto max_elem = *std::ranges::max_element(arr);
+		using UnsignedElemType = typename std::make_unsigned_t<ElemType>;
+		constexpr auto offset = std::numeric_limits<ElemType>::min();
+
+		// Find minimum and maximum of the values shifted into the unsigned
+		// region, only the digits of their difference vary between keys
+		UnsignedElemType min_elem = std::numeric_limits<UnsignedElemType>::max();
+		UnsignedElemType max_elem = 0U;
+		for (const auto elem : arr) {
+			const auto value = static_cast<UnsignedElemType>(elem - offset);
+			min_elem = std::min(min_elem, value);
+			max_elem = std::max(max_elem, value);
+		}
+		if (arr.empty() || min_elem == max_elem) {
+			return;
+		}
 
 		// Do counting sort for every digit. Note that instead
-		// of passing digit number, exp is passed. exp is 10^i
+		// of passing digit number, exp is passed. exp is NUM_BINS^i
 		// where i is current digit number
-		const auto numDigits = max_elem ? static_cast<uint64_t>(std::ceil(std::log(abs(max_elem)) / std::log(NUM_BINS))) : 1;
-		//for (uint64_t exp = 1ULL; std::abs(m) > exp; exp *= Radix) {
-		for (uint64_t exp = 0ULL; exp < numDigits; exp++) {
-			countSort(arr, static_cast<uint64_t>(std::pow(NUM_BINS, exp)));
+		uint64_t numDigits = 1U;
+		for (auto rest = static_cast<UnsignedElemType>(max_elem - min_elem) / NUM_BINS; rest > 0U; rest /= NUM_BINS) {
+			numDigits++;
+		}
+		uint64_t exp = 1ULL;
+		for (uint64_t digit = 0ULL; digit < numDigits; digit++, exp *= NUM_BINS) {
+			countSort(arr, exp, min_elem);
 		}
 	}
 
+	/// Sorts arr[] with a least significant digit radix sort on
+	/// several threads. Each thread counts and scatters its own chunk,
+	/// the chunk offsets per digit are derived from all counts.
+    /// @tparam ElemType Element type of vector to be sorted
+    /// @param arr Vector to be sorted
+    /// @param numThreads Number of threads, 0 selects the hardware concurrency
+	template<typename ElemType>
+	static void sortParallel(std::span<ElemType>& arr, size_t numThreads = 0U)
+	{
+		std::span<NoValue> values;
+		sortPairsParallel(arr, values, numThreads);
+	}
+
+	/// Sorts pairs of keys and values by key like sortParallel(),
+	/// moving each value along with its key. The sort is stable,
+	/// values of equal keys keep their order.
+    /// @tparam ElemType Element type of the keys
+    /// @tparam ValueType Element type of the values
+    /// @param keys Keys to be sorted
+    /// @param values Values, as many as keys
+    /// @param numThreads Number of threads, 0 selects the hardware concurrency
+	template<typename ElemType, typename ValueType>
+	static void sortPairsParallel(std::span<ElemType>& keys, std::span<ValueType>& values, size_t numThreads = 0U)
+	{
+		constexpr bool withValues = !std::is_same_v<ValueType, NoValue>;
+		using UnsignedElemType = typename std::make_unsigned_t<ElemType>;
+		constexpr auto RADIX = Parameters::_RADIX;
+		constexpr auto BITS = Parameters::_NUM_BITS_PER_RADIX;
+		constexpr UnsignedElemType signBit = std::is_signed_v<ElemType>
+			? UnsignedElemType{1U} << (Parameters::_TOTALBITS - 1U)
+			: UnsignedElemType{0U};
+
+		const auto n = keys.size();
+		if (numThreads == 0U) {
+			numThreads = std::max(std::thread::hardware_concurrency(), 1U);
+		}
+		numThreads = std::max<size_t>(std::min(numThreads, n / RADIX), 1U);
+		const auto chunkSize = (n + numThreads - 1U) / numThreads;
+
+		const auto forEachChunk = [&](auto&& body) {
+			std::vector<std::thread> threads;
+			for (size_t t = 1U; t < numThreads; t++) {
+				threads.emplace_back(body, t, t * chunkSize, std::min(n, (t + 1U) * chunkSize));
+			}
+			body(0U, 0U, std::min(n, chunkSize));
+			for (auto& thread : threads) {
+				thread.join();
+			}
+		};
+
+		// Flipping the sign bit maps signed keys to ascending unsigned ones
+		const auto key = [](ElemType elem) {
+			return static_cast<UnsignedElemType>(static_cast<UnsignedElemType>(elem) ^ signBit);
+		};
+
+		// Keys are sorted by their distance to the minimum, passes
+		// above the highest bit of the largest distance would not move any key
+		std::vector<UnsignedElemType> minima(numThreads, std::numeric_limits<UnsignedElemType>::max());
+		std::vector<UnsignedElemType> maxima(numThreads, 0U);
+		forEachChunk([&](size_t t, size_t begin, size_t end) {
+			for (auto i = begin; i < end; i++) {
+				minima[t] = std::min(minima[t], key(keys[i]));
+				maxima[t] = std::max(maxima[t], key(keys[i]));
+			}
+		});
+		const auto minKey = *std::ranges::min_element(minima);
+		const auto maxKey = *std::ranges::max_element(maxima);
+		if (n == 0U || minKey == maxKey) {
+			return;
+		}
+		const auto varyingBits = static_cast<uint32_t>(std::bit_width(static_cast<UnsignedElemType>(maxKey - minKey)));
+		const auto numPasses = (varyingBits + BITS - 1U) / BITS;
+
+		std::vector<ElemType> buffer(n);
+		std::span<ElemType> input = keys;
+		std::span<ElemType> output = buffer;
+		std::vector<ValueType> valueBuffer(withValues ? n : 0U);
+		std::span<ValueType> inputValues = values;
+		std::span<ValueType> outputValues = valueBuffer;
+		std::vector<size_t> counts(numThreads * RADIX);
+		for (uint32_t pass = 0U; pass < numPasses; pass++) {
+			const auto shift = pass * BITS;
+			const auto digit = [&](ElemType elem) {
+				return (static_cast<UnsignedElemType>(key(elem) - minKey) >> shift) & (RADIX - 1U);
+			};
+
+			std::ranges::fill(counts, 0U);
+			forEachChunk([&](size_t t, size_t begin, size_t end) {
+				for (auto i = begin; i < end; i++) {
+					counts[t * RADIX + digit(input[i])]++;
+				}
+			});
+
+			// exclusive scan in digit major order keeps the sort stable
+			size_t sum = 0U;
+			for (size_t d = 0U; d < RADIX; d++) {
+				for (size_t t = 0U; t < numThreads; t++) {
+					const auto count = counts[t * RADIX + d];
+					counts[t * RADIX + d] = sum;
+					sum += count;
+				}
+			}
+
+			forEachChunk([&](size_t t, size_t begin, size_t end) {
+				auto* offsets = &counts[t * RADIX];
+				for (auto i = begin; i < end; i++) {
+					const auto position = offsets[digit(input[i])]++;
+					output[position] = input[i];
+					if constexpr (withValues) {
+						outputValues[position] = inputValues[i];
+					}
+				}
+			});
+			std::swap(input, output);
+			std::swap(inputValues, outputValues);
+		}
+
+		if (input.data() != keys.data()) {
+			std::ranges::copy(input, keys.begin());
+			std::ranges::copy(inputValues, values.begin());
+		}
+	}
+
+	/// Sorts arr[] taking a shortcut for presorted keys: ascending keys
+	/// are left untouched, descending ones reversed and few ascending runs
+	/// merged. Keys of a small range or few distinct values are counted,
+	/// other inputs are radix sorted.
+    /// @tparam ElemType Element type of vector to be sorted
+    /// @param arr Vector to be sorted
+    /// @param numThreads Number of threads, 1 sorts on the calling thread,
+    ///                   0 selects the hardware concurrency
+    /// @return Path the keys were sorted by
+	template<typename ElemType>
+	static SortPath sortAdaptive(std::span<ElemType>& arr, size_t numThreads = 0U)
+	{
+		const std::span<const ElemType> keys = arr;
+		const auto path = selectSortPath(
+			measurePresortedness(keys, Parameters::_MAX_MERGE_RUNS),
+			Parameters::_MAX_MERGE_RUNS
+		);
+		switch (path) {
+			case SortPath::SORTED:
+				break;
+			case SortPath::REVERSED:
+				std::ranges::reverse(arr);
+				break;
+			case SortPath::RUN_MERGE:
+				mergeRuns(arr, runOffsets(keys), numThreads);
+				break;
+			case SortPath::COUNTING:
+			case SortPath::RADIX:
+				if (countingSort(arr, numThreads)) {
+					return SortPath::COUNTING;
+				}
+				if (numThreads == 1U) {
+					sort(arr);
+				} else {
+					sortParallel(arr, numThreads);
+				}
+				break;
+		}
+		return path;
+	}
+
 private:
+	/// Value type of keys sorted without values
+	struct NoValue {};
+
 	// A function to do counting sort of arr[] according to
 	// the digit represented by exp.
     /// @param arr Vector to be sorted
     /// @param exp Exponent
+    /// @param minValue Minimum of the keys shifted into the unsigned region,
+    ///                 digits are taken from the distance to it
     ///
     /// @note Allocates memory
 	template <typename ElemType>
-	static void countSort(std::span<ElemType>& arr, uint64_t exp)
+	static void countSort(std::span<ElemType>& arr, uint64_t exp, std::make_unsigned_t<ElemType> minValue)
 	{
 		using UnsignedElemType = typename std::make_unsigned_t<ElemType>;
 
@@ -94,7 +285,7 @@ private:
 
 		// Store count of occurrences in count[]
 		for (i = 0; i < n; i++) {
-			const auto elem_value = static_cast<UnsignedElemType>(inputData[i] - offset);
+			const auto elem_value = static_cast<UnsignedElemType>(static_cast<UnsignedElemType>(inputData[i] - offset) - minValue);
 			count[(elem_value / exp) % NUM_BINS]++;
 		}
 
@@ -106,7 +297,7 @@ private:
 
 		// Build the output array
 		for (int64_t i = n-1; i >= 0; i--) {
-			const auto elem_value = static_cast<UnsignedElemType>(inputData[i] - offset);
+			const auto elem_value = static_cast<UnsignedElemType>(static_cast<UnsignedElemType>(inputData[i] - offset) - minValue);
             const auto countIdx {(elem_value / exp) % NUM_BINS};
 			output[count[countIdx] - 1] = inputData[i];
 			count[countIdx]--;
@@ -10,6 +10,7 @@
 
 #include <algorithm>
 #include <numeric>
+#include <limits>
 #include <iomanip>
 #include <fstream>
 #include <sstream>
@@ -65,7 +66,7 @@ CRadixSortTask<DataType>::CRadixSortTask(
 	:
     mNumberKeys(static_cast<decltype(mNumberKeys)>(options.num_elements)),
     // TODO: Check value for initialization
-	mNumberKeysRounded(Parameters::_NUM_MAX_INPUT_ELEMS),
+	mNumberKeysRounded(options.num_elements),
 	mHostData(dataset),
     m_selectedDataset(dataset),
     mOptions(options)
@@ -78,22 +79,36 @@ bool CRadixSortTask<DataType>::InitResources(
     )
 {
     // CPU resources
+    if (mOptions.config) {
+        mRadixSortGPU.setConfig(*mOptions.config);
+    }
     CheckLocalMemory(Device);
 	mNumberKeysRounded = Resize(mNumberKeys);
     auto& hostBuffers {mHostData.mHostBuffers};
     hostBuffers.m_hResultFromGPU.resize(
         mNumberKeysRounded
     );
+    // Host buffers are rounded for the compile-time parameters,
+    // the configured number of items may be larger
+    if (hostBuffers.m_hKeys.size() < mNumberKeysRounded) {
+        const auto numKeys = hostBuffers.m_hKeys.size();
+        hostBuffers.m_hKeys.resize(mNumberKeysRounded, std::numeric_limits<DataType>::max());
+        hostBuffers.h_Permut.resize(mNumberKeysRounded);
+        std::iota(hostBuffers.h_Permut.begin() + numKeys, hostBuffers.h_Permut.end(), static_cast<uint32_t>(numKeys));
+    }
+    hostBuffers.m_hHistograms.resize(mRadixSortGPU.config().histoSize());
+    hostBuffers.m_hGlobsum.resize(mRadixSortGPU.config().histoSplit);
 
     // Collect pointers to host memory
     HostSpans<DataType> hostSpans {
         {hostBuffers.m_hKeys.data(), hostBuffers.m_hKeys.size()},
-        {hostBuffers.m_hHistograms.data(), hostBuffers.m_hKeys.size()},
-        {hostBuffers.m_hGlobsum.data(), hostBuffers.m_hKeys.size()},
-        {hostBuffers.h_Permut.data(), hostBuffers.m_hKeys.size()},
-        {hostBuffers.m_hResultFromGPU.data(), hostBuffers.m_hKeys.size()},
+        {hostBuffers.m_hHistograms.data(), hostBuffers.m_hHistograms.size()},
+        {hostBuffers.m_hGlobsum.data(), hostBuffers.m_hGlobsum.size()},
+        {hostBuffers.h_Permut.data(), hostBuffers.h_Permut.size()},
+        {hostBuffers.m_hResultFromGPU.data(), hostBuffers.m_hResultFromGPU.size()},
     };
     // Initialize actual GPU algorithms and memory
+    mRadixSortGPU.setMemoryMode(mOptions.memory_mode);
     const auto status = mRadixSortGPU.initialize(
         Device,
         Context,
@@ -123,7 +138,6 @@ void CRadixSortTask<DataType>::ComputeGPU(
     const LocalWorkSize& LocalWorkSize)
 {
 	if (const auto paddingRequired = mNumberKeys != mNumberKeysRounded) {
-        assert(mNumberKeysRounded <= Parameters::_NUM_MAX_INPUT_ELEMS);
         const auto paddingOffset = sizeof(DataType) * mNumberKeys;
         mRadixSortGPU.padGPUData(CommandQueue, paddingOffset);
     }
@@ -257,26 +271,17 @@ void CRadixSortTask<DataType>::CheckLocalMemory(cl::Device Device)
     cl_ulong localMem{0};
     localMem = Device.getInfo<CL_DEVICE_LOCAL_MEM_SIZE>();
     if (mOptions.verbose) {
+        const auto& config {mRadixSortGPU.config()};
         std::cout << "Cache size   = " << localMem << " Bytes." << std::endl;
-		std::cout << "Needed cache = " << sizeof(cl_uint) * Parameters::_RADIX * Parameters::_NUM_ITEMS_PER_GROUP << " Bytes." << std::endl;
+		std::cout << "Needed cache = " << sizeof(cl_uint) * config.radix() * config.itemsPerGroup << " Bytes." << std::endl;
     }
-	assert(localMem > sizeof(DataType) * Parameters::_RADIX * Parameters::_NUM_ITEMS_PER_GROUP);
-
-    [[maybe_unused]]
-	constexpr uint32_t maxmemcache =
-        std::max(
-            Parameters::_NUM_HISTOSPLIT,
-		    Parameters::_NUM_ITEMS_PER_GROUP * Parameters::_NUM_GROUPS * Parameters::_RADIX / Parameters::_NUM_HISTOSPLIT
-        );
-	assert(localMem > sizeof(DataType)*maxmemcache);
+    // the configuration is validated against the device on initialize()
 }
 
 /// resize the sorted vector
 template <typename DataType>
-uint32_t CRadixSortTask<DataType>::Resize(uint32_t nn)
+size_t CRadixSortTask<DataType>::Resize(size_t nn)
 {
-	assert(nn <= Parameters::_NUM_MAX_INPUT_ELEMS);
-
     if (mOptions.verbose){
         std::cout << "Resizing to  " << nn << std::endl;
     }
@@ -292,7 +297,6 @@ void CRadixSortTask<DataType>::ExecuteTask(
         const LocalWorkSize&
     )
 {
-	assert(mNumberKeysRounded <= Parameters::_NUM_MAX_INPUT_ELEMS);
     if (mOptions.verbose) {
         std::cout << "Sorting " << mNumberKeys << " keys..." << std::endl;
     }
@@ -383,10 +387,16 @@ void TestPerformance(
 
         std::cout << " kernel |    avg      |     min     |    max " << std::endl;
         std::cout << " -----------------------------------------------" << std::endl;
+        std::cout << "  presorted: " << std::setw(8) << t.timePresorted.avg << " | " << t.timePresorted.min << " | " << t.timePresorted.max << " (" << toString(t.path) << ")" << std::endl;
+        std::cout << "  range:     " << std::setw(8) << t.timeKeyRange.avg << " | " << t.timeKeyRange.min << " | " << t.timeKeyRange.max << std::endl;
+        std::cout << "  counting:  " << std::setw(8) << t.timeCounting.avg << " | " << t.timeCounting.min << " | " << t.timeCounting.max << std::endl;
         std::cout << "  histogram: " << std::setw(8) << t.timeHisto.avg << " | " << t.timeHisto.min << " | " << t.timeHisto.max << std::endl;
         std::cout << "  scan:      " << std::setw(8) << t.timeScan.avg << " | " << t.timeScan.min << " | " << t.timeScan.max << std::endl;
         std::cout << "  paste:     " << std::setw(8) << t.timePaste.avg << " | " << t.timePaste.min << " | " << t.timePaste.max << std::endl;
         std::cout << "  reorder:   " << std::setw(8) << t.timeReorder.avg << " | " << t.timeReorder.min << " | " << t.timeReorder.max << std::endl;
+        std::cout << "  local:     " << std::setw(8) << t.timeLocalSort.avg << " | " << t.timeLocalSort.min << " | " << t.timeLocalSort.max << std::endl;
+        std::cout << "  upload:    " << std::setw(8) << t.timeUpload.avg << " | " << t.timeUpload.min << " | " << t.timeUpload.max << std::endl;
+        std::cout << "  download:  " << std::setw(8) << t.timeDownload.avg << " | " << t.timeDownload.min << " | " << t.timeDownload.max << std::endl;
         std::cout << " -----------------------------------------------" << std::endl;
         std::cout << "  total:     " << averageTimeTotal_ms << " ms, throughput: " << 1.0e-6 * (double)numberKeys / averageTimeTotal_ms << " Gelem/s" << std::endl;
     }
@@ -53,7 +53,7 @@ protected:
 
 	// Helper methods
 	void CheckLocalMemory(cl::Device Device);
-	uint32_t Resize(uint32_t nn);
+	size_t Resize(size_t nn);
 
     /// Performs reorder step
 	void Reorder(
@@ -70,8 +70,8 @@ protected:
     );
 
 
-    uint32_t mNumberKeys{0U}; // actual number of keys
-    uint32_t mNumberKeysRounded{0U}; // next multiple of _ITEMS*_GROUPS
+    size_t mNumberKeys{0U}; // actual number of keys
+    size_t mNumberKeysRounded{0U}; // next multiple of _ITEMS*_GROUPS
 
     // Actual host data:
     // * intermediate algorithm buffers
@@ -0,0 +1,109 @@
+#include "ChunkedRadixSort.h"
+#include "Merge.h"
+
+#include <algorithm>
+#include <deque>
+#include <future>
+#include <iostream>
+#include <vector>
+
+template <typename DataType>
+std::size_t ChunkedRadixSort<DataType>::RunSizeForBudget(
+    std::size_t memoryBudget,
+    std::size_t numSlots
+) noexcept
+{
+    // per slot: histograms and scan sums of the widest index type
+    constexpr std::size_t fixedBytes = sizeof(cl_ulong)
+        * (Parameters::_RADIX * Parameters::_NUM_ITEMS + 2U * Parameters::_NUM_HISTOSPLIT);
+    // per key: input and output keys and permutations
+    constexpr std::size_t bytesPerKey = 2U * sizeof(DataType) + 2U * sizeof(uint32_t);
+
+    const auto slotBudget = memoryBudget / std::max<std::size_t>(numSlots, 1U);
+    if (slotBudget <= fixedBytes) {
+        return 0U;
+    }
+    const auto numKeys = (slotBudget - fixedBytes) / bytesPerKey;
+    return numKeys / Parameters::_NUM_ITEMS * Parameters::_NUM_ITEMS;
+}
+
+template <typename DataType>
+OperationStatus ChunkedRadixSort<DataType>::initialize(
+    cl::Device Device,
+    cl::Context Context,
+    std::size_t memoryBudget,
+    std::size_t numSlots
+)
+{
+    // a run has to fit into a single device buffer as well
+    const auto maxAllocKeys = Device.getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>() / sizeof(DataType);
+    mRunSize = std::min(
+        RunSizeForBudget(memoryBudget, numSlots),
+        maxAllocKeys / Parameters::_NUM_ITEMS * Parameters::_NUM_ITEMS
+    );
+    mNumSlots = numSlots;
+    if (mRunSize == 0U) {
+        std::cerr << "Memory budget of " << memoryBudget << " bytes is too small for " << numSlots << " runs\n";
+        return OperationStatus::INITIALIZATION_FAILED;
+    }
+    return mPipeline.initialize(Device, Context, mRunSize, numSlots);
+}
+
+template <typename DataType>
+OperationStatus ChunkedRadixSort<DataType>::sort(std::span<DataType> keys)
+{
+    using Batch = typename RadixSortPipeline<DataType>::Batch;
+    if (mRunSize == 0U) {
+        return OperationStatus::INITIALIZATION_FAILED;
+    }
+
+    std::vector<std::size_t> runOffsets;
+    for (std::size_t offset = 0U; offset < keys.size(); offset += mRunSize) {
+        runOffsets.push_back(offset);
+    }
+    runOffsets.push_back(keys.size());
+    const auto numRuns = runOffsets.size() - 1U;
+
+    // Keep one run more than slots in flight, so that every slot
+    // has its next upload queued while host memory stays bounded
+    std::deque<std::future<Batch>> inFlight;
+    std::size_t nextSubmit = 0U;
+    try {
+        for (std::size_t run = 0U; run < numRuns; run++) {
+            while (nextSubmit < numRuns && inFlight.size() <= mNumSlots) {
+                const auto begin = keys.begin() + runOffsets[nextSubmit];
+                const auto end = keys.begin() + runOffsets[nextSubmit + 1U];
+                inFlight.push_back(mPipeline.submit(Batch(begin, end)));
+                nextSubmit++;
+            }
+            const auto sorted = inFlight.front().get();
+            inFlight.pop_front();
+            std::ranges::copy(sorted, keys.begin() + runOffsets[run]);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Sorting run failed: " << e.what() << "\n";
+        return OperationStatus::CALCULATION_FAILED;
+    }
+
+    mergeRuns(keys, std::move(runOffsets));
+    return OperationStatus::OK;
+}
+
+template <typename DataType>
+std::size_t ChunkedRadixSort<DataType>::runSize() const noexcept
+{
+    return mRunSize;
+}
+
+template <typename DataType>
+OperationStatus ChunkedRadixSort<DataType>::release()
+{
+    mRunSize = 0U;
+    return mPipeline.release();
+}
+
+// Specialize ChunkedRadixSort for the supported types.
+template class ChunkedRadixSort < int32_t >;
+template class ChunkedRadixSort < int64_t >;
+template class ChunkedRadixSort < uint32_t >;
+template class ChunkedRadixSort < uint64_t >;
@@ -0,0 +1,55 @@
+#pragma once
+
+#define CL_HPP_MINIMUM_OPENCL_VERSION 120
+#define CL_HPP_TARGET_OPENCL_VERSION 120
+#include <CL/opencl.hpp>
+
+#include "RadixSortPipeline.h"
+#include "OperationStatus.h"
+
+#include <cstddef>
+#include <span>
+
+/// Sorts inputs larger than device memory. The input is split into runs
+/// fitting into a memory budget, runs are sorted by a batch pipeline so that
+/// the transfer of one run overlaps the sort of another, and the sorted runs
+/// are merged on the host in parallel.
+/// @tparam DataType Type of data to be sorted
+template <typename DataType>
+class ChunkedRadixSort
+{
+public:
+    /// Creates the device slots of the pipeline
+    /// @param Device OpenCL device
+    /// @param Context OpenCL context
+    /// @param memoryBudget Device memory in bytes all slots may use together
+    /// @param numSlots Number of runs on the device at once
+    OperationStatus initialize(
+        cl::Device Device,
+        cl::Context Context,
+        std::size_t memoryBudget,
+        std::size_t numSlots = 2U
+    );
+
+    /// Sorts keys in place, any number of keys
+    /// @param keys Keys to be sorted
+    OperationStatus sort(std::span<DataType> keys);
+
+    /// Returns number of keys sorted on the device at once
+    std::size_t runSize() const noexcept;
+
+    /// Returns largest run size whose device buffers fit into the budget
+    /// @param memoryBudget Device memory in bytes
+    /// @param numSlots Number of runs on the device at once
+    static std::size_t RunSizeForBudget(std::size_t memoryBudget, std::size_t numSlots) noexcept;
+
+    /// Stops the pipeline and frees device resources
+    OperationStatus release();
+
+private:
+    using Parameters = AlgorithmParameters<DataType>;
+
+    RadixSortPipeline<DataType> mPipeline;
+    std::size_t mRunSize{0U};
+    std::size_t mNumSlots{0U};
+};
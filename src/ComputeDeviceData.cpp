@@ -4,30 +4,58 @@
 
 #include <cstdint>
 #include <iostream>
+#include <limits>
 #include <string>
+#include <type_traits>
 
 template <typename DataType>
 ComputeDeviceData<DataType>::ComputeDeviceData(
     cl::Context Context,
-    size_t buffer_size
+    size_t buffer_size,
+    const RadixSortConfig& config,
+    const HostSpans<DataType>* hostSpans
 )
 {
+    // positions of more than 2^32-1 keys need 64-bit histograms
+    m_indexSize = buffer_size > std::numeric_limits<cl_uint>::max()
+        ? sizeof(cl_ulong)
+        : sizeof(cl_uint);
+
     kernelNames.emplace_back("histogram");
     kernelNames.emplace_back("scanhistograms");
     kernelNames.emplace_back("pastehistograms");
     kernelNames.emplace_back("reorder");
+    kernelNames.emplace_back("localsort");
+    kernelNames.emplace_back("keyrange");
+    kernelNames.emplace_back("presortedness");
+    kernelNames.emplace_back("runstarts");
+    kernelNames.emplace_back("reversekeys");
+    kernelNames.emplace_back("mergeruns");
+    kernelNames.emplace_back("samplekeys");
+    kernelNames.emplace_back("countkeys");
+    kernelNames.emplace_back("scancounts");
+    kernelNames.emplace_back("expandcounts");
+    kernelNames.emplace_back("selecthistogram");
+    kernelNames.emplace_back("partitionselect");
+    kernelNames.emplace_back("reorderpairs");
+    kernelNames.emplace_back("initpermutation");
+    kernelNames.emplace_back("segmentreduce");
+    kernelNames.emplace_back("segmentscan");
+    kernelNames.emplace_back("segmentemit");
 
 	// allocate device resources
     const auto createBufferAndCheck = [Context](
             auto& target,
-            auto sizeInBytes) {
+            auto sizeInBytes,
+            void* hostPtr = nullptr) {
         cl_int clError{CL_SUCCESS};
 
-#pragma message("Consider using CL_MEM_USE_HOST_PTR for user-provided memory")
-        constexpr auto hostPtr = nullptr;
+        const cl_mem_flags flags = hostPtr
+            ? CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR
+            : CL_MEM_READ_WRITE;
         target = cl::Buffer(
             Context,
-            CL_MEM_READ_WRITE,
+            flags,
             sizeInBytes,
             hostPtr,
             &clError
@@ -41,7 +69,8 @@ ComputeDeviceData<DataType>::ComputeDeviceData(
 
     createBufferAndCheck(
         m_dMemoryMap["inputKeys"],
-        sizeof(DataType) * buffer_size
+        sizeof(DataType) * buffer_size,
+        hostSpans ? hostSpans->m_hKeys.data() : nullptr
     );
 
 	createBufferAndCheck(
@@ -51,7 +80,8 @@ ComputeDeviceData<DataType>::ComputeDeviceData(
 
 	createBufferAndCheck(
         m_dMemoryMap["inputPermutations"],
-        sizeof(uint32_t) * buffer_size
+        sizeof(uint32_t) * buffer_size,
+        hostSpans ? hostSpans->h_Permut.data() : nullptr
     );
 	createBufferAndCheck(
         m_dMemoryMap["outputPermutations"],
@@ -61,20 +91,121 @@ ComputeDeviceData<DataType>::ComputeDeviceData(
 	// allocate the histogram on the GPU
 	createBufferAndCheck(
         m_dMemoryMap["histograms"],
-        sizeof(uint32_t) * Parameters::_RADIX * Parameters::_NUM_ITEMS
+        m_indexSize * config.histoSize()
     );
 
 	// allocate the auxiliary histogram on GPU
 	createBufferAndCheck(
         m_dMemoryMap["globsum"],
-        sizeof(uint32_t) * Parameters::_NUM_HISTOSPLIT
+        m_indexSize * config.histoSplit
     );
 
 	// temporary vector when the sum is not needed
 	createBufferAndCheck(
         m_dMemoryMap["temp"],
-        sizeof(uint32_t) * Parameters::_NUM_HISTOSPLIT
+        m_indexSize * config.histoSplit
+    );
+
+    // segment offsets {0, n} of the whole input sorted in local memory
+    createBufferAndCheck(
+        m_dMemoryMap["localSortRange"],
+        sizeof(uint32_t) * 2U
+    );
+
+    // minimum and span of the keys the passes sort by, {0, all ones} sorts all bits
+    using UnsignedType = std::make_unsigned_t<DataType>;
+    createBufferAndCheck(
+        m_dMemoryMap["keyRange"],
+        sizeof(UnsignedType) * 2U
+    );
+    {
+        UnsignedType fullRange[2] {0U, std::numeric_limits<UnsignedType>::max()};
+        cl_int clError{CL_SUCCESS};
+        m_dMemoryMap["fullKeyRange"] = cl::Buffer(
+            Context,
+            CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+            sizeof(fullRange),
+            fullRange,
+            &clError
+        );
+        if (clError) {
+            std::cerr<<cl::util::Error(clError, "Error allocating device array").what()<<"\n";
+        }
+    }
+    // minimum and maximum of the keys per group
+    createBufferAndCheck(
+        m_dMemoryMap["groupKeyRanges"],
+        sizeof(UnsignedType) * 2U * config.groups
+    );
+
+    // descents and ascents of the keys per group
+    createBufferAndCheck(
+        m_dMemoryMap["groupOrderCounts"],
+        m_indexSize * 2U * config.groups
+    );
+    // number and positions of the run starts found, and the runs being merged
+    createBufferAndCheck(
+        m_dMemoryMap["numRunStarts"],
+        sizeof(cl_uint)
+    );
+    createBufferAndCheck(
+        m_dMemoryMap["runStarts"],
+        m_indexSize * Parameters::_MAX_MERGE_RUNS
     );
+    createBufferAndCheck(
+        m_dMemoryMap["runOffsets"],
+        m_indexSize * (Parameters::_MAX_MERGE_RUNS + 1U)
+    );
+
+    // counts of the counting sort with a flag for keys missing from the dictionary,
+    // the sample it is drawn from and the distinct sampled keys
+    createBufferAndCheck(
+        m_dMemoryMap["counts"],
+        sizeof(cl_uint) * (Parameters::_MAX_COUNTING_RANGE + 1U)
+    );
+    createBufferAndCheck(
+        m_dMemoryMap["countingSample"],
+        sizeof(DataType) * Parameters::_COUNTING_SAMPLE_SIZE
+    );
+    createBufferAndCheck(
+        m_dMemoryMap["countingDictionary"],
+        sizeof(DataType) * Parameters::_MAX_COUNTING_DICTIONARY
+    );
+    // The radix select counts its digits in the counts of the counting sort,
+    // the partition around the selected key advances an offset per part
+    createBufferAndCheck(
+        m_dMemoryMap["selectOffsets"],
+        sizeof(cl_uint) * 3U
+    );
+
+    // records of the reduction by key per work item: the segment heads with
+    // their total appended by the scan, and the count, 64-bit sum, minimum
+    // and maximum of the values after the last head, sized for values of any type
+    createBufferAndCheck(
+        m_dMemoryMap["segmentHeads"],
+        sizeof(cl_uint) * (config.numItems() + 1U)
+    );
+    createBufferAndCheck(
+        m_dMemoryMap["segmentCounts"],
+        sizeof(cl_uint) * config.numItems()
+    );
+    createBufferAndCheck(
+        m_dMemoryMap["segmentSums"],
+        sizeof(cl_ulong) * config.numItems()
+    );
+    createBufferAndCheck(
+        m_dMemoryMap["segmentMins"],
+        sizeof(cl_ulong) * config.numItems()
+    );
+    createBufferAndCheck(
+        m_dMemoryMap["segmentMaxs"],
+        sizeof(cl_ulong) * config.numItems()
+    );
+
+    if (hostSpans) {
+        m_hostKeys = m_dMemoryMap["inputKeys"];
+        m_hostPermutations = m_dMemoryMap["inputPermutations"];
+    }
 }
 
 // Specialize ComputeDeviceData for exactly these four types.
@@ -4,9 +4,13 @@
 #define CL_HPP_TARGET_OPENCL_VERSION 120
 #include <CL/opencl.hpp>
 #include "Parameters.h"
+#include "HostData.h"
+#include "RadixSortConfig.h"
+#include "RecordedPasses.h"
 
 #include <vector>
 #include <map>
+#include <memory>
 #include <string>
 
 template <typename _DataType>
@@ -15,15 +19,50 @@ struct ComputeDeviceData
 	using DataType   = _DataType;
 	using Parameters = AlgorithmParameters<DataType>;
 
-    ComputeDeviceData(cl::Context Context, size_t buffer_size);
+    /// Allocates device buffers
+    /// @param Context OpenCL context
+    /// @param buffer_size Number of keys the buffers can hold
+    /// @param config Algorithm parameters sizing the histograms
+    /// @param hostSpans If provided, input keys and permutations wrap
+    ///                  the host memory (CL_MEM_USE_HOST_PTR) instead of
+    ///                  being allocated on the device
+    ComputeDeviceData(
+        cl::Context Context,
+        size_t buffer_size,
+        const RadixSortConfig& config,
+        const HostSpans<DataType>* hostSpans = nullptr
+    );
     ~ComputeDeviceData() = default;
 
+    /// Size of key positions and histogram entries in bytes,
+    /// sizeof(cl_ulong) if buffer_size exceeds the 32-bit range
+    size_t m_indexSize{sizeof(cl_uint)};
+
     /// OpenCL program and kernels
     cl::Program			     m_Program;
     std::vector<std::string> kernelNames;
 
+    /// Kernel source without the preamble, rebuilt for other value types
+    std::string m_programCode;
+
     /// Maps kernel names to their low-level handles
     std::map<std::string, cl::Kernel> m_kernelMap;
     std::map<std::string, cl::Buffer> m_dMemoryMap;
+
+    /// Segment kernels for values of other types than the keys,
+    /// by OpenCL name of the value type
+    std::map<std::string, std::map<std::string, cl::Kernel>> m_valueKernels;
+
+    /// Buffers wrapping host memory, empty unless constructed with host spans.
+    /// Kept separately since the memory map entries are swapped between passes.
+    cl::Buffer m_hostKeys;
+    cl::Buffer m_hostPermutations;
+
+    /// Pinned staging ring (CL_MEM_ALLOC_HOST_PTR) and its persistent mappings
+    std::vector<cl::Buffer> m_stagingBuffers;
+    std::vector<void*>      m_stagingPointers;
+
+    /// Recorded pass sequences, most recently used last
+    std::vector<std::unique_ptr<RecordedPasses>> m_recordedPasses;
 };
 
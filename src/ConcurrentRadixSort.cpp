@@ -0,0 +1,142 @@
+#include "ConcurrentRadixSort.h"
+
+#include <CL/Utils/Error.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <numeric>
+
+template <typename DataType>
+OperationStatus ConcurrentRadixSort<DataType>::initialize(
+    cl::Device Device,
+    cl::Context Context,
+    std::size_t maxKeys,
+    std::size_t numInstances,
+    QueueMode mode
+)
+{
+    using S = OperationStatus;
+    mMaxKeys = maxKeys;
+
+    mQueueMode = mode;
+    const auto supported = Device.getInfo<CL_DEVICE_QUEUE_PROPERTIES>();
+    if (mode == QueueMode::OUT_OF_ORDER && (supported & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE) == 0U) {
+        mQueueMode = QueueMode::QUEUE_POOL;
+    }
+
+    // All instances share the out-of-order queue
+    cl::CommandQueue sharedQueue;
+    if (mQueueMode == QueueMode::OUT_OF_ORDER) {
+        cl_int clError{CL_SUCCESS};
+        sharedQueue = cl::CommandQueue(Context, Device, CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE, &clError);
+        if (clError) {
+            std::cerr<<cl::util::Error(clError, "Failed to create out-of-order queue").what()<<"\n";
+            return S::INITIALIZATION_FAILED;
+        }
+    }
+
+    for (std::size_t i = 0U; i < numInstances; i++) {
+        auto instance = std::make_unique<Instance>();
+        if (mQueueMode == QueueMode::OUT_OF_ORDER) {
+            instance->queue = sharedQueue;
+        } else {
+            cl_int clError{CL_SUCCESS};
+            instance->queue = cl::CommandQueue(Context, Device, 0, &clError);
+            if (clError) {
+                std::cerr<<cl::util::Error(clError, "Failed to create pooled queue").what()<<"\n";
+                return S::INITIALIZATION_FAILED;
+            }
+        }
+
+        const auto numRounded = instance->sorter.Resize(maxKeys);
+        auto& buffers {instance->hostBuffers};
+        buffers.m_hKeys.resize(numRounded);
+        buffers.m_hResultFromGPU.resize(numRounded);
+        buffers.h_Permut.resize(numRounded);
+        buffers.m_hHistograms.resize(Parameters::_RADIX * Parameters::_NUM_ITEMS);
+        buffers.m_hGlobsum.resize(Parameters::_NUM_HISTOSPLIT);
+
+        HostSpans<DataType> spans {
+            {buffers.m_hKeys.data(), buffers.m_hKeys.size()},
+            {buffers.m_hHistograms.data(), buffers.m_hHistograms.size()},
+            {buffers.m_hGlobsum.data(), buffers.m_hGlobsum.size()},
+            {buffers.h_Permut.data(), buffers.h_Permut.size()},
+            {buffers.m_hResultFromGPU.data(), buffers.m_hResultFromGPU.size()},
+        };
+        const auto status = instance->sorter.initialize(Device, Context, maxKeys, spans);
+        if (status != S::OK) {
+            return status;
+        }
+        mInstances.push_back(std::move(instance));
+    }
+    return mInstances.empty() ? S::INITIALIZATION_FAILED : S::OK;
+}
+
+template <typename DataType>
+void ConcurrentRadixSort<DataType>::Complete(Instance& instance)
+{
+    if (instance.pending.event()() == nullptr) {
+        return;
+    }
+    instance.pending.wait();
+    std::copy_n(instance.hostBuffers.m_hResultFromGPU.begin(), instance.target.size(), instance.target.begin());
+    instance.pending = SortHandle{};
+    instance.target = {};
+}
+
+template <typename DataType>
+OperationStatus ConcurrentRadixSort<DataType>::sort(std::span<const std::span<DataType>> inputs)
+{
+    if (mInstances.empty()) {
+        return OperationStatus::INITIALIZATION_FAILED;
+    }
+    if (std::ranges::any_of(inputs, [this](const auto& input) { return input.size() > mMaxKeys; })) {
+        return OperationStatus::RESIZE_FAILED;
+    }
+
+    // Inputs go round robin to the instances. The host buffers of an instance
+    // are refilled once its previous sort has completed, the others keep running.
+    for (std::size_t i = 0U; i < inputs.size(); i++) {
+        auto& instance = *mInstances[i % mInstances.size()];
+        Complete(instance);
+
+        // Pad with the maximum so that padding sorts behind the input
+        auto& buffers {instance.hostBuffers};
+        const auto& input = inputs[i];
+        std::copy(input.begin(), input.end(), buffers.m_hKeys.begin());
+        std::fill(buffers.m_hKeys.begin() + input.size(), buffers.m_hKeys.end(), std::numeric_limits<DataType>::max());
+        std::iota(buffers.h_Permut.begin(), buffers.h_Permut.end(), 0U);
+
+        instance.target = input;
+        instance.pending = instance.sorter.sortAsync(instance.queue);
+    }
+
+    for (auto& instance : mInstances) {
+        Complete(*instance);
+    }
+    return OperationStatus::OK;
+}
+
+template <typename DataType>
+QueueMode ConcurrentRadixSort<DataType>::queueMode() const noexcept
+{
+    return mQueueMode;
+}
+
+template <typename DataType>
+OperationStatus ConcurrentRadixSort<DataType>::release()
+{
+    for (auto& instance : mInstances) {
+        Complete(*instance);
+        instance->sorter.release();
+    }
+    mInstances.clear();
+    return OperationStatus::OK;
+}
+
+// Specialize ConcurrentRadixSort for the supported types.
+template class ConcurrentRadixSort < int32_t >;
+template class ConcurrentRadixSort < int64_t >;
+template class ConcurrentRadixSort < uint32_t >;
+template class ConcurrentRadixSort < uint64_t >;
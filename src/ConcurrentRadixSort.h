@@ -0,0 +1,78 @@
+#pragma once
+
+#define CL_HPP_MINIMUM_OPENCL_VERSION 120
+#define CL_HPP_TARGET_OPENCL_VERSION 120
+#include <CL/opencl.hpp>
+
+#include "RadixSortGPU.h"
+#include "HostData.h"
+#include "SortHandle.h"
+#include "OperationStatus.h"
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <vector>
+
+/// How concurrent sorts are issued to the device
+enum class QueueMode {
+    /// A single out-of-order queue, sorts are ordered by their events only
+    OUT_OF_ORDER,
+    /// One in-order queue per sorter instance
+    QUEUE_POOL,
+};
+
+/// Sorts many independent inputs with several sorter instances in flight,
+/// so that sorts too small to fill the device run side by side.
+/// Commands of a sort depend on each other through events only,
+/// an instance is reused once its previous sort has completed.
+/// @tparam DataType Type of data to be sorted
+template <typename DataType>
+class ConcurrentRadixSort
+{
+public:
+    /// Creates sorter instances and their queues
+    /// @param Device OpenCL device
+    /// @param Context OpenCL context
+    /// @param maxKeys Maximum number of keys per input
+    /// @param numInstances Number of sorts in flight
+    /// @param mode Requested queue mode, falls back to a queue pool
+    ///             if the device has no out-of-order queues
+    OperationStatus initialize(
+        cl::Device Device,
+        cl::Context Context,
+        std::size_t maxKeys,
+        std::size_t numInstances = 4U,
+        QueueMode mode = QueueMode::OUT_OF_ORDER
+    );
+
+    /// Sorts every input in place
+    /// @param inputs Independent key ranges, at most maxKeys keys each
+    OperationStatus sort(std::span<const std::span<DataType>> inputs);
+
+    /// Returns queue mode in effect
+    QueueMode queueMode() const noexcept;
+
+    /// Frees device resources
+    OperationStatus release();
+
+private:
+    using Parameters = AlgorithmParameters<DataType>;
+
+    struct Instance {
+        RadixSortGPU<DataType> sorter;
+        HostData<DataType> hostBuffers;
+        cl::CommandQueue queue;
+        /// Completion of the sort in flight
+        SortHandle pending;
+        /// Input the pending sort writes back to
+        std::span<DataType> target;
+    };
+
+    /// Waits for the sort in flight on an instance and copies its result back
+    void Complete(Instance& instance);
+
+    std::vector<std::unique_ptr<Instance>> mInstances;
+    std::size_t mMaxKeys{0U};
+    QueueMode mQueueMode{QueueMode::OUT_OF_ORDER};
+};
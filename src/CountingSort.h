@@ -0,0 +1,129 @@
+#pragma once
+
+#include "Parameters.h"
+#include "Partition.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/// Returns a regular sample of keys, taken at the midpoints of
+/// sampleSize equal parts
+template <typename T>
+std::vector<T> sampleKeys(std::span<const T> keys, std::size_t sampleSize)
+{
+    const auto n = keys.size();
+    sampleSize = std::min(n, sampleSize);
+    std::vector<T> sample(sampleSize);
+    for (std::size_t i = 0U; i < sampleSize; i++) {
+        sample[i] = keys[(2U * i + 1U) * n / (2U * sampleSize)];
+    }
+    return sample;
+}
+
+/// Returns the ascending distinct keys of a sample
+/// @return Distinct keys, empty if there are more than maxDistinct
+template <typename T>
+std::vector<T> distinctKeys(std::vector<T> sample, std::size_t maxDistinct)
+{
+    std::ranges::sort(sample);
+    const auto [last, end] = std::ranges::unique(sample);
+    sample.erase(last, end);
+    if (sample.size() > maxDistinct) {
+        sample.clear();
+    }
+    return sample;
+}
+
+/// Sorts keys with a single counting pass: one histogram over the bins,
+/// then every bin is expanded into its keys. Bins are the values between
+/// minimum and maximum if they span at most _MAX_COUNTING_RANGE values,
+/// otherwise the distinct keys of a sample if there are few of them.
+/// @param keys Keys to be sorted
+/// @param numThreads Number of threads counting, 0 selects the hardware concurrency
+/// @return false if the keys do not fit either kind of bins, they are left untouched then
+template <typename T>
+bool countingSort(std::span<T> keys, std::size_t numThreads = 0U)
+{
+    using U = std::make_unsigned_t<T>;
+    using Parameters = AlgorithmParameters<T>;
+    const auto n = keys.size();
+    if (n < 2U) {
+        return false;
+    }
+    numThreads = partitionThreads(n, numThreads);
+    const auto forEachChunk = [&](auto&& body) {
+        std::vector<std::thread> threads;
+        for (std::size_t t = 1U; t < numThreads; t++) {
+            threads.emplace_back(body, t, n * t / numThreads, n * (t + 1U) / numThreads);
+        }
+        body(0U, 0U, n / numThreads);
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    };
+
+    std::vector<U> minima(numThreads, std::numeric_limits<U>::max());
+    std::vector<U> maxima(numThreads, 0U);
+    forEachChunk([&](std::size_t t, std::size_t begin, std::size_t end) {
+        for (auto i = begin; i < end; i++) {
+            minima[t] = std::min(minima[t], orderedKey(keys[i]));
+            maxima[t] = std::max(maxima[t], orderedKey(keys[i]));
+        }
+    });
+    const auto minKey = *std::ranges::min_element(minima);
+    const auto span = static_cast<U>(*std::ranges::max_element(maxima) - minKey);
+
+    // A wide range may still hold few distinct values, keys missing
+    // from the sample are only found while counting
+    std::vector<T> dictionary;
+    if (span >= Parameters::_MAX_COUNTING_RANGE) {
+        dictionary = distinctKeys(
+            sampleKeys(std::span<const T>(keys), Parameters::_COUNTING_SAMPLE_SIZE),
+            Parameters::_MAX_COUNTING_DICTIONARY
+        );
+        if (dictionary.empty()) {
+            return false;
+        }
+    }
+    const auto numBins = dictionary.empty() ? std::size_t{span} + 1U : dictionary.size();
+
+    std::vector<std::size_t> counts(numThreads * numBins, 0U);
+    std::vector<char> missed(numThreads, 0);
+    forEachChunk([&](std::size_t t, std::size_t begin, std::size_t end) {
+        auto* chunkCounts = counts.data() + t * numBins;
+        for (auto i = begin; i < end; i++) {
+            if (dictionary.empty()) {
+                chunkCounts[static_cast<U>(orderedKey(keys[i]) - minKey)]++;
+                continue;
+            }
+            const auto it = std::ranges::lower_bound(dictionary, keys[i]);
+            if (it == dictionary.end() || *it != keys[i]) {
+                missed[t] = 1;
+                return;
+            }
+            chunkCounts[static_cast<std::size_t>(it - dictionary.begin())]++;
+        }
+    });
+    if (std::ranges::find(missed, 1) != missed.end()) {
+        return false;
+    }
+
+    // orderedKey() flips the sign bit, flipping it again restores the key
+    auto out = keys.begin();
+    for (std::size_t bin = 0U; bin < numBins; bin++) {
+        std::size_t count = 0U;
+        for (std::size_t t = 0U; t < numThreads; t++) {
+            count += counts[t * numBins + bin];
+        }
+        const auto key = dictionary.empty()
+            ? static_cast<T>(orderedKey(static_cast<T>(minKey + bin)))
+            : dictionary[bin];
+        out = std::fill_n(out, count, key);
+    }
+    return true;
+}
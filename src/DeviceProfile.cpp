@@ -0,0 +1,100 @@
+#include "DeviceProfile.h"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <system_error>
+
+std::filesystem::path DeviceProfile::PathFor(cl::Device Device)
+{
+    namespace fs = std::filesystem;
+    const auto directory = [&]() -> fs::path {
+        if (const auto* dir = std::getenv("RADIXSORT_PROFILE_DIR")) {
+            return dir;
+        }
+        if (const auto* cache = std::getenv("XDG_CACHE_HOME")) {
+            return fs::path(cache) / "radixsort";
+        }
+        if (const auto* home = std::getenv("HOME")) {
+            return fs::path(home) / ".cache" / "radixsort";
+        }
+        return fs::temp_directory_path() / "radixsort";
+    }();
+
+    // a driver update may change the best parameters
+    auto name = Device.getInfo<CL_DEVICE_NAME>() + "-" + Device.getInfo<CL_DRIVER_VERSION>();
+    std::ranges::replace_if(name, [](unsigned char c) { return !std::isalnum(c) && c != '.' && c != '-'; }, '_');
+    return directory / (name + ".json");
+}
+
+std::optional<DeviceProfile> DeviceProfile::Load(const std::filesystem::path& path)
+{
+    std::ifstream file(path);
+    if (!file) {
+        return std::nullopt;
+    }
+    const auto json = nlohmann::json::parse(file, nullptr, false);
+    if (json.is_discarded() || !json.is_object()) {
+        return std::nullopt;
+    }
+
+    // entries of the wrong type throw, the profile is ignored then
+    try {
+        DeviceProfile profile;
+        profile.device = json.value("device", "");
+        profile.driver = json.value("driver", "");
+        if (const auto configs = json.find("configs"); configs != json.end() && configs->is_object()) {
+            for (const auto& [typeName, entry] : configs->items()) {
+                if (!entry.is_object()) {
+                    continue;
+                }
+                RadixSortConfig config;
+                config.itemsPerGroup = entry.value("itemsPerGroup", config.itemsPerGroup);
+                config.groups = entry.value("groups", config.groups);
+                config.histoSplit = entry.value("histoSplit", config.histoSplit);
+                config.bitsPerRadix = entry.value("bitsPerRadix", config.bitsPerRadix);
+                profile.configs[typeName] = {config, entry.value("time", 0.0)};
+            }
+        }
+        return profile;
+    } catch (const nlohmann::json::exception&) {
+        return std::nullopt;
+    }
+}
+
+bool DeviceProfile::save(const std::filesystem::path& path) const
+{
+    std::error_code error;
+    if (path.has_parent_path()) {
+        std::filesystem::create_directories(path.parent_path(), error);
+    }
+
+    nlohmann::json json;
+    json["device"] = device;
+    json["driver"] = driver;
+    json["configs"] = nlohmann::json::object();
+    for (const auto& [typeName, entry] : configs) {
+        json["configs"][typeName] = {
+            {"itemsPerGroup", entry.config.itemsPerGroup},
+            {"groups", entry.config.groups},
+            {"histoSplit", entry.config.histoSplit},
+            {"bitsPerRadix", entry.config.bitsPerRadix},
+            {"time", entry.time},
+        };
+    }
+
+    std::ofstream file(path);
+    file << json.dump(2) << "\n";
+    return static_cast<bool>(file);
+}
+
+std::optional<RadixSortConfig> DeviceProfile::find(const std::string& typeName) const
+{
+    if (const auto it = configs.find(typeName); it != configs.end()) {
+        return it->second.config;
+    }
+    return std::nullopt;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#define CL_HPP_MINIMUM_OPENCL_VERSION 120
+#define CL_HPP_TARGET_OPENCL_VERSION 120
+#include <CL/opencl.hpp>
+
+#include "RadixSortConfig.h"
+
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string>
+
+/// Tuned algorithm parameters of one device, per key type.
+/// Stored as JSON, e.g.
+/// {
+///   "device": "...", "driver": "...",
+///   "configs": {
+///     "int": {"itemsPerGroup": 128, "groups": 64, "histoSplit": 512, "bitsPerRadix": 4, "time": 1.5}
+///   }
+/// }
+struct DeviceProfile
+{
+    /// Tuned configuration and the time it was measured with
+    struct Entry {
+        RadixSortConfig config;
+        /// Mean time per sort in ms over the tuning datasets
+        double time{0.0};
+    };
+
+    std::string device;
+    std::string driver;
+    /// Entries by OpenCL name of the key type
+    std::map<std::string, Entry> configs;
+
+    /// Returns location of the profile of a device. Profiles are kept in
+    /// RADIXSORT_PROFILE_DIR, $XDG_CACHE_HOME/radixsort or ~/.cache/radixsort.
+    /// @param Device OpenCL device
+    static std::filesystem::path PathFor(cl::Device Device);
+
+    /// Reads a profile
+    /// @return Profile, empty if the file is missing or malformed
+    static std::optional<DeviceProfile> Load(const std::filesystem::path& path);
+
+    /// Writes the profile, creating its directory
+    /// @return true on success
+    bool save(const std::filesystem::path& path) const;
+
+    /// Returns configuration tuned for a key type
+    /// @param typeName OpenCL name of the key type
+    std::optional<RadixSortConfig> find(const std::string& typeName) const;
+};
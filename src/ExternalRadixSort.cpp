@@ -0,0 +1,419 @@
+#include "ExternalRadixSort.h"
+
+#include "Common/CTimer.h"
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <queue>
+#include <random>
+#include <sstream>
+#include <system_error>
+
+namespace {
+
+/// Sequential reader of a run, the next block is read while the current one is consumed
+template <typename DataType>
+class RunReader
+{
+public:
+    RunReader(const std::filesystem::path& path, std::size_t blockKeys) :
+        mFile(path, std::ios::binary),
+        mCurrent(blockKeys),
+        mNext(blockKeys)
+    {
+        Prefetch();
+    }
+
+    /// Makes the next block current, returns false at the end of the run
+    /// or if reading failed, see Failed()
+    /// @param[in,out] waitTime Accumulates the time waited for the disk in ms
+    bool Advance(double& waitTime)
+    {
+        CTimer timer;
+        timer.Start();
+        const auto numKeys = mPending.get();
+        timer.Stop();
+        waitTime += timer.GetElapsedMilliseconds();
+
+        std::swap(mCurrent, mNext);
+        mSize = numKeys;
+        mPosition = 0U;
+        if (numKeys > 0U) {
+            Prefetch();
+        }
+        return numKeys > 0U;
+    }
+
+    /// Set if the run could not be opened or read, it ended early
+    bool Failed() const noexcept { return mFailed; }
+    bool Empty() const noexcept { return mPosition == mSize; }
+    DataType Front() const noexcept { return mCurrent[mPosition]; }
+    void Pop() noexcept { mPosition++; }
+
+private:
+    void Prefetch()
+    {
+        mPending = std::async(std::launch::async, [this]() {
+            mFile.read(reinterpret_cast<char*>(mNext.data()), sizeof(DataType) * mNext.size());
+            // the end of the run only sets eofbit and failbit
+            if (!mFile.is_open() || mFile.bad()) {
+                mFailed = true;
+                return std::size_t{0U};
+            }
+            return static_cast<std::size_t>(mFile.gcount()) / sizeof(DataType);
+        });
+    }
+
+    std::ifstream mFile;
+    std::vector<DataType> mCurrent;
+    std::vector<DataType> mNext;
+    std::future<std::size_t> mPending;
+    std::size_t mSize{0U};
+    std::size_t mPosition{0U};
+    /// Written by the pending read, read after waiting for it
+    bool mFailed{false};
+};
+
+/// Sequential writer, a full block is written while the next one is filled
+template <typename DataType>
+class RunWriter
+{
+public:
+    RunWriter(const std::filesystem::path& path, std::size_t blockKeys) :
+        mFile(path, std::ios::binary | std::ios::trunc),
+        mBlockKeys(blockKeys)
+    {
+        mCurrent.reserve(blockKeys);
+        mWriting.reserve(blockKeys);
+    }
+
+    void Push(DataType key, double& waitTime)
+    {
+        mCurrent.push_back(key);
+        if (mCurrent.size() == mBlockKeys) {
+            Flush(waitTime);
+        }
+    }
+
+    /// Writes pending keys, returns false on write errors
+    bool Close(double& waitTime)
+    {
+        Flush(waitTime);
+        Wait(waitTime);
+        mFile.close();
+        return !mFile.fail();
+    }
+
+private:
+    void Wait(double& waitTime)
+    {
+        if (mPending.valid()) {
+            CTimer timer;
+            timer.Start();
+            mPending.get();
+            timer.Stop();
+            waitTime += timer.GetElapsedMilliseconds();
+        }
+    }
+
+    void Flush(double& waitTime)
+    {
+        Wait(waitTime);
+        std::swap(mCurrent, mWriting);
+        mCurrent.clear();
+        mPending = std::async(std::launch::async, [this]() {
+            mFile.write(reinterpret_cast<const char*>(mWriting.data()), sizeof(DataType) * mWriting.size());
+        });
+    }
+
+    std::ofstream mFile;
+    std::size_t mBlockKeys;
+    std::vector<DataType> mCurrent;
+    std::vector<DataType> mWriting;
+    std::future<void> mPending;
+};
+
+/// Removes temporary files and their directory when leaving scope
+struct TemporaryFiles {
+    std::filesystem::path directory;
+    std::vector<std::filesystem::path> paths;
+    ~TemporaryFiles()
+    {
+        std::error_code error;
+        for (const auto& path : paths) {
+            std::filesystem::remove(path, error);
+        }
+        if (!directory.empty()) {
+            std::filesystem::remove(directory, error);
+        }
+    }
+};
+
+/// Creates a directory of a unique name in parent, so that concurrent
+/// sorts sharing the temporary directory do not overwrite their runs
+/// @return Path of the new directory, empty if it could not be created
+std::filesystem::path CreateUniqueDirectory(const std::filesystem::path& parent)
+{
+    constexpr auto maxAttempts = 16;
+    std::random_device device;
+    std::mt19937_64 generator(device());
+    for (auto attempt = 0; attempt < maxAttempts; attempt++) {
+        std::ostringstream name;
+        name << "radixsort_" << std::hex << generator();
+        const auto path = parent / name.str();
+        std::error_code error;
+        // fails if the name is taken
+        if (std::filesystem::create_directory(path, error)) {
+            return path;
+        }
+        if (error) {
+            break;
+        }
+    }
+    return {};
+}
+
+} // namespace
+
+template <typename DataType>
+OperationStatus ExternalRadixSort<DataType>::initialize(
+    cl::Device Device,
+    cl::Context Context,
+    const ExternalSortOptions& options
+)
+{
+    mOptions = options;
+    mQueue = cl::CommandQueue(Context, Device);
+    return mSorter.initialize(Device, Context, options.calibrationFile);
+}
+
+template <typename DataType>
+std::size_t ExternalRadixSort<DataType>::MaxFanIn() const noexcept
+{
+    // every run and the output need two blocks, current and in flight
+    const auto numBlocks = mOptions.memoryBudget / std::max<std::size_t>(mOptions.minMergeBlock, sizeof(DataType));
+    return std::max<std::size_t>(numBlocks / 2U, 3U) - 1U;
+}
+
+template <typename DataType>
+void ExternalRadixSort<DataType>::Report(const std::string& message) const
+{
+    if (mOptions.progress) {
+        *mOptions.progress << message << std::endl;
+    }
+}
+
+template <typename DataType>
+OperationStatus ExternalRadixSort<DataType>::sortFile(
+    const std::filesystem::path& input,
+    const std::filesystem::path& output
+)
+{
+    using S = OperationStatus;
+    mStatistics = {};
+
+    std::error_code error;
+    const auto fileSize = std::filesystem::file_size(input, error);
+    if (error || fileSize % sizeof(DataType) != 0U) {
+        std::cerr << "Input " << input << " is not a file of " << sizeof(DataType) << " byte keys\n";
+        return S::LOADING_SOURCE_FAILED;
+    }
+    mStatistics.numKeys = fileSize / sizeof(DataType);
+
+    // runs hold the whole input, intermediate merge passes as much again
+    const auto available = std::filesystem::space(mOptions.tempDirectory, error).available;
+    const auto limit = mOptions.tempSpaceLimit ? mOptions.tempSpaceLimit : available;
+    if (fileSize > std::min(limit, available)) {
+        std::cerr << "Input of " << fileSize << " bytes exceeds the temporary space of " << std::min(limit, available) << " bytes\n";
+        return S::HOST_BUFFERS_FAILED;
+    }
+
+    TemporaryFiles temporaries;
+    temporaries.directory = CreateUniqueDirectory(mOptions.tempDirectory);
+    if (temporaries.directory.empty()) {
+        std::cerr << "Creating a directory for the runs in " << mOptions.tempDirectory << " failed\n";
+        return S::HOST_BUFFERS_FAILED;
+    }
+    mRunDirectory = temporaries.directory;
+    auto status = CreateRuns(input, temporaries.paths);
+    if (status != S::OK) {
+        return status;
+    }
+    mStatistics.numRuns = temporaries.paths.size();
+
+    // intermediate passes until all runs can be merged at once
+    auto runs = temporaries.paths;
+    const auto fanIn = MaxFanIn();
+    const auto needsIntermediate = runs.size() > fanIn;
+    if (needsIntermediate && fileSize > limit / 2U) {
+        std::cerr << "Intermediate merge passes exceed the temporary space limit\n";
+        return S::HOST_BUFFERS_FAILED;
+    }
+    while (runs.size() > fanIn) {
+        std::vector<std::filesystem::path> merged;
+        for (std::size_t first = 0U; first < runs.size(); first += fanIn) {
+            const auto last = std::min(first + fanIn, runs.size());
+            auto path = mRunDirectory / ("pass" + std::to_string(mStatistics.numMergePasses)
+                + "_run" + std::to_string(merged.size()) + ".bin");
+            temporaries.paths.push_back(path);
+            status = MergeRuns({runs.begin() + first, runs.begin() + last}, path);
+            if (status != S::OK) {
+                return status;
+            }
+            merged.push_back(std::move(path));
+        }
+        // runs of the previous pass are not needed anymore
+        for (const auto& run : runs) {
+            std::filesystem::remove(run, error);
+        }
+        runs = std::move(merged);
+        mStatistics.numMergePasses++;
+    }
+
+    status = MergeRuns(runs, output);
+    mStatistics.numMergePasses++;
+    return status;
+}
+
+template <typename DataType>
+OperationStatus ExternalRadixSort<DataType>::CreateRuns(
+    const std::filesystem::path& input,
+    std::vector<std::filesystem::path>& runs
+)
+{
+    // a chunk and the scratch memory of the sort share the budget
+    const auto chunkKeys = std::max<std::size_t>(mOptions.memoryBudget / sizeof(DataType) / 2U, 1U);
+    std::vector<DataType> chunk(std::min(chunkKeys, mStatistics.numKeys));
+    std::ifstream file(input, std::ios::binary);
+
+    for (std::size_t offset = 0U; offset < mStatistics.numKeys; offset += chunk.size()) {
+        const auto numKeys = std::min(chunk.size(), mStatistics.numKeys - offset);
+        std::span<DataType> keys(chunk.data(), numKeys);
+
+        CTimer timer;
+        timer.Start();
+        file.read(reinterpret_cast<char*>(keys.data()), sizeof(DataType) * numKeys);
+        timer.Stop();
+        mStatistics.timeRead += timer.GetElapsedMilliseconds();
+        if (!file) {
+            std::cerr << "Reading input failed\n";
+            return OperationStatus::LOADING_SOURCE_FAILED;
+        }
+
+        timer.Start();
+        const auto status = mSorter.sort(mQueue, keys);
+        timer.Stop();
+        mStatistics.timeSort += timer.GetElapsedMilliseconds();
+        if (status != OperationStatus::OK) {
+            return status;
+        }
+
+        // the whole run is written with one sequential write
+        auto path = mRunDirectory / ("run" + std::to_string(runs.size()) + ".bin");
+        runs.push_back(path);
+        timer.Start();
+        std::ofstream run(path, std::ios::binary | std::ios::trunc);
+        run.write(reinterpret_cast<const char*>(keys.data()), sizeof(DataType) * numKeys);
+        run.close();
+        timer.Stop();
+        mStatistics.timeWrite += timer.GetElapsedMilliseconds();
+        if (run.fail()) {
+            std::cerr << "Writing run " << path << " failed\n";
+            return OperationStatus::DATA_DOWNLOAD_FAILED;
+        }
+
+        std::ostringstream message;
+        message << "Sorted run " << runs.size() << " (" << offset + numKeys << "/" << mStatistics.numKeys << " keys) on "
+                << toString(mSorter.decisions().back().backend);
+        Report(message.str());
+    }
+    return OperationStatus::OK;
+}
+
+template <typename DataType>
+OperationStatus ExternalRadixSort<DataType>::MergeRuns(
+    const std::vector<std::filesystem::path>& runs,
+    const std::filesystem::path& output
+)
+{
+    // two blocks per run and two for the output share the budget
+    const auto blockKeys = std::max<std::size_t>(
+        mOptions.memoryBudget / sizeof(DataType) / (2U * (runs.size() + 1U)), 1U);
+
+    double waitRead = 0.0;
+    double waitWrite = 0.0;
+    CTimer total;
+    total.Start();
+
+    std::vector<std::unique_ptr<RunReader<DataType>>> readers;
+    using Entry = std::pair<DataType, std::size_t>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+    for (const auto& run : runs) {
+        readers.push_back(std::make_unique<RunReader<DataType>>(run, blockKeys));
+        if (readers.back()->Advance(waitRead)) {
+            heap.emplace(readers.back()->Front(), readers.size() - 1U);
+        }
+    }
+
+    std::size_t numKeys = 0U;
+    for (const auto& run : runs) {
+        numKeys += std::filesystem::file_size(run) / sizeof(DataType);
+    }
+
+    RunWriter<DataType> writer(output, blockKeys);
+    const auto reportEvery = std::max<std::size_t>(numKeys / 10U, 1U);
+    std::size_t numMerged = 0U;
+    while (!heap.empty()) {
+        const auto [key, run] = heap.top();
+        heap.pop();
+        writer.Push(key, waitWrite);
+
+        auto& reader = *readers[run];
+        reader.Pop();
+        if (!reader.Empty() || reader.Advance(waitRead)) {
+            heap.emplace(reader.Front(), run);
+        }
+        if (++numMerged % reportEvery == 0U) {
+            Report("Merged " + std::to_string(numMerged) + "/" + std::to_string(numKeys)
+                + " keys of " + std::to_string(runs.size()) + " runs");
+        }
+    }
+    const auto written = writer.Close(waitWrite);
+    total.Stop();
+
+    mStatistics.timeRead += waitRead;
+    mStatistics.timeWrite += waitWrite;
+    mStatistics.timeMerge += total.GetElapsedMilliseconds() - waitRead - waitWrite;
+    // a run that failed to read ended early, the output misses its keys
+    for (std::size_t run = 0U; run < runs.size(); run++) {
+        if (readers[run]->Failed()) {
+            std::cerr << "Reading run " << runs[run] << " failed\n";
+            return OperationStatus::LOADING_SOURCE_FAILED;
+        }
+    }
+    if (!written) {
+        std::cerr << "Writing " << output << " failed\n";
+        return OperationStatus::DATA_DOWNLOAD_FAILED;
+    }
+    return OperationStatus::OK;
+}
+
+template <typename DataType>
+const ExternalSortStatistics& ExternalRadixSort<DataType>::getStatistics() const noexcept
+{
+    return mStatistics;
+}
+
+template <typename DataType>
+OperationStatus ExternalRadixSort<DataType>::release()
+{
+    return mSorter.release();
+}
+
+// Specialize ExternalRadixSort for the supported types.
+template class ExternalRadixSort < int32_t >;
+template class ExternalRadixSort < int64_t >;
+template class ExternalRadixSort < uint32_t >;
+template class ExternalRadixSort < uint64_t >;
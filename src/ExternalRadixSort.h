@@ -0,0 +1,95 @@
+#pragma once
+
+#define CL_HPP_MINIMUM_OPENCL_VERSION 120
+#define CL_HPP_TARGET_OPENCL_VERSION 120
+#include <CL/opencl.hpp>
+
+#include "AutoRadixSort.h"
+#include "OperationStatus.h"
+
+#include <cstddef>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/// Limits and reporting of an external sort
+struct ExternalSortOptions {
+    /// Host memory used for runs and merge buffers in bytes
+    std::size_t memoryBudget{std::size_t{1U} << 30U};
+    /// Directory receiving the sorted runs, each sort creates its own subdirectory
+    std::filesystem::path tempDirectory{std::filesystem::temp_directory_path()};
+    /// Maximum size of all runs in bytes, 0 for no limit besides free space
+    std::size_t tempSpaceLimit{0U};
+    /// Smallest read-ahead block per run during merging in bytes
+    std::size_t minMergeBlock{std::size_t{1U} << 20U};
+    /// Crossover sizes of the in-memory backends, see AutoRadixSort
+    std::string calibrationFile{AutoRadixSort<int32_t>::DEFAULT_CALIBRATION_FILE};
+    /// Receives progress lines if set
+    std::ostream* progress{nullptr};
+};
+
+/// Time spent in the phases of an external sort in ms.
+/// Read and write times of the merge are the waits for read-ahead and write-behind.
+struct ExternalSortStatistics {
+    std::size_t numKeys{0U};
+    std::size_t numRuns{0U};
+    std::size_t numMergePasses{0U};
+    double timeRead{0.0};
+    double timeSort{0.0};
+    double timeWrite{0.0};
+    double timeMerge{0.0};
+    /// Time spent waiting for the disk
+    double timeIO() const noexcept { return timeRead + timeWrite; }
+    /// Time spent sorting and merging
+    double timeCPU() const noexcept { return timeSort + timeMerge; }
+};
+
+/// Sorts binary files of native endian keys that do not fit into memory.
+/// Memory sized chunks are sorted by AutoRadixSort and spilled as runs,
+/// which are then merged with a k-way merge reading ahead on every run.
+/// @tparam DataType Type of data to be sorted
+template <typename DataType>
+class ExternalRadixSort
+{
+public:
+    /// Prepares the in-memory sorter
+    /// @param Device OpenCL device
+    /// @param Context OpenCL context
+    /// @param options Memory and temp space limits
+    OperationStatus initialize(
+        cl::Device Device,
+        cl::Context Context,
+        const ExternalSortOptions& options = {}
+    );
+
+    /// Sorts the keys of input into output, which may be the same file
+    /// @param input Binary file of keys
+    /// @param output Binary file receiving the sorted keys
+    OperationStatus sortFile(
+        const std::filesystem::path& input,
+        const std::filesystem::path& output
+    );
+
+    /// Returns statistics of the last sortFile() call
+    const ExternalSortStatistics& getStatistics() const noexcept;
+
+    /// Frees device resources
+    OperationStatus release();
+
+private:
+    /// Sorts chunks of input and writes them as runs
+    OperationStatus CreateRuns(const std::filesystem::path& input, std::vector<std::filesystem::path>& runs);
+    /// Merges runs into output with read-ahead on every run
+    OperationStatus MergeRuns(const std::vector<std::filesystem::path>& runs, const std::filesystem::path& output);
+    /// Returns the number of runs merged at once within the memory budget
+    std::size_t MaxFanIn() const noexcept;
+    void Report(const std::string& message) const;
+
+    AutoRadixSort<DataType> mSorter;
+    cl::CommandQueue mQueue;
+    ExternalSortOptions mOptions;
+    ExternalSortStatistics mStatistics;
+    /// Directory of the runs of the current sort within the temporary directory
+    std::filesystem::path mRunDirectory;
+};
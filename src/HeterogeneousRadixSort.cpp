@@ -0,0 +1,204 @@
+#include "HeterogeneousRadixSort.h"
+#include "CRadixSortCPU.h"
+
+#include "Common/CTimer.h"
+#include <CL/Utils/Error.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <exception>
+#include <iostream>
+#include <thread>
+
+namespace {
+/// Smallest share of either side, keeps measuring the slower one
+constexpr double MIN_SHARE = 0.02;
+/// Weight of the latest measurement in the share
+constexpr double SHARE_SMOOTHING = 0.5;
+} // namespace
+
+template <typename DataType>
+OperationStatus HeterogeneousRadixSort<DataType>::initialize(
+    cl::Device Device,
+    cl::Context Context,
+    double deviceShare
+)
+{
+    mDevice = Device;
+    mContext = Context;
+    setDeviceShare(deviceShare);
+
+    // the largest buffer the device can allocate bounds the device share
+    const auto maxAlloc = Device.getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>();
+    mMaxDeviceKeys = maxAlloc / sizeof(DataType) / Parameters::_NUM_ITEMS * Parameters::_NUM_ITEMS;
+
+    // The device sorter starts small and grows with the largest share
+    mCapacity = 0U;
+    return Reserve(Parameters::_NUM_ITEMS);
+}
+
+template <typename DataType>
+OperationStatus HeterogeneousRadixSort<DataType>::Reserve(std::size_t numKeys)
+{
+    using S = OperationStatus;
+    if (numKeys > mMaxDeviceKeys) {
+        return S::RESIZE_FAILED;
+    }
+
+    // grow in powers of two to limit the number of program rebuilds
+    const auto required = mSorter.Resize(std::max<std::size_t>(numKeys, Parameters::_NUM_ITEMS));
+    if (required <= mCapacity) {
+        return S::OK;
+    }
+    const auto capacity = std::min(std::bit_ceil(required), mMaxDeviceKeys);
+    mSorter.release();
+    const auto status = mSorter.initialize(mDevice, mContext, capacity, HostSpans<DataType>{});
+    if (status != S::OK) {
+        return status;
+    }
+    cl_int clError{CL_SUCCESS};
+    mKeys = cl::Buffer(mContext, CL_MEM_READ_WRITE, sizeof(DataType) * capacity, nullptr, &clError);
+    if (clError) {
+        std::cerr<<cl::util::Error(clError, "Failed to create co-sort key buffer").what()<<"\n";
+        return S::HOST_BUFFERS_FAILED;
+    }
+    mCapacity = capacity;
+    return S::OK;
+}
+
+template <typename DataType>
+OperationStatus HeterogeneousRadixSort<DataType>::sort(
+    cl::CommandQueue CommandQueue,
+    std::span<DataType> keys
+)
+{
+    using S = OperationStatus;
+    using U = std::make_unsigned_t<DataType>;
+    CoSortRecord record;
+    record.numKeys = keys.size();
+    // the device share may not exceed its largest buffer
+    record.deviceShare = keys.empty()
+        ? mDeviceShare
+        : std::min(mDeviceShare, static_cast<double>(mMaxDeviceKeys) / static_cast<double>(keys.size()));
+
+    CTimer total;
+    total.Start();
+
+    // Lower key range goes to the device, upper range to the host
+    CTimer timer;
+    timer.Start();
+    mScratch.resize(keys.size());
+    const std::span<const DataType> constKeys = keys;
+    const std::vector<double> weights{record.deviceShare, 1.0 - record.deviceShare};
+    const auto bounds = partitionBounds<DataType>(constKeys, weights, PartitionScheme::TOP_BITS);
+    const auto offsets = partitionKeys<DataType>(constKeys, mScratch, std::span<const U>(bounds));
+    timer.Stop();
+    record.timePartition = timer.GetElapsedMilliseconds();
+    record.deviceKeys = offsets[1];
+    record.hostKeys = offsets[2] - offsets[1];
+
+    // The bins of the top bits are too coarse for the device buffer limit,
+    // keys are still unmodified and sorted on the host alone
+    auto status = Reserve(record.deviceKeys);
+    if (status == S::RESIZE_FAILED) {
+        RadixSortCPU<DataType>::sortParallel(keys);
+        return S::OK;
+    }
+    if (status != S::OK) {
+        return status;
+    }
+
+    const std::span<const DataType> deviceIn{mScratch.data(), record.deviceKeys};
+    const auto deviceOut = keys.first(record.deviceKeys);
+    std::exception_ptr deviceError;
+    std::thread deviceThread([&]() {
+        CTimer deviceTimer;
+        deviceTimer.Start();
+        try {
+            if (!deviceIn.empty()) {
+                const auto sizeBytes = sizeof(DataType) * deviceIn.size();
+                CommandQueue.enqueueWriteBuffer(mKeys, CL_FALSE, 0, sizeBytes, deviceIn.data());
+                status = mSorter.sortBuffer(CommandQueue, mKeys, 0U, deviceIn.size());
+                if (status == S::OK) {
+                    const auto err = CommandQueue.enqueueReadBuffer(mKeys, CL_TRUE, 0, sizeBytes, deviceOut.data());
+                    status = err == CL_SUCCESS ? S::OK : S::DATA_DOWNLOAD_FAILED;
+                }
+            }
+        } catch (...) {
+            deviceError = std::current_exception();
+        }
+        deviceTimer.Stop();
+        record.timeDevice = deviceTimer.GetElapsedMilliseconds();
+    });
+
+    // One hardware thread is left to drive the device
+    timer.Start();
+    auto hostKeys = keys.subspan(record.deviceKeys);
+    std::copy(mScratch.begin() + record.deviceKeys, mScratch.end(), hostKeys.begin());
+    const auto numHostThreads = std::max(std::thread::hardware_concurrency(), 2U) - 1U;
+    RadixSortCPU<DataType>::sortParallel(hostKeys, numHostThreads);
+    timer.Stop();
+    record.timeHost = timer.GetElapsedMilliseconds();
+
+    deviceThread.join();
+    total.Stop();
+    record.time = total.GetElapsedMilliseconds();
+    if (deviceError) {
+        std::rethrow_exception(deviceError);
+    }
+    if (status != S::OK) {
+        return status;
+    }
+
+    UpdateShare(record);
+    mRecords.push_back(record);
+    return S::OK;
+}
+
+template <typename DataType>
+void HeterogeneousRadixSort<DataType>::UpdateShare(const CoSortRecord& record) noexcept
+{
+    // Both sides are needed to compare their throughputs
+    if (record.deviceKeys == 0U || record.hostKeys == 0U
+        || record.timeDevice <= 0.0 || record.timeHost <= 0.0) {
+        return;
+    }
+    const auto deviceRate = static_cast<double>(record.deviceKeys) / record.timeDevice;
+    const auto hostRate = static_cast<double>(record.hostKeys) / record.timeHost;
+    // both sides finish together if the shares are proportional to the rates
+    const auto balanced = deviceRate / (deviceRate + hostRate);
+    setDeviceShare((1.0 - SHARE_SMOOTHING) * mDeviceShare + SHARE_SMOOTHING * balanced);
+}
+
+template <typename DataType>
+double HeterogeneousRadixSort<DataType>::deviceShare() const noexcept
+{
+    return mDeviceShare;
+}
+
+template <typename DataType>
+void HeterogeneousRadixSort<DataType>::setDeviceShare(double deviceShare) noexcept
+{
+    mDeviceShare = std::clamp(deviceShare, MIN_SHARE, 1.0 - MIN_SHARE);
+}
+
+template <typename DataType>
+const std::vector<CoSortRecord>& HeterogeneousRadixSort<DataType>::records() const noexcept
+{
+    return mRecords;
+}
+
+template <typename DataType>
+OperationStatus HeterogeneousRadixSort<DataType>::release()
+{
+    mKeys = cl::Buffer();
+    mCapacity = 0U;
+    mScratch = {};
+    return mSorter.release();
+}
+
+// Specialize HeterogeneousRadixSort for the supported types.
+template class HeterogeneousRadixSort < int32_t >;
+template class HeterogeneousRadixSort < int64_t >;
+template class HeterogeneousRadixSort < uint32_t >;
+template class HeterogeneousRadixSort < uint64_t >;
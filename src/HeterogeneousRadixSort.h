@@ -0,0 +1,89 @@
+#pragma once
+
+#define CL_HPP_MINIMUM_OPENCL_VERSION 120
+#define CL_HPP_TARGET_OPENCL_VERSION 120
+#include <CL/opencl.hpp>
+
+#include "RadixSortGPU.h"
+#include "Partition.h"
+#include "OperationStatus.h"
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+/// Split and timing of a single co-operative sort
+struct CoSortRecord {
+    std::size_t numKeys{0U};
+    /// Fraction of keys the split aimed for on the device
+    double deviceShare{0.0};
+    std::size_t deviceKeys{0U};
+    std::size_t hostKeys{0U};
+    /// Wall clock times in ms, device time includes transfers
+    double timePartition{0.0};
+    double timeDevice{0.0};
+    double timeHost{0.0};
+    double time{0.0};
+};
+
+/// Sorts keys on the device and the host cores at once. The input is split
+/// by its most significant bits into a lower device share and an upper host
+/// share, which are sorted concurrently and end up adjacent in place.
+/// The share adapts to the throughputs measured in previous sorts,
+/// so that both sides finish at about the same time.
+/// @tparam DataType Type of data to be sorted
+template <typename DataType>
+class HeterogeneousRadixSort
+{
+public:
+    /// Builds the device sorter
+    /// @param Device OpenCL device
+    /// @param Context OpenCL context
+    /// @param deviceShare Initial fraction of keys sorted on the device
+    OperationStatus initialize(
+        cl::Device Device,
+        cl::Context Context,
+        double deviceShare = 0.5
+    );
+
+    /// Sorts keys in place and updates the device share
+    /// @param CommandQueue OpenCL Command Queue of the device
+    /// @param keys Keys to be sorted
+    OperationStatus sort(
+        cl::CommandQueue CommandQueue,
+        std::span<DataType> keys
+    );
+
+    /// Returns fraction of keys the next sort puts on the device
+    double deviceShare() const noexcept;
+    /// Overrides the device share, e.g. kept from an earlier process
+    void setDeviceShare(double deviceShare) noexcept;
+
+    /// Returns one record per sort call, in call order
+    const std::vector<CoSortRecord>& records() const noexcept;
+
+    /// Frees device buffers
+    OperationStatus release();
+
+private:
+    using Parameters = AlgorithmParameters<DataType>;
+
+    /// Grows the device buffers to hold numKeys keys
+    OperationStatus Reserve(std::size_t numKeys);
+    /// Moves the share towards equal finishing times of both sides
+    void UpdateShare(const CoSortRecord& record) noexcept;
+
+    RadixSortGPU<DataType> mSorter;
+    cl::Device mDevice;
+    cl::Context mContext;
+    /// Device keys, holds mCapacity keys
+    cl::Buffer mKeys;
+    std::size_t mCapacity{0U};
+    /// Keys fitting into the largest device buffer
+    std::size_t mMaxDeviceKeys{0U};
+
+    double mDeviceShare{0.5};
+    /// Partitioned keys, reused between sorts
+    std::vector<DataType> mScratch;
+    std::vector<CoSortRecord> mRecords;
+};
@@ -4,18 +4,32 @@
 
 #include <cstdint>
 #include <algorithm>
+#include <numeric>
+
+namespace {
+
+/// Rounds up to the next multiple of the number of items
+template <typename Parameters>
+constexpr std::size_t RoundedSizeOf(std::size_t size)
+{
+    return (size + Parameters::_NUM_ITEMS - 1U) / Parameters::_NUM_ITEMS * Parameters::_NUM_ITEMS;
+}
+
+} // namespace
 
 template <typename DataType>
 HostDataWithReference<DataType>::HostDataWithReference(std::shared_ptr<Dataset<DataType>> dataset) :
-	m_resultSTLCPU(Parameters::_NUM_MAX_INPUT_ELEMS),
-	m_resultRadixSortCPU(Parameters::_NUM_MAX_INPUT_ELEMS),
+    // buffers hold the dataset rounded up to a multiple of the item count
+	m_resultSTLCPU(RoundedSizeOf<Parameters>(dataset->dataset.size())),
+	m_resultRadixSortCPU(RoundedSizeOf<Parameters>(dataset->dataset.size())),
     mHostBuffers{ }
 {
     {
-        mHostBuffers.m_hKeys.resize(Parameters::_NUM_MAX_INPUT_ELEMS);
+        const auto numRounded = RoundedSizeOf<Parameters>(dataset->dataset.size());
+        mHostBuffers.m_hKeys.resize(numRounded);
         mHostBuffers.m_hHistograms.resize(Parameters::_RADIX * Parameters::_NUM_ITEMS);
         mHostBuffers.m_hGlobsum.resize(Parameters::_NUM_HISTOSPLIT);
-        mHostBuffers.h_Permut.resize(Parameters::_NUM_MAX_INPUT_ELEMS);
+        mHostBuffers.h_Permut.resize(numRounded);
 
         std::iota(mHostBuffers.h_Permut.begin(), mHostBuffers.h_Permut.end(), 0);
     }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Parameters.h"
+#include "Common/AlignedAllocator.h"
 
 #include <vector>
 #include <memory>
@@ -31,10 +32,11 @@ struct HostBuffers
 	BufferData m_hResultFromGPU;
 };
 
+/// Owning host buffers, page aligned so that they can be used for zero-copy
 template<typename DataType>
 using HostData = HostBuffers<
-    std::vector<DataType>,
-    std::vector<uint32_t>
+    std::vector<DataType, AlignedAllocator<DataType>>,
+    std::vector<uint32_t, AlignedAllocator<uint32_t>>
 >;
 
 template<typename DataType>
@@ -0,0 +1,14 @@
+#pragma once
+
+/// Strategy for exchanging host buffers with the device
+/// @note Radix sort specific
+enum class MemoryMode {
+    /// Device-resident buffers, explicit read/write transfers
+    COPY,
+    /// Device buffers wrap the host spans (CL_MEM_USE_HOST_PTR),
+    /// synchronized via map/unmap. Meant for integrated GPUs and CPU devices.
+    ZERO_COPY,
+    /// Chunked transfers through a pinned (CL_MEM_ALLOC_HOST_PTR) staging
+    /// ring on a second queue, overlapping copies with the first histogram
+    STAGED,
+};
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <span>
+#include <thread>
+#include <vector>
+
+/// Returns the number of elements taken from a for the first diagonal
+/// elements of the stable merge of a and b (merge path co-rank)
+/// @param a First sorted range, wins ties
+/// @param b Second sorted range
+/// @param diagonal Number of merged elements, at most a.size() + b.size()
+template <typename T>
+std::size_t mergePathSplit(std::span<const T> a, std::span<const T> b, std::size_t diagonal)
+{
+    std::size_t lo = diagonal > b.size() ? diagonal - b.size() : 0U;
+    std::size_t hi = std::min(diagonal, a.size());
+    while (lo < hi) {
+        const auto mid = lo + (hi - lo) / 2U;
+        if (a[mid] <= b[diagonal - mid - 1U]) {
+            lo = mid + 1U;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/// Stable merge of two sorted ranges on several threads.
+/// The output is split into equal parts along the merge path,
+/// each thread merges the inputs of its part independently.
+/// @param out Output range of a.size() + b.size() elements, not aliasing the inputs
+/// @param numThreads Number of threads, 0 selects the hardware concurrency
+template <typename T>
+void parallelMerge(std::span<const T> a, std::span<const T> b, std::span<T> out, std::size_t numThreads = 0U)
+{
+    const auto n = a.size() + b.size();
+    if (numThreads == 0U) {
+        numThreads = std::max(std::thread::hardware_concurrency(), 1U);
+    }
+    // small merges are not worth a thread
+    constexpr std::size_t minPartSize = 1U << 14U;
+    numThreads = std::max<std::size_t>(std::min(numThreads, n / minPartSize), 1U);
+
+    const auto mergePart = [&](std::size_t part) {
+        const auto begin = n * part / numThreads;
+        const auto end = n * (part + 1U) / numThreads;
+        const auto aBegin = mergePathSplit(a, b, begin);
+        const auto aEnd = mergePathSplit(a, b, end);
+        std::merge(
+            a.begin() + aBegin, a.begin() + aEnd,
+            b.begin() + (begin - aBegin), b.begin() + (end - aEnd),
+            out.begin() + begin
+        );
+    };
+
+    std::vector<std::thread> threads;
+    for (std::size_t part = 1U; part < numThreads; part++) {
+        threads.emplace_back(mergePart, part);
+    }
+    mergePart(0U);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+/// Merges consecutive sorted runs of data in place, pairwise level by level.
+/// Every level is a sequence of parallel merges between data and scratch.
+/// @param data Concatenated sorted runs
+/// @param runOffsets Run starts, with data.size() appended
+/// @param numThreads Number of threads per merge, 0 selects the hardware concurrency
+template <typename T>
+void mergeRuns(std::span<T> data, std::vector<std::size_t> runOffsets, std::size_t numThreads = 0U)
+{
+    if (runOffsets.size() <= 2U) {
+        return;
+    }
+    std::vector<T> scratch(data.size());
+    std::span<T> input = data;
+    std::span<T> output = scratch;
+
+    while (runOffsets.size() > 2U) {
+        std::vector<std::size_t> merged{0U};
+        const auto numRuns = runOffsets.size() - 1U;
+        for (std::size_t run = 0U; run < numRuns; run += 2U) {
+            const auto begin = runOffsets[run];
+            const auto middle = runOffsets[run + 1U];
+            const auto end = run + 2U <= numRuns ? runOffsets[run + 2U] : middle;
+            parallelMerge<T>(
+                input.subspan(begin, middle - begin),
+                input.subspan(middle, end - middle),
+                output.subspan(begin, end - begin),
+                numThreads
+            );
+            merged.push_back(end);
+        }
+        runOffsets = std::move(merged);
+        std::swap(input, output);
+    }
+
+    if (input.data() != data.data()) {
+        std::ranges::copy(input, data.begin());
+    }
+}
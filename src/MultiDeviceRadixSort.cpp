@@ -0,0 +1,199 @@
+#include "MultiDeviceRadixSort.h"
+
+#include "Common/CTimer.h"
+#include <CL/Utils/Error.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <exception>
+#include <iostream>
+#include <thread>
+
+template <typename DataType>
+MultiDeviceRadixSort<DataType>::~MultiDeviceRadixSort()
+{
+    release();
+}
+
+template <typename DataType>
+OperationStatus MultiDeviceRadixSort<DataType>::initialize(
+    cl::Context Context,
+    std::vector<cl::Device> Devices,
+    PartitionScheme scheme
+)
+{
+    using S = OperationStatus;
+    mContext = Context;
+    mScheme = scheme;
+    if (Devices.empty()) {
+        Devices = Context.getInfo<CL_CONTEXT_DEVICES>();
+    }
+
+    for (const auto& device : Devices) {
+        auto slot = std::make_unique<Slot>();
+        slot->device = device;
+        slot->maxKeys = device.getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>() / sizeof(DataType);
+
+        cl_int clError{CL_SUCCESS};
+        slot->queue = cl::CommandQueue(Context, device, 0, &clError);
+        if (clError) {
+            std::cerr<<cl::util::Error(clError, "Failed to create device queue").what()<<"\n";
+            return S::INITIALIZATION_FAILED;
+        }
+        // builds the program of the device once, partitions grow it on demand
+        const auto status = Reserve(*slot, Parameters::_NUM_ITEMS);
+        if (status != S::OK) {
+            return status;
+        }
+        mSlots.push_back(std::move(slot));
+    }
+    return mSlots.empty() ? S::INITIALIZATION_FAILED : S::OK;
+}
+
+template <typename DataType>
+OperationStatus MultiDeviceRadixSort<DataType>::Reserve(Slot& slot, std::size_t numKeys)
+{
+    using S = OperationStatus;
+    if (numKeys > slot.maxKeys) {
+        return S::RESIZE_FAILED;
+    }
+
+    // grow in powers of two to limit the number of program rebuilds
+    const auto required = slot.sorter.Resize(std::max<std::size_t>(numKeys, Parameters::_NUM_ITEMS));
+    if (required <= slot.capacity) {
+        return S::OK;
+    }
+    const auto capacity = std::min(std::bit_ceil(required), slot.maxKeys);
+    slot.sorter.release();
+    const auto status = slot.sorter.initialize(slot.device, mContext, capacity, HostSpans<DataType>{});
+    if (status != S::OK) {
+        return status;
+    }
+    cl_int clError{CL_SUCCESS};
+    slot.keys = cl::Buffer(mContext, CL_MEM_READ_WRITE, sizeof(DataType) * capacity, nullptr, &clError);
+    if (clError) {
+        std::cerr<<cl::util::Error(clError, "Failed to create partition key buffer").what()<<"\n";
+        return S::HOST_BUFFERS_FAILED;
+    }
+    slot.capacity = capacity;
+    return S::OK;
+}
+
+template <typename DataType>
+OperationStatus MultiDeviceRadixSort<DataType>::SortOnDevice(
+    Slot& slot,
+    std::span<const DataType> in,
+    std::span<DataType> out
+)
+{
+    using S = OperationStatus;
+    if (in.empty()) {
+        return S::OK;
+    }
+    const auto sizeBytes = sizeof(DataType) * in.size();
+    slot.queue.enqueueWriteBuffer(slot.keys, CL_FALSE, 0, sizeBytes, in.data());
+    const auto status = slot.sorter.sortBuffer(slot.queue, slot.keys, 0U, in.size());
+    if (status != S::OK) {
+        return status;
+    }
+    const auto err = slot.queue.enqueueReadBuffer(slot.keys, CL_TRUE, 0, sizeBytes, out.data());
+    return err == CL_SUCCESS ? S::OK : S::DATA_DOWNLOAD_FAILED;
+}
+
+template <typename DataType>
+OperationStatus MultiDeviceRadixSort<DataType>::sort(std::span<DataType> keys)
+{
+    using S = OperationStatus;
+    using U = std::make_unsigned_t<DataType>;
+    const auto numSlots = mSlots.size();
+    if (numSlots == 0U) {
+        return S::INITIALIZATION_FAILED;
+    }
+
+    // A single device sorts the keys directly, without partitioning
+    std::vector<std::size_t> offsets{0U, keys.size()};
+    std::span<const DataType> input = keys;
+    if (numSlots > 1U) {
+        mScratch.resize(keys.size());
+        const std::vector<double> weights(numSlots, 1.0);
+        const std::span<const DataType> constKeys = keys;
+        const auto bounds = partitionBounds<DataType>(constKeys, weights, mScheme);
+        offsets = partitionKeys<DataType>(constKeys, mScratch, std::span<const U>(bounds));
+        input = mScratch;
+    }
+
+    // Buffers grow before any device starts, rebuilding a program is not thread safe
+    for (std::size_t i = 0U; i < numSlots; i++) {
+        const auto status = Reserve(*mSlots[i], offsets[i + 1U] - offsets[i]);
+        if (status != S::OK) {
+            return status;
+        }
+    }
+
+    mPartitions.assign(numSlots, {});
+    std::vector<S> statuses(numSlots, S::OK);
+    std::vector<std::exception_ptr> errors(numSlots);
+    const auto sortPartition = [&](std::size_t i) {
+        CTimer timer;
+        timer.Start();
+        const auto begin = offsets[i];
+        const auto count = offsets[i + 1U] - begin;
+        try {
+            statuses[i] = SortOnDevice(*mSlots[i], input.subspan(begin, count), keys.subspan(begin, count));
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+        timer.Stop();
+        mPartitions[i].deviceName = mSlots[i]->device.template getInfo<CL_DEVICE_NAME>();
+        mPartitions[i].numKeys = count;
+        mPartitions[i].time = timer.GetElapsedMilliseconds();
+    };
+
+    std::vector<std::thread> threads;
+    for (std::size_t i = 1U; i < numSlots; i++) {
+        threads.emplace_back(sortPartition, i);
+    }
+    sortPartition(0U);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (std::size_t i = 0U; i < numSlots; i++) {
+        if (errors[i]) {
+            std::rethrow_exception(errors[i]);
+        }
+        if (statuses[i] != S::OK) {
+            return statuses[i];
+        }
+    }
+    return S::OK;
+}
+
+template <typename DataType>
+std::size_t MultiDeviceRadixSort<DataType>::numDevices() const noexcept
+{
+    return mSlots.size();
+}
+
+template <typename DataType>
+const std::vector<DevicePartitionRecord>& MultiDeviceRadixSort<DataType>::lastPartitions() const noexcept
+{
+    return mPartitions;
+}
+
+template <typename DataType>
+OperationStatus MultiDeviceRadixSort<DataType>::release()
+{
+    for (auto& slot : mSlots) {
+        slot->sorter.release();
+    }
+    mSlots.clear();
+    mScratch = {};
+    return OperationStatus::OK;
+}
+
+// Specialize MultiDeviceRadixSort for the supported types.
+template class MultiDeviceRadixSort < int32_t >;
+template class MultiDeviceRadixSort < int64_t >;
+template class MultiDeviceRadixSort < uint32_t >;
+template class MultiDeviceRadixSort < uint64_t >;
@@ -0,0 +1,88 @@
+#pragma once
+
+#define CL_HPP_MINIMUM_OPENCL_VERSION 120
+#define CL_HPP_TARGET_OPENCL_VERSION 120
+#include <CL/opencl.hpp>
+
+#include "RadixSortGPU.h"
+#include "Partition.h"
+#include "OperationStatus.h"
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+/// Share of a device in the last sort
+struct DevicePartitionRecord {
+    std::string deviceName;
+    std::size_t numKeys{0U};
+    /// Wall clock time of the device including transfers in ms
+    double time{0.0};
+};
+
+/// Sorts keys on all devices of a context. The input is partitioned into
+/// disjoint key ranges on the host, every device sorts one range with its
+/// own sorter and queue, and the sorted ranges are concatenated in place.
+/// @tparam DataType Type of data to be sorted
+template <typename DataType>
+class MultiDeviceRadixSort
+{
+public:
+    MultiDeviceRadixSort() = default;
+    ~MultiDeviceRadixSort();
+
+    MultiDeviceRadixSort(const MultiDeviceRadixSort&) = delete;
+    MultiDeviceRadixSort& operator=(const MultiDeviceRadixSort&) = delete;
+
+    /// Creates a sorter and queue per device
+    /// @param Context OpenCL context of the devices
+    /// @param Devices Devices sorting a partition each, all devices of the context if empty.
+    ///                A device may be listed more than once to run several partitions on it.
+    /// @param scheme How the input is split between the devices
+    OperationStatus initialize(
+        cl::Context Context,
+        std::vector<cl::Device> Devices = {},
+        PartitionScheme scheme = PartitionScheme::SPLITTERS
+    );
+
+    /// Sorts keys in place
+    /// @param keys Keys to be sorted
+    OperationStatus sort(std::span<DataType> keys);
+
+    /// Returns number of partitions sorted concurrently
+    std::size_t numDevices() const noexcept;
+
+    /// Returns one record per device of the last sort, in key order
+    const std::vector<DevicePartitionRecord>& lastPartitions() const noexcept;
+
+    /// Frees device resources
+    OperationStatus release();
+
+private:
+    using Parameters = AlgorithmParameters<DataType>;
+
+    struct Slot {
+        cl::Device device;
+        cl::CommandQueue queue;
+        RadixSortGPU<DataType> sorter;
+        /// Device keys, holds capacity keys
+        cl::Buffer keys;
+        std::size_t capacity{0U};
+        /// Keys fitting into the largest device buffer
+        std::size_t maxKeys{0U};
+    };
+
+    /// Grows the buffers of a slot to hold numKeys keys
+    OperationStatus Reserve(Slot& slot, std::size_t numKeys);
+    /// Sorts a partition on the device of a slot
+    OperationStatus SortOnDevice(Slot& slot, std::span<const DataType> in, std::span<DataType> out);
+
+    cl::Context mContext;
+    PartitionScheme mScheme{PartitionScheme::SPLITTERS};
+    std::vector<std::unique_ptr<Slot>> mSlots;
+    /// Partitioned keys, reused between sorts
+    std::vector<DataType> mScratch;
+    std::vector<DevicePartitionRecord> mPartitions;
+};
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <limits>
 
@@ -23,10 +24,11 @@ struct AlgorithmParameters
 	inline static constexpr auto _NUM_HISTOSPLIT = 512U;
     /// Number of bits in the radix
 	inline static constexpr auto _NUM_BITS_PER_RADIX = 4U;
-	/// Max size of the sorted vector
+	/// Default size of datasets and benchmarks, larger inputs are
+	/// only bounded by device memory
 	/// @note Must be divisible by  _NUM_ITEMS_PER_GROUP * _NUM_GROUPS
 	/// (for other sizes, pad the vector with inf values)
-	inline static constexpr auto _NUM_MAX_INPUT_ELEMS = (1U << 25U);
+	inline static constexpr std::size_t _NUM_DEFAULT_INPUT_ELEMS = (1U << 25U);
 	////////////////////////////////////////////////////////
 
 	////////////////////////////////////////////////////////
@@ -50,12 +52,36 @@ struct AlgorithmParameters
     /// Number of iterations for performance testing
     /// @TODO: Make configurable at runtime
 	inline static constexpr auto _NUM_PERFORMANCE_ITERATIONS = 5U;
+    /// Upper bound of keys sorted in local memory by a single work-group
+	inline static constexpr auto _LOCAL_SORT_MAX_ELEMS = 4096U;
+    /// Upper bound of the work-group size of the local sort
+	inline static constexpr auto _LOCAL_SORT_MAX_ITEMS = 256U;
+    /// Number of chunks staged transfers are split into
+	inline static constexpr auto _NUM_STAGING_CHUNKS = 4U;
+    /// Number of pinned staging buffers in flight
+	inline static constexpr auto _NUM_STAGING_BUFFERS = 2U;
+    /// Largest number of ascending runs merged instead of radix sorted
+	inline static constexpr auto _MAX_MERGE_RUNS = 16U;
+    /// Largest number of values between minimum and maximum key sorted by counting
+	inline static constexpr auto _MAX_COUNTING_RANGE = 1U << 16U;
+    /// Number of keys sampled to find few distinct keys in a wide range
+	inline static constexpr auto _COUNTING_SAMPLE_SIZE = 4096U;
+    /// Largest number of distinct sampled keys sorted by counting
+	inline static constexpr auto _MAX_COUNTING_DICTIONARY = 1024U;
+    /// Number of keys sampled to select a sort algorithm
+	inline static constexpr auto _NUM_STRATEGY_SAMPLES = 4096U;
+    /// Number of key bits a radix select narrows down per pass
+	inline static constexpr auto _NUM_SELECT_BITS = 8U;
 	////////////////////////////////////////////////////////
 
     /// Check divisibility of works to assign correct amounts of work to groups/work-items.
     static_assert(_RADIX == 1 << _NUM_BITS_PER_RADIX);
     static_assert(_TOTALBITS % _NUM_BITS_PER_RADIX == 0);
-    static_assert(_NUM_MAX_INPUT_ELEMS % (_NUM_GROUPS * _NUM_ITEMS_PER_GROUP) == 0);
+    static_assert(_NUM_DEFAULT_INPUT_ELEMS % (_NUM_GROUPS * _NUM_ITEMS_PER_GROUP) == 0);
     static_assert((_NUM_GROUPS * _NUM_ITEMS_PER_GROUP * _RADIX) % _NUM_HISTOSPLIT == 0);
+    /// Staged chunks must cover whole groups to compute their histograms
+    static_assert(_NUM_GROUPS % _NUM_STAGING_CHUNKS == 0);
+    /// Select passes cover the key bits exactly
+    static_assert(_TOTALBITS % _NUM_SELECT_BITS == 0);
 };
 
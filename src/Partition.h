@@ -0,0 +1,190 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/// How keys are split into ranges of the key space
+enum class PartitionScheme {
+    /// Histogram of the most significant key bits, cheap but sensitive to skew within a bin
+    TOP_BITS,
+    /// Quantiles of a regular sample of the keys
+    SPLITTERS,
+};
+
+/// Returns the unsigned image of a key preserving its order,
+/// signed keys get their sign bit flipped
+template <typename T>
+constexpr std::make_unsigned_t<T> orderedKey(T key) noexcept
+{
+    using U = std::make_unsigned_t<T>;
+    constexpr U signBit = std::is_signed_v<T>
+        ? U{1U} << (std::numeric_limits<U>::digits - 1)
+        : U{0U};
+    return static_cast<U>(static_cast<U>(key) ^ signBit);
+}
+
+/// Number of threads used for a host pass over n keys
+/// @param numThreads Requested number of threads, 0 selects the hardware concurrency
+inline std::size_t partitionThreads(std::size_t n, std::size_t numThreads) noexcept
+{
+    // small inputs are not worth a thread
+    constexpr std::size_t minPartSize = 1U << 14U;
+    if (numThreads == 0U) {
+        numThreads = std::max(std::thread::hardware_concurrency(), 1U);
+    }
+    return std::max<std::size_t>(std::min(numThreads, n / minPartSize), 1U);
+}
+
+/// Returns ascending bounds splitting the keys into weights.size() partitions
+/// of approximately the given relative sizes. A key belongs to the partition
+/// given by the number of bounds not greater than its orderedKey().
+/// @param keys Keys to be partitioned
+/// @param weights Relative partition sizes, not all zero
+/// @param scheme How bounds are derived from the keys
+/// @param numThreads Number of threads, 0 selects the hardware concurrency
+template <typename T>
+std::vector<std::make_unsigned_t<T>> partitionBounds(
+    std::span<const T> keys,
+    std::span<const double> weights,
+    PartitionScheme scheme,
+    std::size_t numThreads = 0U
+)
+{
+    using U = std::make_unsigned_t<T>;
+    const auto n = keys.size();
+    const auto numParts = weights.size();
+
+    // targets as cumulative fractions of the keys
+    double totalWeight = 0.0;
+    for (const auto weight : weights) {
+        totalWeight += weight;
+    }
+    std::vector<double> targets;
+    double cumulative = 0.0;
+    for (std::size_t part = 0U; part + 1U < numParts; part++) {
+        cumulative += weights[part];
+        targets.push_back(totalWeight > 0.0 ? cumulative / totalWeight : 1.0);
+    }
+
+    std::vector<U> bounds;
+    if (scheme == PartitionScheme::SPLITTERS) {
+        constexpr std::size_t samplesPerPart = 1024U;
+        const auto numSamples = std::min(n, samplesPerPart * numParts);
+        std::vector<U> samples(numSamples);
+        for (std::size_t i = 0U; i < numSamples; i++) {
+            samples[i] = orderedKey(keys[(2U * i + 1U) * n / (2U * numSamples)]);
+        }
+        std::ranges::sort(samples);
+        for (const auto target : targets) {
+            const auto rank = static_cast<std::size_t>(target * static_cast<double>(numSamples));
+            bounds.push_back(rank < numSamples ? samples[rank] : std::numeric_limits<U>::max());
+        }
+        return bounds;
+    }
+
+    constexpr unsigned numBits = std::min(16, std::numeric_limits<U>::digits);
+    constexpr unsigned shift = std::numeric_limits<U>::digits - numBits;
+    constexpr std::size_t numBins = std::size_t{1U} << numBits;
+
+    numThreads = partitionThreads(n, numThreads);
+    std::vector<std::size_t> counts(numThreads * numBins, 0U);
+    const auto countChunk = [&](std::size_t t) {
+        const auto begin = n * t / numThreads;
+        const auto end = n * (t + 1U) / numThreads;
+        auto* chunkCounts = counts.data() + t * numBins;
+        for (auto i = begin; i < end; i++) {
+            chunkCounts[orderedKey(keys[i]) >> shift]++;
+        }
+    };
+    std::vector<std::thread> threads;
+    for (std::size_t t = 1U; t < numThreads; t++) {
+        threads.emplace_back(countChunk, t);
+    }
+    countChunk(0U);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    // the bound of a target is the first bin edge reaching it
+    std::size_t bin = 0U;
+    std::size_t below = 0U;
+    for (const auto target : targets) {
+        const auto targetKeys = static_cast<std::size_t>(target * static_cast<double>(n));
+        while (bin < numBins && below < targetKeys) {
+            for (std::size_t t = 0U; t < numThreads; t++) {
+                below += counts[t * numBins + bin];
+            }
+            bin++;
+        }
+        bounds.push_back(bin < numBins
+            ? static_cast<U>(static_cast<U>(bin) << shift)
+            : std::numeric_limits<U>::max());
+    }
+    return bounds;
+}
+
+/// Stable scatter of keys into contiguous partitions on several threads
+/// @param in Keys to be partitioned
+/// @param out Output range of in.size() keys, not aliasing in
+/// @param bounds Ascending bounds as returned by partitionBounds()
+/// @param numThreads Number of threads, 0 selects the hardware concurrency
+/// @return Offsets of the bounds.size() + 1 partitions in out, followed by in.size()
+template <typename T>
+std::vector<std::size_t> partitionKeys(
+    std::span<const T> in,
+    std::span<T> out,
+    std::span<const std::make_unsigned_t<T>> bounds,
+    std::size_t numThreads = 0U
+)
+{
+    const auto n = in.size();
+    const auto numParts = bounds.size() + 1U;
+    const auto partOf = [&](T key) {
+        return static_cast<std::size_t>(std::ranges::upper_bound(bounds, orderedKey(key)) - bounds.begin());
+    };
+
+    numThreads = partitionThreads(n, numThreads);
+    const auto forEachChunk = [&](auto&& body) {
+        std::vector<std::thread> threads;
+        for (std::size_t t = 1U; t < numThreads; t++) {
+            threads.emplace_back(body, t, n * t / numThreads, n * (t + 1U) / numThreads);
+        }
+        body(0U, 0U, n / numThreads);
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    };
+
+    std::vector<std::size_t> counts(numThreads * numParts, 0U);
+    forEachChunk([&](std::size_t t, std::size_t begin, std::size_t end) {
+        for (auto i = begin; i < end; i++) {
+            counts[t * numParts + partOf(in[i])]++;
+        }
+    });
+
+    // exclusive scan in partition major order keeps the scatter stable
+    std::vector<std::size_t> offsets(numParts + 1U);
+    std::size_t sum = 0U;
+    for (std::size_t part = 0U; part < numParts; part++) {
+        offsets[part] = sum;
+        for (std::size_t t = 0U; t < numThreads; t++) {
+            const auto count = counts[t * numParts + part];
+            counts[t * numParts + part] = sum;
+            sum += count;
+        }
+    }
+    offsets[numParts] = sum;
+
+    forEachChunk([&](std::size_t t, std::size_t begin, std::size_t end) {
+        auto* positions = counts.data() + t * numParts;
+        for (auto i = begin; i < end; i++) {
+            out[positions[partOf(in[i])]++] = in[i];
+        }
+    });
+    return offsets;
+}
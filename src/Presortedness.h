@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+/// Way a sort call was carried out, depending on the order of its input
+enum class SortPath {
+    /// Full radix sort
+    RADIX,
+    /// Keys were ascending already and left untouched
+    SORTED,
+    /// Keys were descending and got reversed
+    REVERSED,
+    /// Keys consisted of few ascending runs that got merged
+    RUN_MERGE,
+    /// Keys of a small range or few distinct values got counted
+    COUNTING,
+};
+
+/// Returns printable name of a sort path
+inline const char* toString(SortPath path) noexcept
+{
+    switch (path) {
+        case SortPath::RADIX:     return "radix";
+        case SortPath::SORTED:    return "sorted";
+        case SortPath::REVERSED:  return "reversed";
+        case SortPath::RUN_MERGE: return "run-merge";
+        case SortPath::COUNTING:  return "counting";
+    }
+    return "unknown";
+}
+
+/// Order of neighbouring keys
+struct Presortedness {
+    /// Number of positions i with keys[i] > keys[i + 1]
+    std::size_t descents{0U};
+    /// Number of positions i with keys[i] < keys[i + 1]
+    std::size_t ascents{0U};
+
+    /// Number of maximal ascending runs
+    constexpr std::size_t runs() const noexcept
+    {
+        return descents + 1U;
+    }
+};
+
+/// Selects the cheapest way to sort keys of the given order.
+/// Descending keys are reversed, which only keeps equal keys in order
+/// because they cannot be told apart.
+/// @param maxRuns Largest number of runs merged instead of radix sorted
+constexpr SortPath selectSortPath(const Presortedness& order, std::size_t maxRuns) noexcept
+{
+    if (order.descents == 0U) {
+        return SortPath::SORTED;
+    }
+    if (order.ascents == 0U) {
+        return SortPath::REVERSED;
+    }
+    return order.runs() <= maxRuns ? SortPath::RUN_MERGE : SortPath::RADIX;
+}
+
+/// Counts descents and ascents of neighbouring keys.
+/// Blocks are compared without branches so that the loop vectorizes,
+/// counting stops once no fast path of selectSortPath() applies.
+/// @param maxRuns Largest number of runs merged instead of radix sorted
+template <typename T>
+Presortedness measurePresortedness(std::span<const T> keys, std::size_t maxRuns)
+{
+    // random input is told apart within the first block
+    constexpr std::size_t blockSize = 4096U;
+    Presortedness order;
+    if (keys.size() < 2U) {
+        return order;
+    }
+    const auto numPairs = keys.size() - 1U;
+    for (std::size_t begin = 0U; begin < numPairs; begin += blockSize) {
+        const auto end = std::min(numPairs, begin + blockSize);
+        std::size_t descents = 0U;
+        std::size_t ascents = 0U;
+        for (auto i = begin; i < end; i++) {
+            descents += static_cast<std::size_t>(keys[i] > keys[i + 1U]);
+            ascents += static_cast<std::size_t>(keys[i] < keys[i + 1U]);
+        }
+        order.descents += descents;
+        order.ascents += ascents;
+        if (order.ascents > 0U && order.runs() > maxRuns) {
+            break;
+        }
+    }
+    return order;
+}
+
+/// Returns starts of the maximal ascending runs of keys with keys.size()
+/// appended, as taken by mergeRuns()
+template <typename T>
+std::vector<std::size_t> runOffsets(std::span<const T> keys)
+{
+    std::vector<std::size_t> offsets{0U};
+    for (std::size_t i = 1U; i < keys.size(); i++) {
+        if (keys[i - 1U] > keys[i]) {
+            offsets.push_back(i);
+        }
+    }
+    offsets.push_back(keys.size());
+    return offsets;
+}
@@ -0,0 +1,310 @@
+#pragma once
+
+#include "CRadixSortCPU.h"
+#include "Parameters.h"
+#include "Partition.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <numeric>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/// Key at a position of the ascending order of keys
+template <typename T>
+struct SelectedKey {
+    T key{};
+    /// Number of keys sorting before key
+    std::size_t below{0U};
+    /// Number of keys equal to key
+    std::size_t equal{0U};
+};
+
+/// Counts the digits of _NUM_SELECT_BITS bits at shift of the keys
+/// @param numThreads Number of threads, 0 selects the hardware concurrency
+template <typename T>
+std::vector<std::size_t> selectHistogram(std::span<const T> keys, std::uint32_t shift, std::size_t numThreads)
+{
+    constexpr std::size_t RADIX = std::size_t{1U} << AlgorithmParameters<T>::_NUM_SELECT_BITS;
+    const auto n = keys.size();
+    numThreads = partitionThreads(n, numThreads);
+    std::vector<std::size_t> counts(numThreads * RADIX, 0U);
+    const auto countChunk = [&](std::size_t t) {
+        auto* chunkCounts = counts.data() + t * RADIX;
+        for (auto i = n * t / numThreads; i < n * (t + 1U) / numThreads; i++) {
+            chunkCounts[(orderedKey(keys[i]) >> shift) & (RADIX - 1U)]++;
+        }
+    };
+    std::vector<std::thread> threads;
+    for (std::size_t t = 1U; t < numThreads; t++) {
+        threads.emplace_back(countChunk, t);
+    }
+    countChunk(0U);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (std::size_t t = 1U; t < numThreads; t++) {
+        for (std::size_t d = 0U; d < RADIX; d++) {
+            counts[d] += counts[t * RADIX + d];
+        }
+    }
+    counts.resize(RADIX);
+    return counts;
+}
+
+/// Returns the keys whose digit at shift is digits[i], for every i
+/// @param numThreads Number of threads, 0 selects the hardware concurrency
+template <typename T>
+std::vector<std::vector<T>> gatherDigits(
+    std::span<const T> keys,
+    std::uint32_t shift,
+    std::span<const std::size_t> digits,
+    std::size_t numThreads
+)
+{
+    constexpr std::size_t RADIX = std::size_t{1U} << AlgorithmParameters<T>::_NUM_SELECT_BITS;
+    const auto numBuckets = digits.size();
+    // digits without a bucket map past the last one
+    std::vector<std::size_t> bucketOf(RADIX, numBuckets);
+    for (std::size_t b = 0U; b < numBuckets; b++) {
+        bucketOf[digits[b]] = b;
+    }
+
+    const auto n = keys.size();
+    numThreads = partitionThreads(n, numThreads);
+    std::vector<std::vector<std::vector<T>>> parts(numThreads, std::vector<std::vector<T>>(numBuckets));
+    const auto gatherChunk = [&](std::size_t t) {
+        for (auto i = n * t / numThreads; i < n * (t + 1U) / numThreads; i++) {
+            const auto b = bucketOf[(orderedKey(keys[i]) >> shift) & (RADIX - 1U)];
+            if (b < numBuckets) {
+                parts[t][b].push_back(keys[i]);
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (std::size_t t = 1U; t < numThreads; t++) {
+        threads.emplace_back(gatherChunk, t);
+    }
+    gatherChunk(0U);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::vector<std::vector<T>> buckets(numBuckets);
+    for (std::size_t b = 0U; b < numBuckets; b++) {
+        for (const auto& part : parts) {
+            buckets[b].insert(buckets[b].end(), part[b].begin(), part[b].end());
+        }
+    }
+    return buckets;
+}
+
+/// Returns the keys at several positions of the ascending order of keys.
+/// Digits of _NUM_SELECT_BITS bits are fixed from the most significant one:
+/// a histogram finds the bucket holding each rank, only the keys of these
+/// buckets are looked at further. Ranks falling into the same bucket share
+/// its histograms.
+/// @param keys Keys to select from, not empty
+/// @param ranks Positions in the sorted keys, each less than keys.size()
+/// @param numThreads Number of threads, 0 selects the hardware concurrency
+template <typename T>
+std::vector<SelectedKey<T>> radixSelect(
+    std::span<const T> keys,
+    std::span<const std::size_t> ranks,
+    std::size_t numThreads = 0U
+)
+{
+    using U = std::make_unsigned_t<T>;
+    using Parameters = AlgorithmParameters<T>;
+    constexpr auto BITS = Parameters::_NUM_SELECT_BITS;
+    constexpr std::size_t RADIX = std::size_t{1U} << BITS;
+
+    /// Keys sharing the digits fixed so far and the ranks among them
+    struct Bucket {
+        std::span<const T> keys;
+        std::vector<T> storage;
+        std::vector<std::size_t> queries;
+    };
+
+    std::vector<SelectedKey<T>> selected(ranks.size());
+    if (keys.empty() || ranks.empty()) {
+        return selected;
+    }
+    std::vector<std::size_t> remaining(ranks.begin(), ranks.end());
+    std::vector<U> prefixes(ranks.size(), 0U);
+    std::vector<Bucket> buckets(1U);
+    buckets.front().keys = keys;
+    buckets.front().queries.resize(ranks.size());
+    std::iota(buckets.front().queries.begin(), buckets.front().queries.end(), std::size_t{0U});
+
+    for (auto shift = Parameters::_TOTALBITS; shift > 0U;) {
+        shift -= BITS;
+        std::vector<Bucket> next;
+        for (auto& bucket : buckets) {
+            const auto counts = selectHistogram(bucket.keys, shift, numThreads);
+            std::vector<std::size_t> digits;
+            std::vector<std::vector<std::size_t>> queries;
+            std::vector<std::size_t> slotOf(RADIX, RADIX);
+            for (const auto q : bucket.queries) {
+                std::size_t d = 0U;
+                while (remaining[q] >= counts[d]) {
+                    remaining[q] -= counts[d];
+                    selected[q].below += counts[d];
+                    d++;
+                }
+                selected[q].equal = counts[d];
+                prefixes[q] = static_cast<U>((prefixes[q] << BITS) | d);
+                if (slotOf[d] == RADIX) {
+                    slotOf[d] = digits.size();
+                    digits.push_back(d);
+                    queries.emplace_back();
+                }
+                queries[slotOf[d]].push_back(q);
+            }
+            if (shift == 0U) {
+                continue;
+            }
+
+            // Keys of a single bucket, e.g. of a narrow range, need no gather
+            if (counts[digits.front()] == bucket.keys.size()) {
+                bucket.queries = std::move(queries.front());
+                next.push_back(std::move(bucket));
+                continue;
+            }
+            auto gathered = gatherDigits(bucket.keys, shift, std::span<const std::size_t>(digits), numThreads);
+            for (std::size_t b = 0U; b < digits.size(); b++) {
+                auto& nextBucket = next.emplace_back();
+                nextBucket.storage = std::move(gathered[b]);
+                nextBucket.keys = nextBucket.storage;
+                nextBucket.queries = std::move(queries[b]);
+            }
+        }
+        buckets = std::move(next);
+    }
+
+    // orderedKey() flips the sign bit, flipping it again restores the key
+    for (std::size_t q = 0U; q < ranks.size(); q++) {
+        selected[q].key = static_cast<T>(orderedKey(static_cast<T>(prefixes[q])));
+    }
+    return selected;
+}
+
+/// Returns the key at position rank of the ascending order of keys
+/// @param keys Keys to select from, not empty
+/// @param rank Position in the sorted keys, less than keys.size()
+/// @param numThreads Number of threads, 0 selects the hardware concurrency
+template <typename T>
+SelectedKey<T> radixSelect(std::span<const T> keys, std::size_t rank, std::size_t numThreads = 0U)
+{
+    return radixSelect(keys, std::span<const std::size_t>(&rank, 1U), numThreads).front();
+}
+
+/// Returns the position of quantile p of n keys, the rank nearest to p * (n - 1)
+/// @param p Probability, clamped to [0, 1]
+/// @param n Number of keys, not 0
+inline std::size_t quantileRank(double p, std::size_t n) noexcept
+{
+    const auto position = std::clamp(p, 0.0, 1.0) * static_cast<double>(n - 1U);
+    return std::min(static_cast<std::size_t>(std::llround(position)), n - 1U);
+}
+
+/// Returns the quantiles of keys without sorting them, see quantileRank()
+/// @param keys Keys, not empty
+/// @param probabilities Probabilities of the quantiles
+/// @param numThreads Number of threads, 0 selects the hardware concurrency
+template <typename T>
+std::vector<T> quantiles(std::span<const T> keys, std::span<const double> probabilities, std::size_t numThreads = 0U)
+{
+    if (keys.empty()) {
+        return {};
+    }
+    std::vector<std::size_t> ranks;
+    for (const auto p : probabilities) {
+        ranks.push_back(quantileRank(p, keys.size()));
+    }
+    std::vector<T> result;
+    for (const auto& selected : radixSelect(keys, std::span<const std::size_t>(ranks), numThreads)) {
+        result.push_back(selected.key);
+    }
+    return result;
+}
+
+/// Rearranges keys like std::nth_element: the key at position k is the one
+/// of the sorted keys, no key before it is greater and no key after it is less.
+/// @param keys Keys to be rearranged
+/// @param k Position, less than keys.size()
+/// @param numThreads Number of threads, 0 selects the hardware concurrency
+template <typename T>
+void nthElement(std::span<T> keys, std::size_t k, std::size_t numThreads = 0U)
+{
+    if (k >= keys.size()) {
+        return;
+    }
+    const auto pivot = radixSelect(std::span<const T>(keys), k, numThreads);
+    const auto front = static_cast<std::size_t>(
+        std::ranges::partition(keys, [&](T key) { return key < pivot.key; }).begin() - keys.begin());
+    std::ranges::partition(keys.subspan(front), [&](T key) { return key == pivot.key; });
+}
+
+/// Moves the k smallest keys to the front in ascending order, or the k
+/// largest in descending order, the others follow in unspecified order.
+/// Takes a radix select and a partition over all keys, only k keys are sorted.
+/// @param keys Keys to be partially sorted
+/// @param k Number of keys sorted, at most keys.size()
+/// @param largest Selects the largest instead of the smallest keys
+/// @param numThreads Number of threads, 0 selects the hardware concurrency
+template <typename T>
+void partialSort(std::span<T> keys, std::size_t k, bool largest = false, std::size_t numThreads = 0U)
+{
+    const auto n = keys.size();
+    k = std::min(k, n);
+    if (k == 0U) {
+        return;
+    }
+    const auto pivot = radixSelect(std::span<const T>(keys), largest ? n - k : k - 1U, numThreads);
+
+    // keys before the pivot come first, then the keys equal to it fill up to k
+    const auto before = [&](T key) { return largest ? pivot.key < key : key < pivot.key; };
+    const auto front = static_cast<std::size_t>(std::ranges::partition(keys, before).begin() - keys.begin());
+    std::ranges::partition(keys.subspan(front), [&](T key) { return key == pivot.key; });
+    auto head = keys.first(front);
+    RadixSortCPU<T>::sortParallel(head, numThreads);
+    if (largest) {
+        std::ranges::reverse(head);
+    }
+}
+
+/// Returns the k smallest keys in ascending order, or the k largest in descending order.
+/// Only keys sorting before the k-th one are copied and sorted.
+/// @param keys Keys to select from
+/// @param k Number of keys returned, at most keys.size()
+/// @param largest Selects the largest instead of the smallest keys
+/// @param numThreads Number of threads, 0 selects the hardware concurrency
+template <typename T>
+std::vector<T> topK(std::span<const T> keys, std::size_t k, bool largest = false, std::size_t numThreads = 0U)
+{
+    const auto n = keys.size();
+    k = std::min(k, n);
+    if (k == 0U) {
+        return {};
+    }
+    const auto pivot = radixSelect(keys, largest ? n - k : k - 1U, numThreads);
+
+    std::vector<T> result;
+    result.reserve(k);
+    const auto before = [&](T key) { return largest ? pivot.key < key : key < pivot.key; };
+    std::ranges::copy_if(keys, std::back_inserter(result), before);
+    std::span<T> head(result);
+    RadixSortCPU<T>::sortParallel(head, numThreads);
+    if (largest) {
+        std::ranges::reverse(head);
+    }
+    result.resize(k, pivot.key);
+    return result;
+}
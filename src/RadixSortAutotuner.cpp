@@ -0,0 +1,155 @@
+#include "RadixSortAutotuner.h"
+
+#include "RadixSortGPU.h"
+#include "Statistics.h"
+
+#include "Common/CTimer.h"
+#include "Common/CLTypeInformation.h"
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+
+template <typename DataType>
+OperationStatus RadixSortAutotuner<DataType>::tune(
+    cl::Device Device,
+    cl::Context Context,
+    std::span<const std::shared_ptr<Dataset<DataType>>> datasets,
+    const TuningCandidates& candidates
+)
+{
+    using Parameters = AlgorithmParameters<DataType>;
+    mResults.clear();
+    mBest = {RadixSortConfig::Defaults<DataType>(), std::numeric_limits<double>::infinity()};
+    if (datasets.empty()) {
+        return OperationStatus::INITIALIZATION_FAILED;
+    }
+
+    cl::CommandQueue queue(Context, Device);
+    const auto maxWorkGroupSize = Device.getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>();
+    const auto localMemSize = Device.getInfo<CL_DEVICE_LOCAL_MEM_SIZE>();
+
+    for (const auto items : candidates.itemsPerGroup) {
+        for (const auto groups : candidates.groups) {
+            for (const auto bits : candidates.bitsPerRadix) {
+                for (const auto split : candidates.histoSplit) {
+                    const RadixSortConfig config{items, groups, split, bits};
+                    // combinations the device cannot run are not built at all
+                    if (!config.validate(Parameters::_TOTALBITS, maxWorkGroupSize, localMemSize, sizeof(cl_uint)).empty()) {
+                        continue;
+                    }
+                    const auto time = Measure(Device, Context, queue, config, datasets);
+                    mResults.push_back({config, time});
+                    if (time < mBest.time) {
+                        mBest = mResults.back();
+                    }
+                }
+            }
+        }
+    }
+    return mBest.time < std::numeric_limits<double>::infinity()
+        ? OperationStatus::OK
+        : OperationStatus::CALCULATION_FAILED;
+}
+
+template <typename DataType>
+double RadixSortAutotuner<DataType>::Measure(
+    cl::Device Device,
+    cl::Context Context,
+    cl::CommandQueue CommandQueue,
+    const RadixSortConfig& config,
+    std::span<const std::shared_ptr<Dataset<DataType>>> datasets
+)
+{
+    using Parameters = AlgorithmParameters<DataType>;
+    constexpr auto failed = std::numeric_limits<double>::infinity();
+
+    size_t maxKeys = 0U;
+    for (const auto& dataset : datasets) {
+        maxKeys = std::max(maxKeys, dataset->dataset.size());
+    }
+    if (maxKeys == 0U) {
+        return failed;
+    }
+
+    try {
+        // The global passes are tuned, small inputs take the local sort anyway
+        // and presorted or narrow datasets would skip them
+        RadixSortGPU<DataType> sorter;
+        sorter.setConfig(config);
+        sorter.setLocalSortThreshold(0U);
+        sorter.setPresortedDetection(false);
+        sorter.setCountingSort(false);
+        if (sorter.initialize(Device, Context, maxKeys, HostSpans<DataType>{}) != OperationStatus::OK) {
+            return failed;
+        }
+        cl::Buffer source(Context, CL_MEM_READ_WRITE, sizeof(DataType) * maxKeys);
+        cl::Buffer keys(Context, CL_MEM_READ_WRITE, sizeof(DataType) * maxKeys);
+
+        Statistics time;
+        for (const auto& dataset : datasets) {
+            const auto& input {dataset->dataset};
+            const auto sizeBytes = sizeof(DataType) * input.size();
+            CommandQueue.enqueueWriteBuffer(source, CL_TRUE, 0, sizeBytes, input.data());
+
+            // the first run warms up and records the passes, its result is checked
+            for (auto i = 0U; i <= Parameters::_NUM_PERFORMANCE_ITERATIONS; i++) {
+                CommandQueue.enqueueCopyBuffer(source, keys, 0, 0, sizeBytes);
+                CommandQueue.finish();
+                CTimer timer;
+                timer.Start();
+                const auto status = sorter.sortBuffer(CommandQueue, keys, 0U, input.size());
+                timer.Stop();
+                if (status != OperationStatus::OK) {
+                    return failed;
+                }
+                if (i == 0U) {
+                    std::vector<DataType> sorted(input.size());
+                    CommandQueue.enqueueReadBuffer(keys, CL_TRUE, 0, sizeBytes, sorted.data());
+                    if (!std::ranges::is_sorted(sorted)) {
+                        return failed;
+                    }
+                    continue;
+                }
+                time.update(timer.GetElapsedMilliseconds());
+            }
+        }
+        sorter.release();
+        return time.avg;
+    } catch (const cl::Error& error) {
+        std::cerr << "Tuning " << config.itemsPerGroup << "x" << config.groups
+                  << " failed: " << error.what() << " (" << error.err() << ")\n";
+        return failed;
+    }
+}
+
+template <typename DataType>
+const TuningResult& RadixSortAutotuner<DataType>::best() const noexcept
+{
+    return mBest;
+}
+
+template <typename DataType>
+const std::vector<TuningResult>& RadixSortAutotuner<DataType>::results() const noexcept
+{
+    return mResults;
+}
+
+template <typename DataType>
+bool RadixSortAutotuner<DataType>::save(cl::Device Device, const std::filesystem::path& path) const
+{
+    if (!(mBest.time < std::numeric_limits<double>::infinity())) {
+        return false;
+    }
+    auto profile = DeviceProfile::Load(path).value_or(DeviceProfile{});
+    profile.device = Device.getInfo<CL_DEVICE_NAME>();
+    profile.driver = Device.getInfo<CL_DRIVER_VERSION>();
+    profile.configs[std::string(TypeNameString<DataType>::open_cl_name)] = {mBest.config, mBest.time};
+    return profile.save(path);
+}
+
+// Specialize RadixSortAutotuner for the supported types.
+template class RadixSortAutotuner < int32_t >;
+template class RadixSortAutotuner < int64_t >;
+template class RadixSortAutotuner < uint32_t >;
+template class RadixSortAutotuner < uint64_t >;
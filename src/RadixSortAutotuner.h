@@ -0,0 +1,78 @@
+#pragma once
+
+#define CL_HPP_MINIMUM_OPENCL_VERSION 120
+#define CL_HPP_TARGET_OPENCL_VERSION 120
+#include <CL/opencl.hpp>
+
+#include "RadixSortConfig.h"
+#include "DeviceProfile.h"
+#include "Dataset.h"
+#include "OperationStatus.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <vector>
+
+/// Parameter values the autotuner combines
+struct TuningCandidates {
+    std::vector<uint32_t> itemsPerGroup{32U, 64U, 128U, 256U};
+    std::vector<uint32_t> groups{16U, 32U, 64U, 128U, 256U};
+    std::vector<uint32_t> bitsPerRadix{4U, 8U};
+    std::vector<uint32_t> histoSplit{256U, 512U, 1024U};
+};
+
+/// Measured configuration
+struct TuningResult {
+    RadixSortConfig config;
+    /// Mean time per sort in ms over all datasets, infinity if the
+    /// configuration failed to build or sorted incorrectly
+    double time{0.0};
+};
+
+/// Benchmarks combinations of algorithm parameters on a device
+/// and keeps the fastest one for a key type
+/// @tparam DataType Type of data to be sorted
+template <typename DataType>
+class RadixSortAutotuner
+{
+public:
+    /// Sorts every dataset with every valid combination of candidates
+    /// @param Device OpenCL device
+    /// @param Context OpenCL context
+    /// @param datasets Representative inputs, e.g. of DatasetCreator
+    /// @param candidates Parameter values to combine
+    OperationStatus tune(
+        cl::Device Device,
+        cl::Context Context,
+        std::span<const std::shared_ptr<Dataset<DataType>>> datasets,
+        const TuningCandidates& candidates = {}
+    );
+
+    /// Returns fastest configuration of the last tuning
+    const TuningResult& best() const noexcept;
+
+    /// Returns all measured configurations of the last tuning
+    const std::vector<TuningResult>& results() const noexcept;
+
+    /// Adds the fastest configuration to the profile of the device,
+    /// keeping the entries of other key types
+    /// @param Device OpenCL device that was tuned
+    /// @param path Profile location, RadixSortGPU loads it from DeviceProfile::PathFor()
+    /// @return true on success
+    bool save(cl::Device Device, const std::filesystem::path& path) const;
+
+private:
+    /// Measures a configuration, infinity if it is not usable
+    double Measure(
+        cl::Device Device,
+        cl::Context Context,
+        cl::CommandQueue CommandQueue,
+        const RadixSortConfig& config,
+        std::span<const std::shared_ptr<Dataset<DataType>>> datasets
+    );
+
+    std::vector<TuningResult> mResults;
+    TuningResult mBest;
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "Parameters.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/// Runtime set of the configurable algorithm parameters.
+/// Values are passed to the kernels as build options, so that device
+/// code stays specialized. AlgorithmParameters provide the defaults.
+struct RadixSortConfig
+{
+    /// Number of items in a group
+    uint32_t itemsPerGroup{AlgorithmParameters<uint32_t>::_NUM_ITEMS_PER_GROUP};
+    /// Number of virtual processors is itemsPerGroup * groups
+    uint32_t groups{AlgorithmParameters<uint32_t>::_NUM_GROUPS};
+    /// Number of splits of the histogram
+    uint32_t histoSplit{AlgorithmParameters<uint32_t>::_NUM_HISTOSPLIT};
+    /// Number of bits in the radix
+    uint32_t bitsPerRadix{AlgorithmParameters<uint32_t>::_NUM_BITS_PER_RADIX};
+
+    /// Configuration of the compile-time parameters
+    /// @tparam DataType Type of data to be sorted
+    template <typename DataType>
+    static constexpr RadixSortConfig Defaults() noexcept
+    {
+        using Parameters = AlgorithmParameters<DataType>;
+        return {
+            Parameters::_NUM_ITEMS_PER_GROUP,
+            Parameters::_NUM_GROUPS,
+            Parameters::_NUM_HISTOSPLIT,
+            Parameters::_NUM_BITS_PER_RADIX,
+        };
+    }
+
+    /// Total number of items
+    constexpr std::size_t numItems() const noexcept
+    {
+        return std::size_t{itemsPerGroup} * groups;
+    }
+
+    /// Radix = 2^bitsPerRadix
+    constexpr std::size_t radix() const noexcept
+    {
+        return std::size_t{1U} << bitsPerRadix;
+    }
+
+    /// Size of histogram
+    constexpr std::size_t histoSize() const noexcept
+    {
+        return numItems() * radix();
+    }
+
+    /// Number of needed passes to sort keys of totalBits bits
+    constexpr uint32_t numPasses(uint32_t totalBits) const noexcept
+    {
+        return totalBits / bitsPerRadix;
+    }
+
+    /// Work-group size of the local histogram scan
+    constexpr std::size_t scanGroupSize() const noexcept
+    {
+        return histoSize() / 2U / histoSplit;
+    }
+
+    /// Number of entries the histogram scans keep in local memory
+    constexpr std::size_t scanCacheSize() const noexcept
+    {
+        return std::max<std::size_t>(histoSplit, histoSize() / histoSplit);
+    }
+
+    /// Checks the configuration against the algorithm and device limits
+    /// @param totalBits Number of bits of the sorted type
+    /// @param maxWorkGroupSize CL_DEVICE_MAX_WORK_GROUP_SIZE
+    /// @param localMemSize CL_DEVICE_LOCAL_MEM_SIZE in bytes
+    /// @param indexSize Size of histogram entries in bytes
+    /// @return Reason the configuration is invalid, empty if valid
+    std::string validate(
+        uint32_t totalBits,
+        std::size_t maxWorkGroupSize,
+        std::size_t localMemSize,
+        std::size_t indexSize
+    ) const
+    {
+        // the histogram scan is a Blelloch scan over powers of two
+        if (!std::has_single_bit(itemsPerGroup) || !std::has_single_bit(groups)
+            || !std::has_single_bit(histoSplit)) {
+            return "Items per group, groups and histogram splits must be powers of two";
+        }
+        if (bitsPerRadix == 0U || bitsPerRadix > 16U || totalBits % bitsPerRadix != 0U) {
+            return "Bits per radix must divide " + std::to_string(totalBits) + " and be at most 16";
+        }
+        if (histoSplit < 2U || histoSize() / histoSplit < 2U) {
+            return "Histogram splits must be between 2 and half the histogram size of "
+                + std::to_string(histoSize());
+        }
+
+        const auto groupSize = std::max<std::size_t>({itemsPerGroup, scanGroupSize(), histoSplit / 2U});
+        if (groupSize > maxWorkGroupSize) {
+            return "Work-group size of " + std::to_string(groupSize)
+                + " exceeds the device limit of " + std::to_string(maxWorkGroupSize);
+        }
+
+        const auto localMem = indexSize * std::max(radix() * itemsPerGroup, scanCacheSize());
+        if (localMem > localMemSize) {
+            return "Local memory of " + std::to_string(localMem)
+                + " bytes exceeds the device limit of " + std::to_string(localMemSize);
+        }
+        return {};
+    }
+
+    constexpr bool operator==(const RadixSortConfig&) const noexcept = default;
+};
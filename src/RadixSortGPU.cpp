@@ -1,6 +1,8 @@
 #include "RadixSortGPU.h"
 
 #include "ComputeDeviceData.h"
+#include "DeviceProfile.h"
+#include "CountingSort.h"
 
 #include "Common/CTimer.h"
 #include "Common/CLTypeInformation.h"
@@ -9,44 +11,94 @@
 
 #include <sstream>
 #include <ranges>
+#include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <bit>
+#include <array>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <type_traits>
 
 template<typename DataType>
-void RadixSortGPU<DataType>::Histogram(cl::CommandQueue CommandQueue, int pass)
+RecordedLaunch RadixSortGPU<DataType>::HistogramLaunch(
+    cl::Kernel kernel,
+    int pass,
+    size_t firstGroup,
+    size_t numGroups)
 {
-    const size_t nbitems = Parameters::_NUM_ITEMS_PER_GROUP * Parameters::_NUM_GROUPS;
-    const size_t nblocitems = Parameters::_NUM_ITEMS_PER_GROUP;
-
-	assert(mNumberKeysRounded % (Parameters::_NUM_GROUPS * Parameters::_NUM_ITEMS_PER_GROUP) == 0);
-	assert(mNumberKeysRounded <= Parameters::_NUM_MAX_INPUT_ELEMS);
+    const size_t nblocitems = mConfig.itemsPerGroup;
 
-	auto histogramKernelHandle = mDeviceData->m_kernelMap["histogram"];
+	assert(mNumberKeysRounded % mConfig.numItems() == 0);
+	assert(firstGroup + numGroups <= mConfig.groups);
 
 	// Set kernel arguments
 	{
-        const auto localCacheSize = sizeof(cl_int) * Parameters::_RADIX * Parameters::_NUM_ITEMS_PER_GROUP;
+        const auto localCacheSize = mDeviceData->m_indexSize * mConfig.radix() * mConfig.itemsPerGroup;
         cl_uint argIdx = 0U;
-        histogramKernelHandle.setArg(argIdx++, mDeviceData->m_dMemoryMap["inputKeys"]);
-        histogramKernelHandle.setArg(argIdx++, mDeviceData->m_dMemoryMap["histograms"]);
-        histogramKernelHandle.setArg(argIdx++, pass);
-        histogramKernelHandle.setArg(argIdx++, cl::Local(localCacheSize));
-        histogramKernelHandle.setArg(argIdx++, mNumberKeysRounded);
+        kernel.setArg(argIdx++, mDeviceData->m_dMemoryMap["inputKeys"]);
+        kernel.setArg(argIdx++, mDeviceData->m_dMemoryMap["histograms"]);
+        kernel.setArg(argIdx++, pass);
+        kernel.setArg(argIdx++, cl::Local(localCacheSize));
+        SetIndexArg(kernel, argIdx++, mNumberKeysRounded);
+        kernel.setArg(argIdx++, mDeviceData->m_dMemoryMap[mRangeReduced ? "keyRange" : "fullKeyRange"]);
 	}
 
+    // A global offset selects the sub-lists of a subset of the groups
+    return {
+        kernel,
+        cl::NDRange{firstGroup * nblocitems},
+        cl::NDRange{numGroups * nblocitems},
+        cl::NDRange{nblocitems},
+    };
+}
+
+template<typename DataType>
+cl_int RadixSortGPU<DataType>::EnqueueLaunch(
+    cl::CommandQueue CommandQueue,
+    const RecordedLaunch& launch,
+    const std::vector<cl::Event>* eventWaitList,
+    cl::Event* event)
+{
+    return CommandQueue.enqueueNDRangeKernel(
+            launch.kernel,
+            launch.offset,
+            launch.global,
+            launch.local,
+            eventWaitList,
+            event
+    );
+}
+
+template<typename DataType>
+cl_int RadixSortGPU<DataType>::EnqueueHistogram(
+    cl::CommandQueue CommandQueue,
+    int pass,
+    size_t firstGroup,
+    size_t numGroups,
+    const std::vector<cl::Event>* eventWaitList,
+    cl::Event* event)
+{
+	// Execute kernel
+    const auto launch = HistogramLaunch(mDeviceData->m_kernelMap["histogram"], pass, firstGroup, numGroups);
+    return EnqueueLaunch(CommandQueue, launch, eventWaitList, event);
+}
+
+template<typename DataType>
+void RadixSortGPU<DataType>::Histogram(cl::CommandQueue CommandQueue, int pass)
+{
     cl::Event event;
     CTimer timer;
     timer.Start();
-    const cl::NDRange globalWorkOffset = cl::NullRange;
-    const cl::NDRange globalWork{nbitems};
-    const cl::NDRange localWork{nblocitems};
     const auto eventWaitList = nullptr;
-	// Execute kernel
-    const auto err = CommandQueue.enqueueNDRangeKernel(
-            histogramKernelHandle,
-            globalWorkOffset,
-            globalWork,
-            localWork,
+    const auto err = EnqueueHistogram(
+            CommandQueue,
+            pass,
+            0U,
+            mConfig.groups,
             eventWaitList,
             &event
     );
@@ -61,46 +113,109 @@ void RadixSortGPU<DataType>::Histogram(cl::CommandQueue CommandQueue, int pass)
 }
 
 template <typename DataType>
-void RadixSortGPU<DataType>::ScanHistogram(cl::CommandQueue CommandQueue)
+RecordedLaunch RadixSortGPU<DataType>::ScanHistogramLaunch(
+    cl::Kernel kernel,
+    bool globalSums)
 {
-    {
+    const auto maxmemcache = mConfig.scanCacheSize();
+
+    if (!globalSums) {
         // numbers of processors for the local scan
         // = half the size of the local histograms
         // global work size
-        size_t nbitems    = Parameters::_RADIX * Parameters::_NUM_GROUPS * Parameters::_NUM_ITEMS_PER_GROUP / 2;
+        const size_t nbitems    = mConfig.histoSize() / 2;
         // local work size
-        size_t nblocitems = nbitems / Parameters::_NUM_HISTOSPLIT;
-
-        const uint32_t maxmemcache = std::max(Parameters::_NUM_HISTOSPLIT,
-            Parameters::_NUM_ITEMS_PER_GROUP * Parameters::_NUM_GROUPS * Parameters::_RADIX / Parameters::_NUM_HISTOSPLIT);
+        const size_t nblocitems = nbitems / mConfig.histoSplit;
 
         // scan locally the histogram (the histogram is split into several
         // parts that fit into the local memory)
+        cl_uint argIdx = 0U;
+        kernel.setArg(argIdx++, mDeviceData->m_dMemoryMap["histograms"]);
+        kernel.setArg(argIdx++, cl::Local(mDeviceData->m_indexSize * maxmemcache));
+        kernel.setArg(argIdx++, mDeviceData->m_dMemoryMap["globsum"]);
+        return {kernel, cl::NullRange, cl::NDRange{nbitems}, cl::NDRange{nblocitems}};
+    }
 
-        auto scanHistogramKernel  = mDeviceData->m_kernelMap["scanhistograms"];
-        // Set kernel arguments
-        {
-            cl_uint argIdx = 0U;
+    // second scan for the globsum
+    // global work size
+    const size_t nbitemsGlobsum    = mConfig.histoSplit / 2;
+    // local work size
+    const size_t nblocitemsGlobsum = nbitemsGlobsum;
+    cl_uint argIdx = 0U;
+    kernel.setArg(argIdx++, mDeviceData->m_dMemoryMap["globsum"]);
+    kernel.setArg(argIdx++, cl::Local(mDeviceData->m_indexSize * maxmemcache));
+    kernel.setArg(argIdx++, mDeviceData->m_dMemoryMap["temp"]);
+    return {kernel, cl::NullRange, cl::NDRange{nbitemsGlobsum}, cl::NDRange{nblocitemsGlobsum}};
+}
 
-            scanHistogramKernel.setArg(argIdx++, mDeviceData->m_dMemoryMap["histograms"]);
-            scanHistogramKernel.setArg(argIdx++, cl::Local(sizeof(uint32_t) * maxmemcache));
-            scanHistogramKernel.setArg(argIdx++, mDeviceData->m_dMemoryMap["globsum"]);
-        }
+template <typename DataType>
+cl_int RadixSortGPU<DataType>::EnqueueScanHistogram(
+    cl::CommandQueue CommandQueue,
+    const std::vector<cl::Event>* eventWaitList,
+    cl::Event* event)
+{
+    // Both scans share the kernel, values of the
+    // first launch are captured when it is enqueued
+    auto scanHistogramKernel = mDeviceData->m_kernelMap["scanhistograms"];
+    cl::Event localScanDone;
+    auto err = EnqueueLaunch(
+        CommandQueue,
+        ScanHistogramLaunch(scanHistogramKernel, false),
+        eventWaitList,
+        &localScanDone
+    );
+    if (err != CL_SUCCESS) {
+        return err;
+    }
+
+    // Execute kernel for second scan (global)
+    const std::vector<cl::Event> waitList {localScanDone};
+    return EnqueueLaunch(
+        CommandQueue,
+        ScanHistogramLaunch(scanHistogramKernel, true),
+        &waitList,
+        event
+    );
+}
+
+template <typename DataType>
+RecordedLaunch RadixSortGPU<DataType>::PasteHistogramLaunch(cl::Kernel kernel)
+{
+    // loops again in order to paste together the local histograms
+    // global
+    const size_t nbitems    = mConfig.histoSize() / 2;
+    // local work size
+    const size_t nblocitems = nbitems / mConfig.histoSplit;
+
+    // Set kernel arguments
+    {
+        cl_uint argIdx = 0U;
+        kernel.setArg(argIdx++, mDeviceData->m_dMemoryMap["histograms"]);
+        kernel.setArg(argIdx++, mDeviceData->m_dMemoryMap["globsum"]);
+    }
+    return {kernel, cl::NullRange, cl::NDRange{nbitems}, cl::NDRange{nblocitems}};
+}
+
+template <typename DataType>
+cl_int RadixSortGPU<DataType>::EnqueuePasteHistogram(
+    cl::CommandQueue CommandQueue,
+    const std::vector<cl::Event>* eventWaitList,
+    cl::Event* event)
+{
+    // Execute paste histogram kernel
+    const auto launch = PasteHistogramLaunch(mDeviceData->m_kernelMap["pastehistograms"]);
+    return EnqueueLaunch(CommandQueue, launch, eventWaitList, event);
+}
+
+template <typename DataType>
+void RadixSortGPU<DataType>::ScanHistogram(cl::CommandQueue CommandQueue)
+{
+    {
         cl::Event event;
         CTimer timer;
         timer.Start();
-        const cl::NDRange globalWorkOffset = cl::NullRange;
-        const cl::NDRange globalWork{nbitems};
-        const cl::NDRange localWork{nblocitems};
         const auto eventWaitList = nullptr;
-        const auto err = CommandQueue.enqueueNDRangeKernel(
-             scanHistogramKernel,
-             globalWorkOffset,
-             globalWork,
-             localWork,
-             eventWaitList,
-             &event
-        );
+        const auto err = EnqueueScanHistogram(CommandQueue, eventWaitList, &event);
         assert(err == CL_SUCCESS);
 
         CommandQueue.finish();
@@ -109,80 +224,15 @@ void RadixSortGPU<DataType>::ScanHistogram(cl::CommandQueue CommandQueue)
 
 #ifdef MORE_PROFILING
         mRuntimesGPU.timeScan += cl::util::get_duration<CL_PROFILING_COMMAND_QUEUED, CL_PROFILING_COMMAND_END>(event).count() / 1e9f;
-
-#endif
-
-        // second scan for the globsum
-        // Set only first and third kernel arguments
-        {
-            scanHistogramKernel.setArg(0,mDeviceData->m_dMemoryMap["globsum"]);
-            scanHistogramKernel.setArg(2,mDeviceData->m_dMemoryMap["temp"]);
-        }
-
-        {
-            // global work size
-            const size_t nbitems    = Parameters::_NUM_HISTOSPLIT / 2;
-            // local work size
-            const size_t nblocitems = nbitems;
-
-            CTimer timer;
-            timer.Start();
-            const cl::NDRange globalWorkOffset = cl::NullRange;
-            const cl::NDRange globalWork{nbitems};
-            const cl::NDRange localWork{nblocitems};
-            const auto eventWaitList = nullptr;
-            // Execute kernel for second scan (global)
-            const auto err = CommandQueue.enqueueNDRangeKernel(
-                scanHistogramKernel,
-                globalWorkOffset,
-                globalWork,
-                localWork,
-                eventWaitList,
-                &event
-            );
-            assert(err == CL_SUCCESS);
-
-            CommandQueue.finish();
-            timer.Stop();
-            mRuntimesGPU.timeScan.update(timer.GetElapsedMilliseconds());
-
-#ifdef MORE_PROFILING
-            mRuntimesGPU.timeScan += cl::util::get_duration<CL_PROFILING_COMMAND_QUEUED, CL_PROFILING_COMMAND_END>(event).count() / 1e9f;
 #endif
-        }
     }
 
     {
-        // loops again in order to paste together the local histograms
-        // global
-        size_t nbitems    = Parameters::_RADIX * Parameters::_NUM_GROUPS * Parameters::_NUM_ITEMS_PER_GROUP / 2;
-        // local work size
-        size_t nblocitems = nbitems / Parameters::_NUM_HISTOSPLIT;
-
-        auto pasteHistogramKernel = mDeviceData->m_kernelMap["pastehistograms"];
-        // Set kernel arguments
-        {
-            cl_uint argIdx = 0U;
-            pasteHistogramKernel.setArg(argIdx++, mDeviceData->m_dMemoryMap["histograms"]);
-            pasteHistogramKernel.setArg(argIdx++, mDeviceData->m_dMemoryMap["globsum"]);
-        }
-
-        // Execute paste histogram kernel
         cl::Event event;
         CTimer timer;
         timer.Start();
-        const cl::NDRange globalWorkOffset = cl::NullRange;
-        const cl::NDRange globalWork{nbitems};
-        const cl::NDRange localWork{nblocitems};
         const auto eventWaitList = nullptr;
-        const auto err = CommandQueue.enqueueNDRangeKernel(
-            pasteHistogramKernel,
-            globalWorkOffset,
-            globalWork,
-            localWork,
-            eventWaitList,
-            &event
-        );
+        const auto err = EnqueuePasteHistogram(CommandQueue, eventWaitList, &event);
         assert(err == CL_SUCCESS);
 
         CommandQueue.finish();
@@ -196,59 +246,128 @@ void RadixSortGPU<DataType>::ScanHistogram(cl::CommandQueue CommandQueue)
 }
 
 template <typename DataType>
-void RadixSortGPU<DataType>::Reorder(cl::CommandQueue CommandQueue, int pass)
+RecordedLaunch RadixSortGPU<DataType>::ReorderLaunch(
+    cl::Kernel kernel,
+    int pass)
 {
-	constexpr size_t nblocitems = Parameters::_NUM_ITEMS_PER_GROUP;
-    constexpr size_t nbitems    = Parameters::_NUM_ITEMS_PER_GROUP * Parameters::_NUM_GROUPS;
-
-	assert(mNumberKeysRounded % (Parameters::_NUM_GROUPS * Parameters::_NUM_ITEMS_PER_GROUP) == 0);
+	const size_t nblocitems = mConfig.itemsPerGroup;
+    const size_t nbitems    = mConfig.numItems();
 
-    CommandQueue.finish();
-    auto reorderKernel = mDeviceData->m_kernelMap["reorder"];
-	assert(Parameters::_RADIX == pow(2, Parameters::_NUM_BITS_PER_RADIX));
-
-    // TODO: Use
-	struct ReorderKernelParams {
-        cl::Memory inKeys;
-        cl::Memory outKeys;
-        cl::Memory histograms;
-		int pass;
-        cl::Memory inPermutation;
-        cl::Memory outPermutation;
-		size_t localHistogramSize;
-		int numElems;
-	};
+	assert(mNumberKeysRounded % mConfig.numItems() == 0);
 
 	// set kernel arguments
 	{
         cl_uint argIdx = 0U;
-        reorderKernel.setArg(argIdx++, mDeviceData->m_dMemoryMap["inputKeys"]);
-        reorderKernel.setArg(argIdx++, mDeviceData->m_dMemoryMap["outputKeys"]);
-        reorderKernel.setArg(argIdx++, mDeviceData->m_dMemoryMap["histograms"]);
-        reorderKernel.setArg(argIdx++, pass);
-        reorderKernel.setArg(argIdx++, mDeviceData->m_dMemoryMap["inputPermutations"]);
-        reorderKernel.setArg(argIdx++, mDeviceData->m_dMemoryMap["outputPermutations"]);
-        reorderKernel.setArg(argIdx++, cl::Local(sizeof(cl_int) * Parameters::_RADIX * Parameters::_NUM_ITEMS_PER_GROUP));
-        reorderKernel.setArg(argIdx++, mNumberKeysRounded);
+        kernel.setArg(argIdx++, mDeviceData->m_dMemoryMap["inputKeys"]);
+        kernel.setArg(argIdx++, mDeviceData->m_dMemoryMap["outputKeys"]);
+        kernel.setArg(argIdx++, mDeviceData->m_dMemoryMap["histograms"]);
+        kernel.setArg(argIdx++, pass);
+        kernel.setArg(argIdx++, mDeviceData->m_dMemoryMap["inputPermutations"]);
+        kernel.setArg(argIdx++, mDeviceData->m_dMemoryMap["outputPermutations"]);
+        kernel.setArg(argIdx++, cl::Local(mDeviceData->m_indexSize * mConfig.radix() * mConfig.itemsPerGroup));
+        SetIndexArg(kernel, argIdx++, mNumberKeysRounded);
+        kernel.setArg(argIdx++, mDeviceData->m_dMemoryMap[mRangeReduced ? "keyRange" : "fullKeyRange"]);
 	}
+    return {kernel, cl::NullRange, cl::NDRange{nbitems}, cl::NDRange{nblocitems}};
+}
 
-    cl::Event event;
+template <typename DataType>
+void RadixSortGPU<DataType>::SwapBuffers()
+{
+    // swap the old and new vectors of keys
+    std::swap(mDeviceData->m_dMemoryMap["inputKeys"], mDeviceData->m_dMemoryMap["outputKeys"]);
 
-    const cl::NDRange globalWorkOffset = cl::NullRange;
-    const cl::NDRange globalWork{nbitems};
-    const cl::NDRange localWork{nblocitems};
+    // swap the old and new permutations
+    std::swap(mDeviceData->m_dMemoryMap["inputPermutations"], mDeviceData->m_dMemoryMap["outputPermutations"]);
+}
+
+template <typename DataType>
+cl_int RadixSortGPU<DataType>::EnqueueReorder(
+    cl::CommandQueue CommandQueue,
+    int pass,
+    const std::vector<cl::Event>* eventWaitList,
+    cl::Event* event)
+{
+	// Execute kernel
+    const auto launch = ReorderLaunch(mDeviceData->m_kernelMap["reorder"], pass);
+    const auto err = EnqueueLaunch(CommandQueue, launch, eventWaitList, event);
+
+    // (arguments are captured at enqueue time, so this is safe before completion)
+    SwapBuffers();
+    return err;
+}
+
+template <typename DataType>
+cl_int RadixSortGPU<DataType>::EnqueuePasses(
+    cl::CommandQueue CommandQueue,
+    const std::vector<cl::Event>* eventWaitList,
+    cl::Event* event)
+{
+    // Keep a few recordings, e.g. for the varying sizes passed to sortBuffer()
+    constexpr size_t maxRecordings = 4U;
+
+    auto& memoryMap {mDeviceData->m_dMemoryMap};
+    const RecordedPasses::Key key {
+        mNumberKeysRounded,
+        mNumPasses,
+        memoryMap["inputKeys"],
+        memoryMap["outputKeys"],
+        memoryMap["inputPermutations"],
+        memoryMap["outputPermutations"],
+        memoryMap[mRangeReduced ? "keyRange" : "fullKeyRange"],
+    };
+    auto& recordings {mDeviceData->m_recordedPasses};
+    auto found = std::ranges::find_if(recordings, [&key](const auto& recording) { return recording->key() == key; });
+
+    if (found == recordings.end()) {
+        if (recordings.size() >= maxRecordings) {
+            recordings.erase(recordings.begin());
+        }
+        // Every launch gets its own kernel object, so that all arguments stay bound.
+        // Recording walks through the buffer swaps of the passes.
+        const auto newKernel = [this](const char* name) { return cl::Kernel(mDeviceData->m_Program, name); };
+        std::vector<RecordedLaunch> launches;
+        for (uint32_t pass = 0U; pass < mNumPasses; pass++) {
+            launches.push_back(HistogramLaunch(newKernel("histogram"), pass, 0U, mConfig.groups));
+            launches.push_back(ScanHistogramLaunch(newKernel("scanhistograms"), false));
+            launches.push_back(ScanHistogramLaunch(newKernel("scanhistograms"), true));
+            launches.push_back(PasteHistogramLaunch(newKernel("pastehistograms")));
+            launches.push_back(ReorderLaunch(newKernel("reorder"), pass));
+            SwapBuffers();
+        }
+        recordings.push_back(std::make_unique<RecordedPasses>(CommandQueue, key, std::move(launches)));
+        found = recordings.end() - 1;
+    } else {
+        // most recently used last
+        std::rotate(found, found + 1, recordings.end());
+        found = recordings.end() - 1;
+        // the sorted keys end up where the passes swapped them to
+        for (uint32_t pass = 0U; pass < mNumPasses; pass++) {
+            SwapBuffers();
+        }
+    }
+    return (*found)->enqueue(CommandQueue, eventWaitList, event);
+}
+
+template <typename DataType>
+bool RadixSortGPU<DataType>::usesCommandBuffers() const noexcept
+{
+    return mDeviceData
+        && !mDeviceData->m_recordedPasses.empty()
+        && mDeviceData->m_recordedPasses.back()->usesCommandBuffer();
+}
+
+template <typename DataType>
+void RadixSortGPU<DataType>::Reorder(cl::CommandQueue CommandQueue, int pass)
+{
+    CommandQueue.finish();
+
+    cl::Event event;
     const auto eventWaitList = nullptr;
 	// Execute kernel
     CTimer timer;
     timer.Start();
-    const auto err = CommandQueue.enqueueNDRangeKernel(
-		reorderKernel,
-        globalWorkOffset,
-        globalWork,
-        localWork,
-        eventWaitList,
-        &event
-    );
+    const auto err = EnqueueReorder(CommandQueue, pass, eventWaitList, &event);
     assert(err == CL_SUCCESS);
     CommandQueue.finish();
     timer.Stop();
@@ -258,12 +377,6 @@ void RadixSortGPU<DataType>::Reorder(cl::CommandQueue CommandQueue, int pass)
     mRuntimesGPU.timeReorder += cl::util::get_duration<CL_PROFILING_COMMAND_QUEUED, CL_PROFILING_COMMAND_END>(event).count() / 1e9f;
 
 #endif
-
-    // swap the old and new vectors of keys
-    std::swap(mDeviceData->m_dMemoryMap["inputKeys"], mDeviceData->m_dMemoryMap["outputKeys"]);
-
-    // swap the old and new permutations
-    std::swap(mDeviceData->m_dMemoryMap["inputPermutations"], mDeviceData->m_dMemoryMap["outputPermutations"]);
 }
 
 template <typename DataType>
@@ -275,6 +388,7 @@ void RadixSortGPU<DataType>::padGPUData(
     // pads the vector with big values
     const auto pattern {MaxValue-1};
     const auto size_bytes = mNumberKeysRounded * sizeof(DataType) - paddingOffset;
+    mNumberKeys = paddingOffset / sizeof(DataType);
 
     CommandQueue.enqueueFillBuffer(
         mDeviceData->m_dMemoryMap["inputKeys"],
@@ -285,24 +399,54 @@ void RadixSortGPU<DataType>::padGPUData(
 }
 
 template <typename DataType>
-uint32_t RadixSortGPU<DataType>::Resize(uint32_t nn) const noexcept
+size_t RadixSortGPU<DataType>::Resize(size_t nn) const noexcept
 {
-    // length of the vector has to be divisible by (Parameters::_NUM_GROUPS * Parameters::_NUM_ITEMS_PER_GROUP)
-    constexpr auto NumItems
-        {Parameters::_NUM_GROUPS * Parameters::_NUM_ITEMS_PER_GROUP};
-    const int32_t rest = nn % NumItems;
+    // length of the vector has to be divisible by the number of items
+    const size_t NumItems {mConfig.numItems()};
+    const size_t rest = nn % NumItems;
 
-    const int32_t delta = (rest != 0) * (- rest + NumItems);
+    const size_t delta = (rest != 0) * (NumItems - rest);
     return nn + delta;
 }
 
+template <typename DataType>
+void RadixSortGPU<DataType>::SetIndexArg(cl::Kernel& kernel, cl_uint argIdx, size_t value) const
+{
+    // must match the width of IndexType in the program
+    if (mDeviceData->m_indexSize == sizeof(cl_ulong)) {
+        kernel.setArg(argIdx, static_cast<cl_ulong>(value));
+    } else {
+        assert(value <= std::numeric_limits<cl_uint>::max());
+        kernel.setArg(argIdx, static_cast<cl_uint>(value));
+    }
+}
+
 template <typename DataType>
 OperationStatus RadixSortGPU<DataType>::uploadData(
     cl::CommandQueue CommandQueue
 )
 {
-    CopyDataToDevice(CommandQueue);
-    const auto error = CommandQueue.finish();  // wait until end of write
+    CTimer timer;
+    timer.Start();
+    auto error = CL_SUCCESS;
+    switch (mMemoryMode) {
+        case MemoryMode::ZERO_COPY:
+            MapDataToDevice(CommandQueue);
+            break;
+        case MemoryMode::STAGED:
+            StageDataToDevice(CommandQueue);
+            error = mTransferQueue.finish();
+            break;
+        case MemoryMode::COPY:
+            CopyDataToDevice(CommandQueue);
+            break;
+    }
+    if (error == CL_SUCCESS) {
+        error = CommandQueue.finish();  // wait until end of write
+    }
+    timer.Stop();
+    mRuntimesGPU.timeUpload.update(timer.GetElapsedMilliseconds());
+
     using S = OperationStatus;
     return error == CL_SUCCESS ? S::OK : S::DATA_UPLOAD_FAILED;
 }
@@ -312,12 +456,123 @@ OperationStatus RadixSortGPU<DataType>::calculate(
     cl::CommandQueue CommandQueue
 )
 {
-    for (uint32_t pass = 0U; pass < Parameters::_NUM_PASSES; pass++){
+    // every path records the time of the whole call as one sample
+    CTimer totalTimer;
+    totalTimer.Start();
+    const auto recordTotal = [&]() {
+        totalTimer.Stop();
+        mRuntimesGPU.timeTotal.update(totalTimer.GetElapsedMilliseconds());
+    };
+
+    // Presorted keys take a shortcut. The staged upload already built
+    // the first histogram, so the passes are run then.
+    // The padding stays behind the keys, so only the keys are checked.
+    mSortPath = SortPath::RADIX;
+    if (mPresortedDetection && !mFirstHistogramReady) {
+        const auto inputKeys = mDeviceData->m_dMemoryMap["inputKeys"];
+        CTimer timer;
+        timer.Start();
+        auto err = DetectPresortedness(CommandQueue, inputKeys, 0U, mNumberKeys);
+        if (err == CL_SUCCESS && mSortPath == SortPath::REVERSED) {
+            err = EnqueueReverse(CommandQueue, inputKeys, 0U, mNumberKeys);
+        } else if (err == CL_SUCCESS && mSortPath == SortPath::RUN_MERGE) {
+            err = MergeRuns(CommandQueue, mNumberKeys);
+        }
+        if (err == CL_SUCCESS) {
+            err = CommandQueue.finish();
+        }
+        timer.Stop();
+        if (err != CL_SUCCESS) {
+            return OperationStatus::CALCULATION_FAILED;
+        }
+        mRuntimesGPU.timePresorted.update(timer.GetElapsedMilliseconds());
+        if (mSortPath != SortPath::RADIX) {
+            if (mOutStream) {
+                *mOutStream << "Taking the " << toString(mSortPath) << " path" << std::endl;
+            }
+            mNumPasses = 0U;
+            mRuntimesGPU.path = mSortPath;
+            recordTotal();
+            return OperationStatus::OK;
+        }
+    }
+    mRuntimesGPU.path = SortPath::RADIX;
+
+    // small inputs are sorted on-chip by a single launch
+    if (UseLocalSort()) {
+        if (mOutStream) {
+            *mOutStream << "Sorting in local memory" << std::endl;
+        }
+        CTimer timer;
+        timer.Start();
+        const auto err = EnqueueLocalSortAll(CommandQueue, nullptr, nullptr);
+        CommandQueue.finish();
+        timer.Stop();
+        if (err != CL_SUCCESS) {
+            return OperationStatus::CALCULATION_FAILED;
+        }
+        mFirstHistogramReady = false;
+        mRuntimesGPU.timeLocalSort.update(timer.GetElapsedMilliseconds());
+        recordTotal();
+        return OperationStatus::OK;
+    }
+
+    // The staged upload built the first histogram over the full key range.
+    // Padding sorts behind all keys, so it is left out of the range.
+    if (mRangeReduction && !mFirstHistogramReady) {
+        CTimer timer;
+        timer.Start();
+        const auto err = ReduceKeyRange(CommandQueue, mNumberKeys);
+        timer.Stop();
+        if (err != CL_SUCCESS) {
+            return OperationStatus::CALCULATION_FAILED;
+        }
+        mRuntimesGPU.timeKeyRange.update(timer.GetElapsedMilliseconds());
+        if (mOutStream) {
+            *mOutStream << "Sorting " << mNumPasses << " passes" << std::endl;
+        }
+    } else {
+        UseFullKeyRange();
+    }
+
+    // a single pass is as cheap as counting
+    if (mCountingSort && mNumPasses > 1U) {
+        CTimer timer;
+        timer.Start();
+        bool counted = false;
+        auto err = SortByCounting(CommandQueue, mNumberKeys, counted);
+        if (err == CL_SUCCESS) {
+            err = CommandQueue.finish();
+        }
+        timer.Stop();
+        if (err != CL_SUCCESS) {
+            return OperationStatus::CALCULATION_FAILED;
+        }
+        mRuntimesGPU.timeCounting.update(timer.GetElapsedMilliseconds());
+        if (counted) {
+            if (mOutStream) {
+                *mOutStream << "Sorted by counting" << std::endl;
+            }
+            mFirstHistogramReady = false;
+            mNumPasses = 0U;
+            mSortPath = SortPath::COUNTING;
+            mRuntimesGPU.path = mSortPath;
+            recordTotal();
+            return OperationStatus::OK;
+        }
+    }
+
+    for (uint32_t pass = 0U; pass < mNumPasses; pass++){
         if (mOutStream) {
             *mOutStream << "Pass " << pass << ":" << std::endl;
             *mOutStream << "Building histograms" << std::endl;
         }
-        Histogram(CommandQueue, pass);
+        // The staged upload may already have built the first histogram
+        if (pass == 0U && mFirstHistogramReady) {
+            mFirstHistogramReady = false;
+        } else {
+            Histogram(CommandQueue, pass);
+        }
 
         if (mOutStream) {
             *mOutStream << "Scanning histograms" << std::endl;
@@ -334,14 +589,8 @@ OperationStatus RadixSortGPU<DataType>::calculate(
         }
     }
 
-    mRuntimesGPU.timeTotal.avg =
-        mRuntimesGPU.timeHisto.avg
-        + mRuntimesGPU.timeScan.avg
-        + mRuntimesGPU.timeReorder.avg
-        + mRuntimesGPU.timePaste.avg;
-
-    mRuntimesGPU.timeTotal.n = mRuntimesGPU.timeHisto.n;
-
+    CommandQueue.finish();
+    recordTotal();
     return OperationStatus::OK;
 }
 
@@ -350,10 +599,100 @@ OperationStatus RadixSortGPU<DataType>::downloadData(
     cl::CommandQueue CommandQueue
 )
 {
-    CopyDataFromDevice(CommandQueue);
+    CTimer timer;
+    timer.Start();
+    switch (mMemoryMode) {
+        case MemoryMode::ZERO_COPY:
+            MapDataFromDevice(CommandQueue);
+            break;
+        case MemoryMode::STAGED:
+            StageDataFromDevice(CommandQueue);
+            break;
+        case MemoryMode::COPY:
+            CopyDataFromDevice(CommandQueue);
+            break;
+    }
+    CopyHistogramsFromDevice(CommandQueue);
     const auto error = CommandQueue.finish();
+    timer.Stop();
+    mRuntimesGPU.timeDownload.update(timer.GetElapsedMilliseconds());
+
     using S = OperationStatus;
-    return error == CL_SUCCESS ? S::OK : S::DATA_DOWNLOAD_FAILED;
+    if (error != CL_SUCCESS) {
+        return S::DATA_DOWNLOAD_FAILED;
+    }
+
+    // Sorted data lives in the key span; only copy if a distinct result span was given
+    if (mMemoryMode == MemoryMode::ZERO_COPY
+        && mHostSpans.m_hResultFromGPU.data() != mHostSpans.m_hKeys.data())
+    {
+        std::copy_n(
+            mHostSpans.m_hKeys.data(),
+            mNumberKeysRounded,
+            mHostSpans.m_hResultFromGPU.data()
+        );
+    }
+    return S::OK;
+}
+
+template <typename DataType>
+SortHandle RadixSortGPU<DataType>::sortAsync(cl::CommandQueue CommandQueue)
+{
+    return sortAsync(CommandQueue, SortHandle{});
+}
+
+template <typename DataType>
+SortHandle RadixSortGPU<DataType>::sortAsync(
+    cl::CommandQueue CommandQueue,
+    const SortHandle& after
+)
+{
+    // a sort ordered after a failed one fails as well
+    if (after.status() < 0) {
+        return SortHandle(after.event(), after.status());
+    }
+    std::vector<cl::Event> waitList;
+    if (after.event()() != nullptr) {
+        waitList.push_back(after.event());
+    }
+
+    // Every command waits for its predecessor, the chain does not rely on an in-order queue
+    cl::Event event;
+    const auto next = [&]() {
+        waitList = {event};
+        return &waitList;
+    };
+
+    if (mMemoryMode == MemoryMode::ZERO_COPY) {
+        MapDataToDevice(CommandQueue, waitList.empty() ? nullptr : &waitList, &event);
+    } else {
+        // Staged transfers are driven by the host and cannot be deferred
+        CopyDataToDevice(CommandQueue, waitList.empty() ? nullptr : &waitList, &event);
+    }
+    mFirstHistogramReady = false;
+
+    auto error = CL_SUCCESS;
+    // small inputs are sorted by a single launch instead of the passes
+    if (UseLocalSort()) {
+        error = EnqueueLocalSortAll(CommandQueue, next(), &event);
+    } else {
+        // all passes are replayed from their recording
+        UseFullKeyRange();
+        error = EnqueuePasses(CommandQueue, next(), &event);
+    }
+    // the download is not enqueued, the handle reports the error instead of completing
+    if (error != CL_SUCCESS) {
+        CommandQueue.flush();
+        return SortHandle(waitList.front(), error);
+    }
+
+    if (mMemoryMode == MemoryMode::ZERO_COPY) {
+        MapDataFromDevice(CommandQueue, next(), &event);
+    } else {
+        CopyDataFromDevice(CommandQueue, next(), &event);
+    }
+    CommandQueue.flush();
+    return SortHandle(event);
 }
 
 template <typename DataType>
@@ -363,16 +702,34 @@ void RadixSortGPU<DataType>::setLogStream(std::ostream* out) noexcept
 }
 
 template <typename DataType>
-void RadixSortGPU<DataType>::CopyDataToDevice( cl::CommandQueue CommandQueue)
+void RadixSortGPU<DataType>::setMemoryMode(MemoryMode mode) noexcept
+{
+    mMemoryMode = mode;
+}
+
+template <typename DataType>
+MemoryMode RadixSortGPU<DataType>::memoryMode() const noexcept
+{
+    return mMemoryMode;
+}
+
+template <typename DataType>
+void RadixSortGPU<DataType>::CopyDataToDevice(
+    cl::CommandQueue CommandQueue,
+    const std::vector<cl::Event>* eventWaitList,
+    cl::Event* event)
 {
     constexpr auto isBlocking = CL_FALSE;
+    std::vector<cl::Event> transfers(2);
     auto error = CL_SUCCESS;
     error = CommandQueue.enqueueWriteBuffer(
         mDeviceData->m_dMemoryMap["inputKeys"],
         isBlocking,
         0,
         sizeof(DataType) * mNumberKeysRounded,
-        mHostSpans.m_hKeys.data()
+        mHostSpans.m_hKeys.data(),
+        eventWaitList,
+        &transfers[0]
     );
     assert(error == CL_SUCCESS);
 
@@ -381,22 +738,34 @@ void RadixSortGPU<DataType>::CopyDataToDevice( cl::CommandQueue CommandQueue)
         isBlocking,
         0,
         sizeof(uint32_t) * mNumberKeysRounded,
-        mHostSpans.h_Permut.data()
+        mHostSpans.h_Permut.data(),
+        eventWaitList,
+        &transfers[1]
     );
     assert(error == CL_SUCCESS);
+
+    if (event) {
+        CommandQueue.enqueueMarkerWithWaitList(&transfers, event);
+    }
 }
 
 template <typename DataType>
-void RadixSortGPU<DataType>::CopyDataFromDevice(cl::CommandQueue CommandQueue)
+void RadixSortGPU<DataType>::CopyDataFromDevice(
+    cl::CommandQueue CommandQueue,
+    const std::vector<cl::Event>* eventWaitList,
+    cl::Event* event)
 {
     constexpr auto isBlocking = CL_FALSE;
     constexpr auto offset = 0U;
+    std::vector<cl::Event> transfers(2);
     auto error = CommandQueue.enqueueReadBuffer(
         mDeviceData->m_dMemoryMap["inputKeys"],
 		isBlocking,
         offset,
 		sizeof(DataType) * mNumberKeysRounded,
-        mHostSpans.m_hResultFromGPU.data()
+        mHostSpans.m_hResultFromGPU.data(),
+        eventWaitList,
+        &transfers[0]
     );
     assert(error == CL_SUCCESS);
 
@@ -405,15 +774,37 @@ void RadixSortGPU<DataType>::CopyDataFromDevice(cl::CommandQueue CommandQueue)
 		isBlocking,
         offset,
 		sizeof(uint32_t) * mNumberKeysRounded,
-        mHostSpans.h_Permut.data()
+        mHostSpans.h_Permut.data(),
+        eventWaitList,
+        &transfers[1]
     );
     assert(error == CL_SUCCESS);
 
-    error = CommandQueue.enqueueReadBuffer(
+    if (event) {
+        CommandQueue.enqueueMarkerWithWaitList(&transfers, event);
+    }
+}
+
+template <typename DataType>
+void RadixSortGPU<DataType>::CopyHistogramsFromDevice(cl::CommandQueue CommandQueue)
+{
+    // host spans hold 32-bit entries, 64-bit histograms are not exposed
+    if (mDeviceData->m_indexSize != sizeof(uint32_t)) {
+        return;
+    }
+    // spans may be sized for the compile-time parameters
+    if (mHostSpans.m_hHistograms.size() < mConfig.histoSize()
+        || mHostSpans.m_hGlobsum.size() < mConfig.histoSplit) {
+        return;
+    }
+
+    constexpr auto isBlocking = CL_FALSE;
+    constexpr auto offset = 0U;
+    auto error = CommandQueue.enqueueReadBuffer(
         mDeviceData->m_dMemoryMap["histograms"],
 		isBlocking,
         offset,
-		sizeof(uint32_t) * Parameters::_RADIX * Parameters::_NUM_GROUPS * Parameters::_NUM_ITEMS_PER_GROUP,
+		sizeof(uint32_t) * mConfig.histoSize(),
         mHostSpans.m_hHistograms.data()
     );
     assert(error == CL_SUCCESS);
@@ -422,37 +813,367 @@ void RadixSortGPU<DataType>::CopyDataFromDevice(cl::CommandQueue CommandQueue)
         mDeviceData->m_dMemoryMap["globsum"],
 		isBlocking,
         offset,
-		sizeof(uint32_t)  * Parameters::_NUM_HISTOSPLIT,
+		sizeof(uint32_t)  * mConfig.histoSplit,
 		mHostSpans.m_hGlobsum.data()
     );
     assert(error == CL_SUCCESS);
 }
 
 template <typename DataType>
-std::string RadixSortGPU<DataType>::BuildPreamble()
+void RadixSortGPU<DataType>::MapDataToDevice(
+    cl::CommandQueue CommandQueue,
+    const std::vector<cl::Event>* eventWaitList,
+    cl::Event* event)
 {
-    using UnsignedType = typename std::make_unsigned<DataType>::type;
+    // Host data is already in place, map/unmap only hands ownership to the device.
+    // Drivers without unified memory synchronize their shadow copy on unmap.
+    const auto handOver = [&](const cl::Buffer& buffer, size_t sizeInBytes) {
+        constexpr auto isBlocking = CL_FALSE;
+        constexpr auto offset = 0U;
+        cl_int error{CL_SUCCESS};
+        cl::Event mapped;
+        void* mappedPtr = CommandQueue.enqueueMapBuffer(
+            buffer,
+            isBlocking,
+            CL_MAP_WRITE,
+            offset,
+            sizeInBytes,
+            eventWaitList,
+            &mapped,
+            &error
+        );
+        assert(error == CL_SUCCESS);
+        const std::vector<cl::Event> waitList {mapped};
+        cl::Event unmapped;
+        error = CommandQueue.enqueueUnmapMemObject(buffer, mappedPtr, &waitList, &unmapped);
+        assert(error == CL_SUCCESS);
+        return unmapped;
+    };
+
+    // An odd number of swaps by the last sort left the device-only buffers
+    // as input, the passes have to start from the host-wrapped ones.
+    auto& memoryMap {mDeviceData->m_dMemoryMap};
+    if (memoryMap["inputKeys"]() != mDeviceData->m_hostKeys()) {
+        std::swap(memoryMap["inputKeys"], memoryMap["outputKeys"]);
+    }
+    if (memoryMap["inputPermutations"]() != mDeviceData->m_hostPermutations()) {
+        std::swap(memoryMap["inputPermutations"], memoryMap["outputPermutations"]);
+    }
 
-    const auto OFFSET { -std::numeric_limits<DataType>::min() };
-    std::stringstream ss;
-    ss << "#define DataType " << TypeNameString<DataType>::open_cl_name << std::endl
-       << "#define UnsignedDataType " << TypeNameString<UnsignedType>::open_cl_name << std::endl
-       << "#define OFFSET " << OFFSET << std::endl;
-    return ss.str();
+    std::vector<cl::Event> transfers {
+        handOver(mDeviceData->m_hostKeys, sizeof(DataType) * mNumberKeysRounded),
+        handOver(mDeviceData->m_hostPermutations, sizeof(uint32_t) * mNumberKeysRounded),
+    };
+    if (event) {
+        CommandQueue.enqueueMarkerWithWaitList(&transfers, event);
+    }
 }
 
 template <typename DataType>
-OperationStatus RadixSortGPU<DataType>::release()
+void RadixSortGPU<DataType>::MapDataFromDevice(
+    cl::CommandQueue CommandQueue,
+    const std::vector<cl::Event>* eventWaitList,
+    cl::Event* event)
 {
-    mDeviceData = nullptr;
-    return OperationStatus::OK;
-}
+    // After an odd number of passes the result resides in the device-only
+    // buffer and has to be moved into the host-wrapped one first.
+    const auto moveToHost = [&](const std::string& name, const cl::Buffer& hostBuffer, size_t sizeInBytes) {
+        cl_int error{CL_SUCCESS};
+        const auto& current = mDeviceData->m_dMemoryMap[name];
+        std::vector<cl::Event> waitList;
+        if (eventWaitList) {
+            waitList = *eventWaitList;
+        }
+        if (current() != hostBuffer()) {
+            cl::Event copied;
+            error = CommandQueue.enqueueCopyBuffer(
+                current,
+                hostBuffer,
+                0,
+                0,
+                sizeInBytes,
+                waitList.empty() ? nullptr : &waitList,
+                &copied
+            );
+            assert(error == CL_SUCCESS);
+            waitList = {copied};
+        }
+
+        constexpr auto isBlocking = CL_FALSE;
+        constexpr auto offset = 0U;
+        cl::Event mapped;
+        void* mappedPtr = CommandQueue.enqueueMapBuffer(
+            hostBuffer,
+            isBlocking,
+            CL_MAP_READ,
+            offset,
+            sizeInBytes,
+            waitList.empty() ? nullptr : &waitList,
+            &mapped,
+            &error
+        );
+        assert(error == CL_SUCCESS);
+        waitList = {mapped};
+        cl::Event unmapped;
+        error = CommandQueue.enqueueUnmapMemObject(hostBuffer, mappedPtr, &waitList, &unmapped);
+        assert(error == CL_SUCCESS);
+        return unmapped;
+    };
+
+    std::vector<cl::Event> transfers {
+        moveToHost("inputKeys", mDeviceData->m_hostKeys, sizeof(DataType) * mNumberKeysRounded),
+        moveToHost("inputPermutations", mDeviceData->m_hostPermutations, sizeof(uint32_t) * mNumberKeysRounded),
+    };
+    if (event) {
+        CommandQueue.enqueueMarkerWithWaitList(&transfers, event);
+    }
+}
+
+template <typename DataType>
+bool RadixSortGPU<DataType>::InitStaging(cl::Device Device, cl::Context Context)
+{
+    cl_int clError{CL_SUCCESS};
+    mTransferQueue = cl::CommandQueue(Context, Device, 0, &clError);
+    if (clError) {
+        std::cerr<<cl::util::Error(clError, "Failed to create the transfer queue").what()<<"\n";
+        return false;
+    }
+
+    // Chunk of keys covers as many bytes as the same chunk of permutations
+    static_assert(sizeof(DataType) >= sizeof(uint32_t));
+    const auto chunkBytes = sizeof(DataType) * mNumberKeysRounded / Parameters::_NUM_STAGING_CHUNKS;
+
+    for (auto i = 0U; i < Parameters::_NUM_STAGING_BUFFERS; i++) {
+        cl::Buffer staging(
+            Context,
+            CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR,
+            chunkBytes,
+            nullptr,
+            &clError
+        );
+        if (clError) {
+            std::cerr<<cl::util::Error(clError, "Failed to allocate pinned staging buffer").what()<<"\n";
+            return false;
+        }
+
+        // Mapped once, the pointer is pinned memory usable for DMA transfers
+        constexpr auto isBlocking = CL_TRUE;
+        void* mapped = mTransferQueue.enqueueMapBuffer(
+            staging,
+            isBlocking,
+            CL_MAP_READ | CL_MAP_WRITE,
+            0,
+            chunkBytes,
+            nullptr,
+            nullptr,
+            &clError
+        );
+        if (clError) {
+            std::cerr<<cl::util::Error(clError, "Failed to map pinned staging buffer").what()<<"\n";
+            return false;
+        }
+        mDeviceData->m_stagingBuffers.push_back(staging);
+        mDeviceData->m_stagingPointers.push_back(mapped);
+    }
+    return true;
+}
+
+template <typename DataType>
+void RadixSortGPU<DataType>::ReleaseStaging()
+{
+    auto& buffers {mDeviceData->m_stagingBuffers};
+    auto& pointers {mDeviceData->m_stagingPointers};
+    for (size_t i = 0U; i < buffers.size(); i++) {
+        mTransferQueue.enqueueUnmapMemObject(buffers[i], pointers[i]);
+    }
+    if (!buffers.empty()) {
+        mTransferQueue.finish();
+    }
+    buffers.clear();
+    pointers.clear();
+}
+
+template <typename DataType>
+void RadixSortGPU<DataType>::StageDataToDevice(cl::CommandQueue CommandQueue)
+{
+    const auto& pointers {mDeviceData->m_stagingPointers};
+    const auto numBuffers = pointers.size();
+    constexpr auto numChunks = Parameters::_NUM_STAGING_CHUNKS;
+    const auto groupsPerChunk = mConfig.groups / numChunks;
+
+    // Transfers must not overtake commands already enqueued on the compute queue (e.g. padding)
+    cl::Event computeReady;
+    CommandQueue.enqueueMarkerWithWaitList(nullptr, &computeReady);
+
+    // Copies a buffer in chunks: the host fills one pinned buffer while the
+    // previous one is being transferred. Calls onChunk with the transfer event.
+    const auto stage = [&](const cl::Buffer& target, const char* source, size_t totalBytes, auto&& onChunk) {
+        const auto chunkBytes = totalBytes / numChunks;
+        std::vector<cl::Event> inFlight(numBuffers);
+        for (size_t chunk = 0U; chunk < numChunks; chunk++) {
+            const auto slot = chunk % numBuffers;
+            if (chunk >= numBuffers) {
+                // pinned buffer is still read by an earlier transfer
+                inFlight[slot].wait();
+            }
+            std::memcpy(pointers[slot], source + chunk * chunkBytes, chunkBytes);
+
+            const std::vector<cl::Event> waitList {computeReady};
+            [[maybe_unused]] const auto error = mTransferQueue.enqueueWriteBuffer(
+                target,
+                CL_FALSE,
+                chunk * chunkBytes,
+                chunkBytes,
+                pointers[slot],
+                &waitList,
+                &inFlight[slot]
+            );
+            assert(error == CL_SUCCESS);
+            mTransferQueue.flush();
+            onChunk(chunk, inFlight[slot]);
+        }
+    };
+
+    // The range of the keys is unknown before they are uploaded
+    UseFullKeyRange();
+    stage(
+        mDeviceData->m_dMemoryMap["inputKeys"],
+        reinterpret_cast<const char*>(mHostSpans.m_hKeys.data()),
+        sizeof(DataType) * mNumberKeysRounded,
+        [&](size_t chunk, const cl::Event& transferred) {
+            // Histogram of the first pass for the groups covered by this chunk
+            // runs while the next chunk is transferred
+            const std::vector<cl::Event> waitList {transferred};
+            [[maybe_unused]] const auto error = EnqueueHistogram(
+                CommandQueue,
+                0,
+                chunk * groupsPerChunk,
+                groupsPerChunk,
+                &waitList,
+                nullptr
+            );
+            assert(error == CL_SUCCESS);
+            CommandQueue.flush();
+        }
+    );
+    mFirstHistogramReady = true;
+
+    stage(
+        mDeviceData->m_dMemoryMap["inputPermutations"],
+        reinterpret_cast<const char*>(mHostSpans.h_Permut.data()),
+        sizeof(uint32_t) * mNumberKeysRounded,
+        [](size_t, const cl::Event&) {}
+    );
+}
+
+template <typename DataType>
+void RadixSortGPU<DataType>::StageDataFromDevice(cl::CommandQueue CommandQueue)
+{
+    const auto& pointers {mDeviceData->m_stagingPointers};
+    const auto numBuffers = pointers.size();
+    constexpr auto numChunks = Parameters::_NUM_STAGING_CHUNKS;
+
+    // Results are complete once the last reorder has finished on the compute queue
+    cl::Event computeDone;
+    CommandQueue.enqueueMarkerWithWaitList(nullptr, &computeDone);
+    CommandQueue.flush();
+
+    // Transfers one chunk into pinned memory while the host copies out the previous one
+    const auto unstage = [&](const cl::Buffer& source, char* target, size_t totalBytes) {
+        const auto chunkBytes = totalBytes / numChunks;
+        std::vector<cl::Event> inFlight(numBuffers);
+        const auto copyOut = [&](size_t chunk) {
+            const auto slot = chunk % numBuffers;
+            inFlight[slot].wait();
+            std::memcpy(target + chunk * chunkBytes, pointers[slot], chunkBytes);
+        };
+
+        for (size_t chunk = 0U; chunk < numChunks; chunk++) {
+            const auto slot = chunk % numBuffers;
+            if (chunk >= numBuffers) {
+                copyOut(chunk - numBuffers);
+            }
+            const std::vector<cl::Event> waitList {computeDone};
+            [[maybe_unused]] const auto error = mTransferQueue.enqueueReadBuffer(
+                source,
+                CL_FALSE,
+                chunk * chunkBytes,
+                chunkBytes,
+                pointers[slot],
+                &waitList,
+                &inFlight[slot]
+            );
+            assert(error == CL_SUCCESS);
+            mTransferQueue.flush();
+        }
+        for (auto chunk = numChunks - std::min<size_t>(numChunks, numBuffers); chunk < numChunks; chunk++) {
+            copyOut(chunk);
+        }
+    };
+
+    unstage(
+        mDeviceData->m_dMemoryMap["inputKeys"],
+        reinterpret_cast<char*>(mHostSpans.m_hResultFromGPU.data()),
+        sizeof(DataType) * mNumberKeysRounded
+    );
+    unstage(
+        mDeviceData->m_dMemoryMap["inputPermutations"],
+        reinterpret_cast<char*>(mHostSpans.h_Permut.data()),
+        sizeof(uint32_t) * mNumberKeysRounded
+    );
+}
+
+template <typename DataType>
+bool RadixSortGPU<DataType>::CanWrapHostSpans(cl::Device Device) const
+{
+    // CL_DEVICE_MEM_BASE_ADDR_ALIGN is given in bits
+    const auto alignment = Device.getInfo<CL_DEVICE_MEM_BASE_ADDR_ALIGN>() / 8U;
+    const auto isAligned = [alignment](const void* ptr) {
+        return alignment == 0U || reinterpret_cast<std::uintptr_t>(ptr) % alignment == 0U;
+    };
+
+    return isAligned(mHostSpans.m_hKeys.data())
+        && isAligned(mHostSpans.h_Permut.data())
+        && mHostSpans.m_hKeys.size() >= mNumberKeysRounded
+        && mHostSpans.h_Permut.size() >= mNumberKeysRounded
+        && mHostSpans.m_hResultFromGPU.size() >= mNumberKeysRounded;
+}
+
+template <typename DataType>
+template <typename ValueType>
+std::string RadixSortGPU<DataType>::BuildPreamble(size_t indexSize)
+{
+    using UnsignedType = typename std::make_unsigned<DataType>::type;
+
+    const auto OFFSET { -std::numeric_limits<DataType>::min() };
+    // suffix keeps the literal within range of the OpenCL integer types
+    const auto MAXVALUE_SUFFIX { std::is_signed_v<DataType> ? "L" : "UL" };
+    std::stringstream ss;
+    ss << "#define DataType " << TypeNameString<DataType>::open_cl_name << std::endl
+       << "#define UnsignedDataType " << TypeNameString<UnsignedType>::open_cl_name << std::endl
+       << "#define OFFSET " << OFFSET << std::endl
+       << "#define IndexType " << (indexSize == sizeof(cl_ulong) ? "ulong" : "uint") << std::endl
+       << "#define ValueType " << TypeNameString<ValueType>::open_cl_name << std::endl
+       << "#define SumType " << (std::is_signed_v<ValueType> ? "long" : "ulong") << std::endl
+       << "#define MAXVALUE ((DataType)" << std::numeric_limits<DataType>::max() << MAXVALUE_SUFFIX << ")" << std::endl;
+    return ss.str();
+}
+
+template <typename DataType>
+OperationStatus RadixSortGPU<DataType>::release()
+{
+    if (mDeviceData) {
+        ReleaseStaging();
+    }
+    mDeviceData = nullptr;
+    return OperationStatus::OK;
+}
 
 template <typename DataType>
 OperationStatus RadixSortGPU<DataType>::initialize(
     cl::Device Device,
     cl::Context Context,
-    uint32_t nn,
+    size_t nn,
     const HostSpans<DataType>& hostSpans
 )
 {
@@ -460,17 +1181,48 @@ OperationStatus RadixSortGPU<DataType>::initialize(
 
     // handle host buffers and init context
     {
+        if (!mConfigSet) {
+            ApplyProfile(Device, nn, hostSpans);
+        }
+        mNumberKeys = nn;
         mNumberKeysRounded = Resize(nn);
         mHostSpans = hostSpans;
+
+        if (const auto error = ValidateConfig(Device, false); !error.empty()) {
+            std::cerr << "Invalid algorithm parameters: " << error << "\n";
+            return S::INITIALIZATION_FAILED;
+        }
+
+        if (mMemoryMode == MemoryMode::ZERO_COPY && !CanWrapHostSpans(Device)) {
+            std::cerr << "Host spans are not suitable for zero-copy, falling back to copying\n";
+            mMemoryMode = MemoryMode::COPY;
+        }
+
+        // keys are only bounded by the largest buffer of the device
+        const auto maxAlloc = Device.getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>();
+        if (sizeof(DataType) * mNumberKeysRounded > maxAlloc) {
+            std::cerr << "Key buffer of " << sizeof(DataType) * mNumberKeysRounded
+                      << " bytes exceeds the device allocation limit of " << maxAlloc << " bytes\n";
+            return S::INITIALIZATION_FAILED;
+        }
+
+        const auto wrappedSpans =
+            mMemoryMode == MemoryMode::ZERO_COPY ? &mHostSpans : nullptr;
         mDeviceData =
             std::make_shared<ComputeDeviceData<DataType>>(
                     Context,
-                    mNumberKeysRounded);
+                    mNumberKeysRounded,
+                    mConfig,
+                    wrappedSpans);
+
+        if (mMemoryMode == MemoryMode::STAGED && !InitStaging(Device, Context)) {
+            return S::HOST_BUFFERS_FAILED;
+        }
     }
 
     // compile and build program
     {
-        const auto preamble = BuildPreamble();
+        const auto preamble = BuildPreamble(mDeviceData->m_indexSize);
         std::string programCode = "";
         const auto candidates = make_array<std::string>(
             "RadixSort.cl",
@@ -509,6 +1261,7 @@ OperationStatus RadixSortGPU<DataType>::initialize(
             return S::LOADING_SOURCE_FAILED;
         }
         const auto completeCode = preamble + programCode;
+        mDeviceData->m_programCode = programCode;
 
         const auto options { BuildOptions() };
         mDeviceData->m_Program = cl::Program(Context, completeCode);
@@ -539,9 +1292,314 @@ OperationStatus RadixSortGPU<DataType>::initialize(
             }
         }
     }
+    if (const auto error = ValidateConfig(Device, true); !error.empty()) {
+        std::cerr << "Invalid algorithm parameters: " << error << "\n";
+        return S::KERNEL_CREATION_FAILED;
+    }
+
+    // size the local sort to the device: half of the local memory and a
+    // power of two number of keys, each work item handling two of them
+    {
+        const auto localMem = Device.getInfo<CL_DEVICE_LOCAL_MEM_SIZE>();
+        const auto maxGroupSize = mDeviceData->m_kernelMap["localsort"]
+            .template getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(Device);
+
+        size_t capacity = std::bit_floor(std::min<size_t>(
+            localMem / 2U / sizeof(DataType),
+            Parameters::_LOCAL_SORT_MAX_ELEMS
+        ));
+        mLocalSortCapacity = capacity;
+        mLocalSortGroupSize = std::bit_floor(std::min<size_t>({
+            maxGroupSize,
+            Parameters::_LOCAL_SORT_MAX_ITEMS,
+            std::max<size_t>(capacity / 2U, 1U)
+        }));
+    }
+    UseFullKeyRange();
+    if (!mLocalSortThresholdSet) {
+        mLocalSortThreshold = CalibrateLocalSort(Device, Context);
+    }
     return S::OK;
 }
 
+template <typename DataType>
+size_t RadixSortGPU<DataType>::localSortThreshold() const noexcept
+{
+    return std::min(mLocalSortThreshold, mLocalSortCapacity);
+}
+
+template <typename DataType>
+void RadixSortGPU<DataType>::setLocalSortThreshold(size_t threshold) noexcept
+{
+    mLocalSortThreshold = threshold;
+    mLocalSortThresholdSet = true;
+}
+
+template <typename DataType>
+bool RadixSortGPU<DataType>::UseLocalSort() const noexcept
+{
+    return mNumberKeysRounded > 0U
+        && std::bit_ceil(mNumberKeysRounded) <= localSortThreshold();
+}
+
+template <typename DataType>
+cl_int RadixSortGPU<DataType>::EnqueueLocalSortAll(
+    cl::CommandQueue CommandQueue,
+    const std::vector<cl::Event>* eventWaitList,
+    cl::Event* event)
+{
+    // The range buffer doubles as segment id list, its first entry is 0
+    auto& range {mDeviceData->m_dMemoryMap["localSortRange"]};
+    const std::array<uint32_t, 2> offsets{0U, static_cast<uint32_t>(mNumberKeysRounded)};
+    std::vector<cl::Event> filled(1);
+    auto error = CommandQueue.enqueueFillBuffer(
+        range,
+        offsets,
+        0,
+        sizeof(offsets),
+        eventWaitList,
+        filled.data()
+    );
+    if (error != CL_SUCCESS) {
+        return error;
+    }
+    return EnqueueLocalSort(
+        CommandQueue,
+        mDeviceData->m_dMemoryMap["inputKeys"],
+        range,
+        range,
+        0U,
+        1U,
+        static_cast<uint32_t>(std::bit_ceil(mNumberKeysRounded)),
+        &filled,
+        event
+    );
+}
+
+template <typename DataType>
+size_t RadixSortGPU<DataType>::CalibrateLocalSort(cl::Device Device, cl::Context Context)
+{
+    const size_t minSize = mConfig.numItems();
+    if (mLocalSortCapacity < minSize || mNumberKeysRounded < minSize) {
+        return 0U;
+    }
+
+    static std::mutex cacheMutex;
+    static std::map<std::string, size_t> cache;
+    const auto cacheKey = Device.getInfo<CL_DEVICE_NAME>() + "/"
+        + Device.getInfo<CL_DRIVER_VERSION>() + "/"
+        + std::string(TypeNameString<DataType>::open_cl_name) + "/"
+        + BuildOptions();
+    std::lock_guard lock(cacheMutex);
+    if (const auto it = cache.find(cacheKey); it != cache.end()) {
+        return it->second;
+    }
+
+    cl::CommandQueue queue(Context, Device);
+    const auto timeMin = [](auto&& run) {
+        double best = std::numeric_limits<double>::max();
+        for (auto i = 0U; i < Parameters::_NUM_PERFORMANCE_ITERATIONS; i++) {
+            CTimer timer;
+            timer.Start();
+            run();
+            timer.Stop();
+            best = std::min(best, timer.GetElapsedMilliseconds());
+        }
+        return best;
+    };
+
+    // Scratch keys, so that host memory wrapped by the key buffer stays untouched
+    const auto scratchSize = std::max(minSize, mLocalSortCapacity);
+    cl::Buffer scratch(Context, CL_MEM_READ_WRITE, sizeof(DataType) * scratchSize);
+    queue.enqueueFillBuffer(scratch, DataType{}, 0, sizeof(DataType) * scratchSize);
+
+    // The global passes at their smallest size, dominated by launch overhead.
+    // They only grow with the input, so this is a lower bound.
+    auto& memoryMap {mDeviceData->m_dMemoryMap};
+    const auto inputKeys = memoryMap["inputKeys"];
+    const auto outputKeys = memoryMap["outputKeys"];
+    const auto numberKeysRounded = mNumberKeysRounded;
+    const auto runtimes = mRuntimesGPU;
+    const auto outStream = mOutStream;
+    memoryMap["inputKeys"] = scratch;
+    mNumberKeysRounded = minSize;
+    const auto rangeReduction = mRangeReduction;
+    mOutStream = nullptr;
+    mLocalSortThreshold = 0U;
+    // equal scratch keys would need no pass at all, count as sorted and be counted
+    const auto presortedDetection = mPresortedDetection;
+    const auto countingSort = mCountingSort;
+    mRangeReduction = false;
+    mPresortedDetection = false;
+    mCountingSort = false;
+    const auto globalTime = timeMin([&]() { calculate(queue); });
+    mRangeReduction = rangeReduction;
+    mPresortedDetection = presortedDetection;
+    mCountingSort = countingSort;
+    memoryMap["inputKeys"] = inputKeys;
+    memoryMap["outputKeys"] = outputKeys;
+    mNumberKeysRounded = numberKeysRounded;
+    mRuntimesGPU = runtimes;
+    mOutStream = outStream;
+
+    // The local sort at growing sizes, as long as it is faster
+    size_t threshold = 0U;
+    auto& range {memoryMap["localSortRange"]};
+    for (size_t size = minSize; size <= mLocalSortCapacity; size *= 2U) {
+        const std::array<uint32_t, 2> offsets{0U, static_cast<uint32_t>(size)};
+        queue.enqueueFillBuffer(range, offsets, 0, sizeof(offsets));
+        const auto localTime = timeMin([&]() {
+            EnqueueLocalSort(queue, scratch, range, range, 0U, 1U, static_cast<uint32_t>(size), nullptr, nullptr);
+            queue.finish();
+        });
+        if (localTime >= globalTime) {
+            break;
+        }
+        threshold = size;
+    }
+
+    cache[cacheKey] = threshold;
+    return threshold;
+}
+
+template <typename DataType>
+size_t RadixSortGPU<DataType>::localSortCapacity() const noexcept
+{
+    return mLocalSortCapacity;
+}
+
+template <typename DataType>
+cl_int RadixSortGPU<DataType>::EnqueueLocalSort(
+    cl::CommandQueue CommandQueue,
+    const cl::Buffer& keys,
+    const cl::Buffer& segmentOffsets,
+    const cl::Buffer& segmentIds,
+    uint32_t firstSegment,
+    size_t numSegments,
+    uint32_t sortSize,
+    const std::vector<cl::Event>* eventWaitList,
+    cl::Event* event)
+{
+    assert(sortSize <= mLocalSortCapacity);
+    assert(std::has_single_bit(sortSize));
+
+    auto localSortKernel = mDeviceData->m_kernelMap["localsort"];
+    {
+        cl_uint argIdx = 0U;
+        localSortKernel.setArg(argIdx++, keys);
+        localSortKernel.setArg(argIdx++, segmentOffsets);
+        localSortKernel.setArg(argIdx++, segmentIds);
+        localSortKernel.setArg(argIdx++, firstSegment);
+        localSortKernel.setArg(argIdx++, cl::Local(sizeof(DataType) * sortSize));
+        localSortKernel.setArg(argIdx++, sortSize);
+    }
+
+    // one work-group per segment, small segments get smaller groups
+    const size_t nblocitems = std::min<size_t>(mLocalSortGroupSize, std::max<uint32_t>(sortSize / 2U, 1U));
+    const cl::NDRange globalWorkOffset = cl::NullRange;
+    const cl::NDRange globalWork{numSegments * nblocitems};
+    const cl::NDRange localWork{nblocitems};
+    return CommandQueue.enqueueNDRangeKernel(
+        localSortKernel,
+        globalWorkOffset,
+        globalWork,
+        localWork,
+        eventWaitList,
+        event
+    );
+}
+
+template <typename DataType>
+OperationStatus RadixSortGPU<DataType>::sortBuffer(
+    cl::CommandQueue CommandQueue,
+    const cl::Buffer& keys,
+    size_t offset,
+    size_t count
+)
+{
+    using S = OperationStatus;
+    const auto capacity = mNumberKeysRounded;
+    const auto numberKeys = mNumberKeys;
+    const auto numRounded = Resize(count);
+    if (numRounded > capacity) {
+        return S::RESIZE_FAILED;
+    }
+
+    // passes only cover the rounded range, the device buffers may be larger
+    mNumberKeys = count;
+    mNumberKeysRounded = numRounded;
+    mFirstHistogramReady = false;
+
+    // Small inputs are checked by calculate(), larger ones in place.
+    // Sorted and reversed keys never leave the buffer.
+    auto status = S::OK;
+    const auto localSort = UseLocalSort();
+    mSortPath = SortPath::RADIX;
+    if (mPresortedDetection && !localSort) {
+        auto err = DetectPresortedness(CommandQueue, keys, offset, count);
+        if (err == CL_SUCCESS && mSortPath == SortPath::REVERSED) {
+            err = EnqueueReverse(CommandQueue, keys, offset, count);
+        }
+        if (err == CL_SUCCESS && (mSortPath == SortPath::SORTED || mSortPath == SortPath::REVERSED)) {
+            err = CommandQueue.finish();
+        }
+        if (err != CL_SUCCESS) {
+            status = S::CALCULATION_FAILED;
+        }
+    }
+    if (status != S::OK || mSortPath == SortPath::SORTED || mSortPath == SortPath::REVERSED) {
+        mNumPasses = 0U;
+        mRuntimesGPU.path = mSortPath;
+        mNumberKeys = numberKeys;
+        mNumberKeysRounded = capacity;
+        return status;
+    }
+
+    const auto maxValue = std::numeric_limits<DataType>::max();
+    auto& inputKeys {mDeviceData->m_dMemoryMap["inputKeys"]};
+    CommandQueue.enqueueCopyBuffer(keys, inputKeys, sizeof(DataType) * offset, 0, sizeof(DataType) * count);
+    if (numRounded != count) {
+        CommandQueue.enqueueFillBuffer(inputKeys, maxValue, sizeof(DataType) * count, sizeof(DataType) * (numRounded - count));
+    }
+    // The passes are replayed from their recording for this size and buffers
+    // Padding beyond count sorts behind all keys, so it is left out of the range
+    if (localSort) {
+        status = calculate(CommandQueue);
+    } else if (mSortPath == SortPath::RUN_MERGE) {
+        mNumPasses = 0U;
+        status = MergeRuns(CommandQueue, count) == CL_SUCCESS ? S::OK : S::CALCULATION_FAILED;
+    } else {
+        if (mRangeReduction) {
+            status = ReduceKeyRange(CommandQueue, count) == CL_SUCCESS ? S::OK : S::CALCULATION_FAILED;
+        } else {
+            UseFullKeyRange();
+        }
+        bool counted = false;
+        if (status == S::OK && mCountingSort && mNumPasses > 1U
+            && SortByCounting(CommandQueue, count, counted) != CL_SUCCESS) {
+            status = S::CALCULATION_FAILED;
+        }
+        if (counted) {
+            mSortPath = SortPath::COUNTING;
+            mNumPasses = 0U;
+        }
+        // keys that are all equal need no pass at all
+        if (status == S::OK && mNumPasses > 0U && EnqueuePasses(CommandQueue, nullptr, nullptr) != CL_SUCCESS) {
+            status = S::CALCULATION_FAILED;
+        }
+    }
+    if (status == S::OK) {
+        // the sorted keys are in whatever buffer is the input after the last swap
+        CommandQueue.enqueueCopyBuffer(mDeviceData->m_dMemoryMap["inputKeys"], keys, 0, sizeof(DataType) * offset, sizeof(DataType) * count);
+        status = CommandQueue.finish() == CL_SUCCESS ? S::OK : S::CALCULATION_FAILED;
+    }
+    mRuntimesGPU.path = mSortPath;
+
+    mNumberKeys = numberKeys;
+    mNumberKeysRounded = capacity;
+    return status;
+}
+
 template <typename T>
 typename std::enable_if_t<!std::is_integral<T>::value>
 appendToOptions(std::string& dst, const std::string& key, const T& obj)
@@ -557,7 +1615,7 @@ appendToOptions(std::string& dst, const std::string& key, const T& value)
 }
 
 template <typename DataType>
-std::string RadixSortGPU<DataType>::BuildOptions()
+std::string RadixSortGPU<DataType>::BuildOptions() const
 {
     std::string options;
     //options += " -cl-opt-disable";
@@ -566,28 +1624,921 @@ std::string RadixSortGPU<DataType>::BuildOptions()
     {
         ///////////////////////////////////////////////////////
         // these parameters can be changed
-        appendToOptions(options, "_ITEMS", Parameters::_NUM_ITEMS_PER_GROUP); // number of items in a group
-        appendToOptions(options, "_GROUPS", Parameters::_NUM_GROUPS); // the number of virtual processors is Parameters::_NUM_ITEMS_PER_GROUP * Parameters::_NUM_GROUPS
-        appendToOptions(options, "_HISTOSPLIT", Parameters::_NUM_HISTOSPLIT); // number of splits of the histogram
+        appendToOptions(options, "_ITEMS", mConfig.itemsPerGroup); // number of items in a group
+        appendToOptions(options, "_GROUPS", mConfig.groups); // the number of virtual processors is _ITEMS * _GROUPS
+        appendToOptions(options, "_HISTOSPLIT", mConfig.histoSplit); // number of splits of the histogram
         appendToOptions(options, "_TOTALBITS", Parameters::_TOTALBITS);  // number of bits for the integer in the list (max=32)
-        appendToOptions(options, "_BITS", Parameters::_NUM_BITS_PER_RADIX);  // number of bits in the radix
-        // max size of the sorted vector
-        // it has to be divisible by  Parameters::_NUM_ITEMS_PER_GROUP * Parameters::_NUM_GROUPS
-        // (for other sizes, pad the list with big values)
-        appendToOptions(options, "_N", Parameters::_NUM_MAX_INPUT_ELEMS);// maximal size of the list
+        appendToOptions(options, "_BITS", mConfig.bitsPerRadix);  // number of bits in the radix
+        appendToOptions(options, "_SELECT_BITS", Parameters::_NUM_SELECT_BITS); // number of bits per radix select pass
         //#define PERMUT  // store the final permutation
         ////////////////////////////////////////////////////////
 
         // the following parameters are computed from the previous
-        appendToOptions(options, "_RADIX", Parameters::_RADIX);//  radix  = 2^_BITS
-        appendToOptions(options, "_PASS", Parameters::_NUM_PASSES); // number of needed passes to sort the list
-        appendToOptions(options, "_HISTOSIZE", Parameters::_HISTOSIZE);// size of the histogram
+        appendToOptions(options, "_RADIX", mConfig.radix());//  radix  = 2^_BITS
+        appendToOptions(options, "_PASS", mConfig.numPasses(Parameters::_TOTALBITS)); // number of needed passes to sort the list
+        appendToOptions(options, "_HISTOSIZE", mConfig.histoSize());// size of the histogram
         // maximal value of integers for the sort to be correct
         //appendToOptions(options, "_MAXINT", Parameters::_MAXINT);
     }
     return options;
 }
 
+template <typename DataType>
+std::string RadixSortGPU<DataType>::ValidateConfig(cl::Device Device, bool checkKernels) const
+{
+    if (!checkKernels) {
+        // positions of more than 2^32-1 keys need 64-bit histograms
+        const auto indexSize = mNumberKeysRounded > std::numeric_limits<cl_uint>::max()
+            ? sizeof(cl_ulong)
+            : sizeof(cl_uint);
+        auto error = mConfig.validate(
+            Parameters::_TOTALBITS,
+            Device.getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>(),
+            Device.getInfo<CL_DEVICE_LOCAL_MEM_SIZE>(),
+            indexSize
+        );
+        // staged chunks must cover whole groups to compute their histograms
+        if (error.empty() && mMemoryMode == MemoryMode::STAGED
+            && mConfig.groups % Parameters::_NUM_STAGING_CHUNKS != 0U) {
+            error = "Staged transfers need a multiple of "
+                + std::to_string(Parameters::_NUM_STAGING_CHUNKS) + " groups";
+        }
+        return error;
+    }
+
+    // kernels may be limited below the device maximum, e.g. by their register usage
+    const auto fits = [&](const char* kernelName, size_t groupSize) {
+        return groupSize <= mDeviceData->m_kernelMap[kernelName]
+            .template getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(Device);
+    };
+    if (!fits("histogram", mConfig.itemsPerGroup) || !fits("reorder", mConfig.itemsPerGroup)
+        || !fits("scanhistograms", std::max<size_t>(mConfig.scanGroupSize(), mConfig.histoSplit / 2U))
+        || !fits("pastehistograms", mConfig.scanGroupSize())) {
+        return "Work-group sizes exceed the kernel limits of the device";
+    }
+    return {};
+}
+
+template <typename DataType>
+cl_int RadixSortGPU<DataType>::ReduceKeyRange(cl::CommandQueue CommandQueue, size_t n)
+{
+    using UnsignedType = std::make_unsigned_t<DataType>;
+    auto& memoryMap {mDeviceData->m_dMemoryMap};
+    auto kernel = mDeviceData->m_kernelMap["keyrange"];
+    const size_t nblocitems = mConfig.itemsPerGroup;
+    {
+        cl_uint argIdx = 0U;
+        kernel.setArg(argIdx++, memoryMap["inputKeys"]);
+        kernel.setArg(argIdx++, memoryMap["groupKeyRanges"]);
+        kernel.setArg(argIdx++, cl::Local(sizeof(UnsignedType) * nblocitems));
+        kernel.setArg(argIdx++, cl::Local(sizeof(UnsignedType) * nblocitems));
+        SetIndexArg(kernel, argIdx++, n);
+    }
+    auto err = CommandQueue.enqueueNDRangeKernel(
+        kernel,
+        cl::NullRange,
+        cl::NDRange{mConfig.numItems()},
+        cl::NDRange{nblocitems}
+    );
+    if (err != CL_SUCCESS) {
+        return err;
+    }
+
+    // the number of passes is needed on the host to enqueue them
+    std::vector<UnsignedType> groupRanges(2U * mConfig.groups);
+    err = CommandQueue.enqueueReadBuffer(
+        memoryMap["groupKeyRanges"],
+        CL_TRUE,
+        0,
+        sizeof(UnsignedType) * groupRanges.size(),
+        groupRanges.data()
+    );
+    if (err != CL_SUCCESS) {
+        return err;
+    }
+    auto minKey = std::numeric_limits<UnsignedType>::max();
+    UnsignedType maxKey = 0U;
+    for (size_t group = 0U; group < mConfig.groups; group++) {
+        minKey = std::min(minKey, groupRanges[2U * group]);
+        maxKey = std::max(maxKey, groupRanges[2U * group + 1U]);
+    }
+    if (minKey > maxKey) {
+        // no keys
+        minKey = maxKey;
+    }
+
+    const std::array<UnsignedType, 2> keyRange {minKey, static_cast<UnsignedType>(maxKey - minKey)};
+    err = CommandQueue.enqueueWriteBuffer(
+        memoryMap["keyRange"],
+        CL_TRUE,
+        0,
+        sizeof(keyRange),
+        keyRange.data()
+    );
+    if (err != CL_SUCCESS) {
+        return err;
+    }
+    mKeySpan = keyRange[1];
+    const auto varyingBits = static_cast<uint32_t>(std::bit_width(keyRange[1]));
+    mNumPasses = (varyingBits + mConfig.bitsPerRadix - 1U) / mConfig.bitsPerRadix;
+    mRangeReduced = true;
+    return CL_SUCCESS;
+}
+
+template <typename DataType>
+void RadixSortGPU<DataType>::UseFullKeyRange()
+{
+    mNumPasses = mConfig.numPasses(Parameters::_TOTALBITS);
+    mRangeReduced = false;
+}
+
+template <typename DataType>
+cl_int RadixSortGPU<DataType>::DetectPresortedness(
+    cl::CommandQueue CommandQueue,
+    const cl::Buffer& keys,
+    size_t offset,
+    size_t n)
+{
+    auto& memoryMap {mDeviceData->m_dMemoryMap};
+    const auto indexSize = mDeviceData->m_indexSize;
+
+    auto kernel = mDeviceData->m_kernelMap["presortedness"];
+    const size_t nblocitems = mConfig.itemsPerGroup;
+    {
+        cl_uint argIdx = 0U;
+        kernel.setArg(argIdx++, keys);
+        SetIndexArg(kernel, argIdx++, offset);
+        SetIndexArg(kernel, argIdx++, n);
+        kernel.setArg(argIdx++, memoryMap["groupOrderCounts"]);
+        kernel.setArg(argIdx++, cl::Local(indexSize * nblocitems));
+        kernel.setArg(argIdx++, cl::Local(indexSize * nblocitems));
+    }
+    auto err = CommandQueue.enqueueNDRangeKernel(
+        kernel,
+        cl::NullRange,
+        cl::NDRange{mConfig.numItems()},
+        cl::NDRange{nblocitems}
+    );
+    if (err != CL_SUCCESS) {
+        return err;
+    }
+
+    // counts and positions are of the IndexType of the program
+    const auto readIndices = [&](const cl::Buffer& buffer, size_t count, std::vector<size_t>& values) {
+        values.resize(count);
+        const auto read = [&](auto index) {
+            std::vector<decltype(index)> raw(count);
+            const auto error = CommandQueue.enqueueReadBuffer(buffer, CL_TRUE, 0, sizeof(index) * count, raw.data());
+            std::ranges::copy(raw, values.begin());
+            return error;
+        };
+        return indexSize == sizeof(cl_ulong) ? read(cl_ulong{}) : read(cl_uint{});
+    };
+
+    // the path is needed on the host to enqueue its work
+    std::vector<size_t> groupCounts;
+    err = readIndices(memoryMap["groupOrderCounts"], 2U * mConfig.groups, groupCounts);
+    if (err != CL_SUCCESS) {
+        return err;
+    }
+    Presortedness order;
+    for (size_t group = 0U; group < mConfig.groups; group++) {
+        order.descents += groupCounts[2U * group];
+        order.ascents += groupCounts[2U * group + 1U];
+    }
+    mSortPath = selectSortPath(order, Parameters::_MAX_MERGE_RUNS);
+    if (mSortPath != SortPath::RUN_MERGE) {
+        return CL_SUCCESS;
+    }
+
+    // a merge of at most _MAX_MERGE_RUNS runs has few descents to locate
+    err = CommandQueue.enqueueFillBuffer(memoryMap["numRunStarts"], cl_uint{0U}, 0, sizeof(cl_uint));
+    if (err != CL_SUCCESS) {
+        return err;
+    }
+    kernel = mDeviceData->m_kernelMap["runstarts"];
+    {
+        cl_uint argIdx = 0U;
+        kernel.setArg(argIdx++, keys);
+        SetIndexArg(kernel, argIdx++, offset);
+        SetIndexArg(kernel, argIdx++, n);
+        kernel.setArg(argIdx++, memoryMap["numRunStarts"]);
+        kernel.setArg(argIdx++, memoryMap["runStarts"]);
+    }
+    err = CommandQueue.enqueueNDRangeKernel(
+        kernel,
+        cl::NullRange,
+        cl::NDRange{mConfig.numItems()},
+        cl::NDRange{nblocitems}
+    );
+    if (err != CL_SUCCESS) {
+        return err;
+    }
+
+    // work-items appended the run starts in any order
+    err = readIndices(memoryMap["runStarts"], order.descents, mRunOffsets);
+    std::ranges::sort(mRunOffsets);
+    mRunOffsets.insert(mRunOffsets.begin(), 0U);
+    mRunOffsets.push_back(n);
+    return err;
+}
+
+template <typename DataType>
+cl_int RadixSortGPU<DataType>::EnqueueReverse(
+    cl::CommandQueue CommandQueue,
+    const cl::Buffer& keys,
+    size_t offset,
+    size_t n)
+{
+    auto kernel = mDeviceData->m_kernelMap["reversekeys"];
+    {
+        cl_uint argIdx = 0U;
+        kernel.setArg(argIdx++, keys);
+        SetIndexArg(kernel, argIdx++, offset);
+        SetIndexArg(kernel, argIdx++, n);
+    }
+    return CommandQueue.enqueueNDRangeKernel(
+        kernel,
+        cl::NullRange,
+        cl::NDRange{mConfig.numItems()},
+        cl::NDRange{mConfig.itemsPerGroup}
+    );
+}
+
+template <typename DataType>
+cl_int RadixSortGPU<DataType>::MergeRuns(cl::CommandQueue CommandQueue, size_t n)
+{
+    auto& memoryMap {mDeviceData->m_dMemoryMap};
+    const auto indexSize = mDeviceData->m_indexSize;
+    const auto writeIndices = [&](const cl::Buffer& buffer, const std::vector<size_t>& values) {
+        const auto write = [&](auto index) {
+            const std::vector<decltype(index)> raw(values.begin(), values.end());
+            return CommandQueue.enqueueWriteBuffer(buffer, CL_TRUE, 0, sizeof(index) * raw.size(), raw.data());
+        };
+        return indexSize == sizeof(cl_ulong) ? write(cl_ulong{}) : write(cl_uint{});
+    };
+
+    auto kernel = mDeviceData->m_kernelMap["mergeruns"];
+    auto runOffsets = mRunOffsets;
+    while (runOffsets.size() > 2U) {
+        const auto numRuns = static_cast<cl_uint>(runOffsets.size() - 1U);
+        auto err = writeIndices(memoryMap["runOffsets"], runOffsets);
+        if (err != CL_SUCCESS) {
+            return err;
+        }
+        {
+            cl_uint argIdx = 0U;
+            kernel.setArg(argIdx++, memoryMap["inputKeys"]);
+            kernel.setArg(argIdx++, memoryMap["outputKeys"]);
+            kernel.setArg(argIdx++, memoryMap["runOffsets"]);
+            kernel.setArg(argIdx++, numRuns);
+            SetIndexArg(kernel, argIdx++, n);
+        }
+        err = CommandQueue.enqueueNDRangeKernel(
+            kernel,
+            cl::NullRange,
+            cl::NDRange{mConfig.numItems()},
+            cl::NDRange{mConfig.itemsPerGroup}
+        );
+        if (err != CL_SUCCESS) {
+            return err;
+        }
+        SwapBuffers();
+
+        // every pair of runs became one
+        std::vector<size_t> merged;
+        for (cl_uint run = 0U; run < numRuns; run += 2U) {
+            merged.push_back(runOffsets[run]);
+        }
+        merged.push_back(n);
+        runOffsets = std::move(merged);
+    }
+    return CL_SUCCESS;
+}
+
+template <typename DataType>
+cl_int RadixSortGPU<DataType>::SortByCounting(cl::CommandQueue CommandQueue, size_t n, bool& counted)
+{
+    counted = false;
+    // counts are 32 bits wide
+    if (mDeviceData->m_indexSize != sizeof(cl_uint)) {
+        return CL_SUCCESS;
+    }
+    auto& memoryMap {mDeviceData->m_dMemoryMap};
+    auto& kernelMap {mDeviceData->m_kernelMap};
+    const size_t nblocitems = mConfig.itemsPerGroup;
+    const cl::NDRange globalWork{mConfig.numItems()};
+    const cl::NDRange localWork{nblocitems};
+
+    cl_uint numDictionary = 0U;
+    cl_uint numBins = 0U;
+    auto err = CL_SUCCESS;
+    if (mRangeReduced && mKeySpan < Parameters::_MAX_COUNTING_RANGE) {
+        numBins = static_cast<cl_uint>(mKeySpan) + 1U;
+    } else if (n >= Parameters::_COUNTING_SAMPLE_SIZE) {
+        // a wide range may still hold few distinct keys
+        constexpr cl_uint sampleSize = Parameters::_COUNTING_SAMPLE_SIZE;
+        auto kernel = kernelMap["samplekeys"];
+        {
+            cl_uint argIdx = 0U;
+            kernel.setArg(argIdx++, memoryMap["inputKeys"]);
+            kernel.setArg(argIdx++, memoryMap["countingSample"]);
+            SetIndexArg(kernel, argIdx++, n);
+            kernel.setArg(argIdx++, sampleSize);
+        }
+        err = CommandQueue.enqueueNDRangeKernel(kernel, cl::NullRange, globalWork, localWork);
+        std::vector<DataType> sample(sampleSize);
+        if (err == CL_SUCCESS) {
+            err = CommandQueue.enqueueReadBuffer(memoryMap["countingSample"], CL_TRUE, 0, sizeof(DataType) * sampleSize, sample.data());
+        }
+        if (err != CL_SUCCESS) {
+            return err;
+        }
+        const auto dictionary = distinctKeys(std::move(sample), Parameters::_MAX_COUNTING_DICTIONARY);
+        if (dictionary.empty()) {
+            return CL_SUCCESS;
+        }
+        err = CommandQueue.enqueueWriteBuffer(memoryMap["countingDictionary"], CL_TRUE, 0, sizeof(DataType) * dictionary.size(), dictionary.data());
+        if (err != CL_SUCCESS) {
+            return err;
+        }
+        numDictionary = static_cast<cl_uint>(dictionary.size());
+        numBins = numDictionary;
+    } else {
+        return CL_SUCCESS;
+    }
+
+    err = CommandQueue.enqueueFillBuffer(memoryMap["counts"], cl_uint{0U}, 0, sizeof(cl_uint) * (numBins + 1U));
+    if (err != CL_SUCCESS) {
+        return err;
+    }
+    auto countKernel = kernelMap["countkeys"];
+    {
+        cl_uint argIdx = 0U;
+        countKernel.setArg(argIdx++, memoryMap["inputKeys"]);
+        countKernel.setArg(argIdx++, memoryMap["counts"]);
+        countKernel.setArg(argIdx++, memoryMap["keyRange"]);
+        countKernel.setArg(argIdx++, memoryMap["countingDictionary"]);
+        countKernel.setArg(argIdx++, numDictionary);
+        countKernel.setArg(argIdx++, numBins);
+        SetIndexArg(countKernel, argIdx++, n);
+    }
+    err = CommandQueue.enqueueNDRangeKernel(countKernel, cl::NullRange, globalWork, localWork);
+    if (err != CL_SUCCESS) {
+        return err;
+    }
+    if (numDictionary > 0U) {
+        // keys the sample missed are left to the radix passes
+        cl_uint missed = 0U;
+        err = CommandQueue.enqueueReadBuffer(memoryMap["counts"], CL_TRUE, sizeof(cl_uint) * numBins, sizeof(cl_uint), &missed);
+        if (err != CL_SUCCESS || missed != 0U) {
+            return err;
+        }
+    }
+
+    auto scanKernel = kernelMap["scancounts"];
+    {
+        cl_uint argIdx = 0U;
+        scanKernel.setArg(argIdx++, memoryMap["counts"]);
+        scanKernel.setArg(argIdx++, cl::Local(sizeof(cl_uint) * nblocitems));
+        scanKernel.setArg(argIdx++, numBins);
+    }
+    err = CommandQueue.enqueueNDRangeKernel(scanKernel, cl::NullRange, localWork, localWork);
+    if (err != CL_SUCCESS) {
+        return err;
+    }
+
+    auto expandKernel = kernelMap["expandcounts"];
+    {
+        cl_uint argIdx = 0U;
+        expandKernel.setArg(argIdx++, memoryMap["counts"]);
+        expandKernel.setArg(argIdx++, memoryMap["outputKeys"]);
+        expandKernel.setArg(argIdx++, memoryMap["keyRange"]);
+        expandKernel.setArg(argIdx++, memoryMap["countingDictionary"]);
+        expandKernel.setArg(argIdx++, numDictionary);
+        expandKernel.setArg(argIdx++, numBins);
+        SetIndexArg(expandKernel, argIdx++, n);
+    }
+    err = CommandQueue.enqueueNDRangeKernel(expandKernel, cl::NullRange, globalWork, localWork);
+    if (err != CL_SUCCESS) {
+        return err;
+    }
+    SwapBuffers();
+    counted = true;
+    return CL_SUCCESS;
+}
+
+template <typename DataType>
+cl_int RadixSortGPU<DataType>::SelectKeys(
+    cl::CommandQueue CommandQueue,
+    const cl::Buffer& keys,
+    size_t offset,
+    size_t n,
+    std::span<const size_t> ranks,
+    std::vector<SelectedKey<DataType>>& selected)
+{
+    using UnsignedType = std::make_unsigned_t<DataType>;
+    constexpr auto BITS = Parameters::_NUM_SELECT_BITS;
+    constexpr size_t RADIX = size_t{1U} << BITS;
+    // the histograms of a digit share the counts of the counting sort
+    constexpr size_t maxHistograms = Parameters::_MAX_COUNTING_RANGE / RADIX;
+    auto& memoryMap {mDeviceData->m_dMemoryMap};
+    auto kernel = mDeviceData->m_kernelMap["selecthistogram"];
+    const size_t nblocitems = mConfig.itemsPerGroup;
+
+    selected.assign(ranks.size(), {});
+    std::vector<size_t> remaining(ranks.begin(), ranks.end());
+    std::vector<UnsignedType> prefixes(ranks.size(), 0U);
+    std::vector<cl_uint> counts;
+    for (size_t first = 0U; first < ranks.size(); first += maxHistograms) {
+        const auto last = std::min(ranks.size(), first + maxHistograms);
+        for (auto shift = Parameters::_TOTALBITS; shift > 0U;) {
+            shift -= BITS;
+            // ranks within the same bucket share its histogram
+            std::vector<UnsignedType> histogramPrefixes(prefixes.begin() + first, prefixes.begin() + last);
+            std::ranges::sort(histogramPrefixes);
+            histogramPrefixes.erase(std::ranges::unique(histogramPrefixes).begin(), histogramPrefixes.end());
+            const auto numHistograms = histogramPrefixes.size();
+
+            auto err = CommandQueue.enqueueFillBuffer(memoryMap["counts"], cl_uint{0U}, 0, sizeof(cl_uint) * RADIX * numHistograms);
+            for (size_t h = 0U; h < numHistograms && err == CL_SUCCESS; h++) {
+                cl_uint argIdx = 0U;
+                kernel.setArg(argIdx++, keys);
+                SetIndexArg(kernel, argIdx++, offset);
+                SetIndexArg(kernel, argIdx++, n);
+                kernel.setArg(argIdx++, histogramPrefixes[h]);
+                kernel.setArg(argIdx++, static_cast<cl_uint>(shift));
+                kernel.setArg(argIdx++, memoryMap["counts"]);
+                kernel.setArg(argIdx++, static_cast<cl_uint>(h));
+                kernel.setArg(argIdx++, cl::Local(sizeof(cl_uint) * RADIX));
+                err = CommandQueue.enqueueNDRangeKernel(
+                    kernel,
+                    cl::NullRange,
+                    cl::NDRange{mConfig.numItems()},
+                    cl::NDRange{nblocitems}
+                );
+            }
+            // only the bucket counts leave the device, the bucket of a rank
+            // is needed on the host to count the next digit within it
+            counts.resize(RADIX * numHistograms);
+            if (err == CL_SUCCESS) {
+                err = CommandQueue.enqueueReadBuffer(memoryMap["counts"], CL_TRUE, 0, sizeof(cl_uint) * counts.size(), counts.data());
+            }
+            if (err != CL_SUCCESS) {
+                return err;
+            }
+
+            for (auto q = first; q < last; q++) {
+                const auto h = static_cast<size_t>(std::ranges::lower_bound(histogramPrefixes, prefixes[q]) - histogramPrefixes.begin());
+                const auto* histogram = counts.data() + h * RADIX;
+                size_t digit = 0U;
+                while (remaining[q] >= histogram[digit]) {
+                    remaining[q] -= histogram[digit];
+                    selected[q].below += histogram[digit];
+                    digit++;
+                }
+                selected[q].equal = histogram[digit];
+                prefixes[q] = static_cast<UnsignedType>((prefixes[q] << BITS) | digit);
+            }
+        }
+    }
+    // the kernels added OFFSET, which flips the sign bit like orderedKey()
+    for (size_t q = 0U; q < ranks.size(); q++) {
+        selected[q].key = static_cast<DataType>(orderedKey(static_cast<DataType>(prefixes[q])));
+    }
+    return CL_SUCCESS;
+}
+
+template <typename DataType>
+cl_int RadixSortGPU<DataType>::SortPairs(
+    cl::CommandQueue CommandQueue,
+    const cl::Buffer& keys,
+    size_t offset,
+    size_t n)
+{
+    auto& memoryMap {mDeviceData->m_dMemoryMap};
+    const size_t nblocitems = mConfig.itemsPerGroup;
+    const auto maxValue = std::numeric_limits<DataType>::max();
+    auto err = CommandQueue.enqueueCopyBuffer(keys, memoryMap["inputKeys"], sizeof(DataType) * offset, 0, sizeof(DataType) * n);
+    // padding sorts behind all keys, its positions are never read
+    if (err == CL_SUCCESS && mNumberKeysRounded != n) {
+        err = CommandQueue.enqueueFillBuffer(memoryMap["inputKeys"], maxValue, sizeof(DataType) * n, sizeof(DataType) * (mNumberKeysRounded - n));
+    }
+    if (err == CL_SUCCESS) {
+        auto kernel = mDeviceData->m_kernelMap["initpermutation"];
+        kernel.setArg(0, memoryMap["inputPermutations"]);
+        SetIndexArg(kernel, 1, mNumberKeysRounded);
+        err = CommandQueue.enqueueNDRangeKernel(
+            kernel,
+            cl::NullRange,
+            cl::NDRange{mConfig.numItems()},
+            cl::NDRange{nblocitems}
+        );
+    }
+    if (err == CL_SUCCESS) {
+        if (mRangeReduction) {
+            err = ReduceKeyRange(CommandQueue, n);
+        } else {
+            UseFullKeyRange();
+        }
+    }
+
+    // the recorded passes only move keys, these move their permutations along
+    for (uint32_t pass = 0U; pass < mNumPasses && err == CL_SUCCESS; pass++) {
+        err = EnqueueHistogram(CommandQueue, pass, 0U, mConfig.groups, nullptr, nullptr);
+        if (err == CL_SUCCESS) {
+            err = EnqueueScanHistogram(CommandQueue, nullptr, nullptr);
+        }
+        if (err == CL_SUCCESS) {
+            err = EnqueuePasteHistogram(CommandQueue, nullptr, nullptr);
+        }
+        if (err == CL_SUCCESS) {
+            err = EnqueueLaunch(CommandQueue, ReorderLaunch(mDeviceData->m_kernelMap["reorderpairs"], pass), nullptr, nullptr);
+            SwapBuffers();
+        }
+    }
+    return err;
+}
+
+template <typename DataType>
+template <typename ValueType>
+std::map<std::string, cl::Kernel>& RadixSortGPU<DataType>::SegmentKernels(cl::CommandQueue CommandQueue)
+{
+    // values of the key type are aggregated by the kernels of the sort program
+    if constexpr (std::is_same_v<ValueType, DataType>) {
+        return mDeviceData->m_kernelMap;
+    }
+    auto& cache {mDeviceData->m_valueKernels};
+    const std::string valueName {TypeNameString<ValueType>::open_cl_name};
+    if (const auto found = cache.find(valueName); found != cache.end()) {
+        return found->second;
+    }
+
+    const auto completeCode = BuildPreamble<ValueType>(mDeviceData->m_indexSize) + mDeviceData->m_programCode;
+    const auto options { BuildOptions() };
+    cl::Program program(CommandQueue.getInfo<CL_QUEUE_CONTEXT>(), completeCode);
+    program.build(CommandQueue.getInfo<CL_QUEUE_DEVICE>(), options.c_str());
+
+    std::map<std::string, cl::Kernel> kernels;
+    for (const auto* kernelName : {"segmentreduce", "segmentscan", "segmentemit"}) {
+        kernels[kernelName] = cl::Kernel(program, kernelName);
+    }
+    return cache[valueName] = std::move(kernels);
+}
+
+template <typename DataType>
+template <typename ValueType>
+cl_int RadixSortGPU<DataType>::ReduceSegments(
+    cl::CommandQueue CommandQueue,
+    const cl::Buffer& values,
+    size_t offset,
+    size_t n,
+    const AggregateBuffers<DataType, ValueType>& result,
+    size_t& numUnique)
+{
+    auto& memoryMap {mDeviceData->m_dMemoryMap};
+    auto& kernelMap {SegmentKernels<ValueType>(CommandQueue)};
+    const size_t nblocitems = mConfig.itemsPerGroup;
+    // a record per work item, scanned by a single work-group
+    const auto numRecords = mConfig.numItems();
+
+    auto reduceKernel = kernelMap["segmentreduce"];
+    {
+        cl_uint argIdx = 0U;
+        reduceKernel.setArg(argIdx++, memoryMap["inputKeys"]);
+        reduceKernel.setArg(argIdx++, memoryMap["inputPermutations"]);
+        reduceKernel.setArg(argIdx++, values);
+        SetIndexArg(reduceKernel, argIdx++, offset);
+        reduceKernel.setArg(argIdx++, memoryMap["segmentHeads"]);
+        reduceKernel.setArg(argIdx++, memoryMap["segmentCounts"]);
+        reduceKernel.setArg(argIdx++, memoryMap["segmentSums"]);
+        reduceKernel.setArg(argIdx++, memoryMap["segmentMins"]);
+        reduceKernel.setArg(argIdx++, memoryMap["segmentMaxs"]);
+        SetIndexArg(reduceKernel, argIdx++, n);
+    }
+    auto err = CommandQueue.enqueueNDRangeKernel(
+        reduceKernel,
+        cl::NullRange,
+        cl::NDRange{numRecords},
+        cl::NDRange{nblocitems}
+    );
+
+    if (err == CL_SUCCESS) {
+        auto scanKernel = kernelMap["segmentscan"];
+        cl_uint argIdx = 0U;
+        scanKernel.setArg(argIdx++, memoryMap["segmentHeads"]);
+        scanKernel.setArg(argIdx++, memoryMap["segmentCounts"]);
+        scanKernel.setArg(argIdx++, memoryMap["segmentSums"]);
+        scanKernel.setArg(argIdx++, memoryMap["segmentMins"]);
+        scanKernel.setArg(argIdx++, memoryMap["segmentMaxs"]);
+        scanKernel.setArg(argIdx++, cl::Local(sizeof(cl_uint) * nblocitems));
+        scanKernel.setArg(argIdx++, cl::Local(sizeof(cl_uint) * nblocitems));
+        scanKernel.setArg(argIdx++, cl::Local(sizeof(AggregateSum<ValueType>) * nblocitems));
+        scanKernel.setArg(argIdx++, cl::Local(sizeof(ValueType) * nblocitems));
+        scanKernel.setArg(argIdx++, cl::Local(sizeof(ValueType) * nblocitems));
+        scanKernel.setArg(argIdx++, static_cast<cl_uint>(numRecords));
+        err = CommandQueue.enqueueNDRangeKernel(
+            scanKernel,
+            cl::NullRange,
+            cl::NDRange{nblocitems},
+            cl::NDRange{nblocitems}
+        );
+    }
+
+    if (err == CL_SUCCESS) {
+        auto emitKernel = kernelMap["segmentemit"];
+        cl_uint argIdx = 0U;
+        emitKernel.setArg(argIdx++, memoryMap["inputKeys"]);
+        emitKernel.setArg(argIdx++, memoryMap["inputPermutations"]);
+        emitKernel.setArg(argIdx++, values);
+        SetIndexArg(emitKernel, argIdx++, offset);
+        emitKernel.setArg(argIdx++, memoryMap["segmentHeads"]);
+        emitKernel.setArg(argIdx++, memoryMap["segmentCounts"]);
+        emitKernel.setArg(argIdx++, memoryMap["segmentSums"]);
+        emitKernel.setArg(argIdx++, memoryMap["segmentMins"]);
+        emitKernel.setArg(argIdx++, memoryMap["segmentMaxs"]);
+        emitKernel.setArg(argIdx++, result.keys);
+        emitKernel.setArg(argIdx++, result.counts);
+        emitKernel.setArg(argIdx++, result.sums);
+        emitKernel.setArg(argIdx++, result.mins);
+        emitKernel.setArg(argIdx++, result.maxs);
+        SetIndexArg(emitKernel, argIdx++, n);
+        err = CommandQueue.enqueueNDRangeKernel(
+            emitKernel,
+            cl::NullRange,
+            cl::NDRange{numRecords},
+            cl::NDRange{nblocitems}
+        );
+    }
+
+    // only the number of segments the scan appended is read back
+    cl_uint numSegments{0U};
+    if (err == CL_SUCCESS) {
+        err = CommandQueue.enqueueReadBuffer(memoryMap["segmentHeads"], CL_TRUE, sizeof(cl_uint) * numRecords, sizeof(cl_uint), &numSegments);
+    }
+    numUnique = numSegments;
+    return err;
+}
+
+template <typename DataType>
+OperationStatus RadixSortGPU<DataType>::selectBuffer(
+    cl::CommandQueue CommandQueue,
+    const cl::Buffer& keys,
+    size_t offset,
+    size_t count,
+    size_t rank,
+    DataType& key
+)
+{
+    using S = OperationStatus;
+    // counts are 32 bits wide
+    if (!mDeviceData || mDeviceData->m_indexSize != sizeof(cl_uint) || rank >= count) {
+        return S::CALCULATION_FAILED;
+    }
+    std::vector<SelectedKey<DataType>> selected;
+    if (SelectKeys(CommandQueue, keys, offset, count, std::span<const size_t>(&rank, 1U), selected) != CL_SUCCESS) {
+        return S::CALCULATION_FAILED;
+    }
+    key = selected.front().key;
+    return S::OK;
+}
+
+template <typename DataType>
+OperationStatus RadixSortGPU<DataType>::quantilesBuffer(
+    cl::CommandQueue CommandQueue,
+    const cl::Buffer& keys,
+    size_t offset,
+    size_t count,
+    std::span<const double> probabilities,
+    std::vector<DataType>& quantiles
+)
+{
+    using S = OperationStatus;
+    // counts are 32 bits wide
+    if (!mDeviceData || mDeviceData->m_indexSize != sizeof(cl_uint) || count == 0U) {
+        return S::CALCULATION_FAILED;
+    }
+    std::vector<size_t> ranks;
+    for (const auto p : probabilities) {
+        ranks.push_back(quantileRank(p, count));
+    }
+    std::vector<SelectedKey<DataType>> selected;
+    if (SelectKeys(CommandQueue, keys, offset, count, std::span<const size_t>(ranks), selected) != CL_SUCCESS) {
+        return S::CALCULATION_FAILED;
+    }
+    quantiles.clear();
+    for (const auto& entry : selected) {
+        quantiles.push_back(entry.key);
+    }
+    return S::OK;
+}
+
+template <typename DataType>
+template <typename ValueType>
+OperationStatus RadixSortGPU<DataType>::reduceByKeyBuffer(
+    cl::CommandQueue CommandQueue,
+    const cl::Buffer& keys,
+    const cl::Buffer& values,
+    size_t offset,
+    size_t count,
+    const AggregateBuffers<DataType, ValueType>& result,
+    size_t& numUnique
+)
+{
+    using S = OperationStatus;
+    numUnique = 0U;
+    // permutations and counts are 32 bits wide
+    if (!mDeviceData || mDeviceData->m_indexSize != sizeof(cl_uint)) {
+        return S::CALCULATION_FAILED;
+    }
+    if (count == 0U) {
+        return S::OK;
+    }
+    const auto capacity = mNumberKeysRounded;
+    const auto numRounded = Resize(count);
+    if (numRounded > capacity) {
+        return S::RESIZE_FAILED;
+    }
+
+    // passes only cover the rounded range, the device buffers may be larger
+    mNumberKeysRounded = numRounded;
+    auto err = SortPairs(CommandQueue, keys, offset, count);
+    mNumberKeysRounded = capacity;
+    if (err == CL_SUCCESS) {
+        err = ReduceSegments(CommandQueue, values, offset, count, result, numUnique);
+    }
+    return err == CL_SUCCESS ? S::OK : S::CALCULATION_FAILED;
+}
+
+template <typename DataType>
+OperationStatus RadixSortGPU<DataType>::partialSortBuffer(
+    cl::CommandQueue CommandQueue,
+    const cl::Buffer& keys,
+    size_t offset,
+    size_t count,
+    size_t k,
+    bool largest
+)
+{
+    using S = OperationStatus;
+    using UnsignedType = std::make_unsigned_t<DataType>;
+    if (Resize(count) > mNumberKeysRounded) {
+        return S::RESIZE_FAILED;
+    }
+    k = std::min(k, count);
+    if (k == 0U) {
+        return S::OK;
+    }
+    // counts and part offsets are 32 bits wide
+    if (mDeviceData->m_indexSize != sizeof(cl_uint)) {
+        auto status = sortBuffer(CommandQueue, keys, offset, count);
+        if (status == S::OK && largest
+            && (EnqueueReverse(CommandQueue, keys, offset, count) != CL_SUCCESS || CommandQueue.finish() != CL_SUCCESS)) {
+            status = S::CALCULATION_FAILED;
+        }
+        return status;
+    }
+
+    auto& memoryMap {mDeviceData->m_dMemoryMap};
+    const size_t rank = largest ? count - k : k - 1U;
+    std::vector<SelectedKey<DataType>> selected;
+    auto err = SelectKeys(CommandQueue, keys, offset, count, std::span<const size_t>(&rank, 1U), selected);
+    if (err != CL_SUCCESS) {
+        return S::CALCULATION_FAILED;
+    }
+    const auto& pivot = selected.front();
+
+    // keys before the pivot come first, then the keys equal to it fill up to k
+    const auto before = largest ? count - pivot.below - pivot.equal : pivot.below;
+    const std::array<cl_uint, 3> partOffsets {
+        0U,
+        static_cast<cl_uint>(before),
+        static_cast<cl_uint>(before + pivot.equal)
+    };
+    err = CommandQueue.enqueueWriteBuffer(memoryMap["selectOffsets"], CL_TRUE, 0, sizeof(partOffsets), partOffsets.data());
+    if (err != CL_SUCCESS) {
+        return S::CALCULATION_FAILED;
+    }
+    auto kernel = mDeviceData->m_kernelMap["partitionselect"];
+    {
+        cl_uint argIdx = 0U;
+        kernel.setArg(argIdx++, keys);
+        SetIndexArg(kernel, argIdx++, offset);
+        kernel.setArg(argIdx++, memoryMap["outputKeys"]);
+        kernel.setArg(argIdx++, static_cast<UnsignedType>(orderedKey(pivot.key)));
+        kernel.setArg(argIdx++, static_cast<cl_uint>(largest));
+        kernel.setArg(argIdx++, memoryMap["selectOffsets"]);
+        kernel.setArg(argIdx++, cl::Local(sizeof(cl_uint) * 3U));
+        kernel.setArg(argIdx++, cl::Local(sizeof(cl_uint) * 3U));
+        SetIndexArg(kernel, argIdx++, count);
+    }
+    err = CommandQueue.enqueueNDRangeKernel(
+        kernel,
+        cl::NullRange,
+        cl::NDRange{mConfig.numItems()},
+        cl::NDRange{mConfig.itemsPerGroup}
+    );
+    if (err == CL_SUCCESS) {
+        err = CommandQueue.enqueueCopyBuffer(memoryMap["outputKeys"], keys, 0, sizeof(DataType) * offset, sizeof(DataType) * count);
+    }
+    if (err != CL_SUCCESS) {
+        return S::CALCULATION_FAILED;
+    }
+
+    // only the keys before the pivot are sorted, in place
+    if (before > 1U) {
+        const auto status = sortBuffer(CommandQueue, keys, offset, before);
+        if (status != S::OK) {
+            return status;
+        }
+    }
+    if (largest && before > 1U) {
+        err = EnqueueReverse(CommandQueue, keys, offset, before);
+    }
+    if (err == CL_SUCCESS) {
+        err = CommandQueue.finish();
+    }
+    return err == CL_SUCCESS ? S::OK : S::CALCULATION_FAILED;
+}
+
+template <typename DataType>
+void RadixSortGPU<DataType>::setCountingSort(bool enabled) noexcept
+{
+    mCountingSort = enabled;
+}
+
+template <typename DataType>
+void RadixSortGPU<DataType>::setPresortedDetection(bool enabled) noexcept
+{
+    mPresortedDetection = enabled;
+}
+
+template <typename DataType>
+void RadixSortGPU<DataType>::setRangeReduction(bool enabled) noexcept
+{
+    mRangeReduction = enabled;
+}
+
+template <typename DataType>
+uint32_t RadixSortGPU<DataType>::numPasses() const noexcept
+{
+    return mNumPasses;
+}
+
+template <typename DataType>
+void RadixSortGPU<DataType>::ApplyProfile(
+    cl::Device Device,
+    size_t nn,
+    const HostSpans<DataType>& hostSpans)
+{
+    const auto profile = DeviceProfile::Load(DeviceProfile::PathFor(Device));
+    const auto config = profile
+        ? profile->find(std::string(TypeNameString<DataType>::open_cl_name))
+        : std::nullopt;
+    if (!config) {
+        return;
+    }
+
+    // Callers size host spans with Resize() before initialize(), possibly
+    // for the compile-time parameters. Keys must fit either way.
+    const auto numItems = config->numItems();
+    const auto numRounded = (nn + numItems - 1U) / numItems * numItems;
+    const auto fits = [numRounded](const auto& span) { return span.empty() || span.size() >= numRounded; };
+    if (!fits(hostSpans.m_hKeys) || !fits(hostSpans.h_Permut) || !fits(hostSpans.m_hResultFromGPU)
+        || sizeof(DataType) * numRounded > Device.getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>()) {
+        return;
+    }
+    const auto error = config->validate(
+        Parameters::_TOTALBITS,
+        Device.getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>(),
+        Device.getInfo<CL_DEVICE_LOCAL_MEM_SIZE>(),
+        numRounded > std::numeric_limits<cl_uint>::max() ? sizeof(cl_ulong) : sizeof(cl_uint)
+    );
+    const auto stageable = mMemoryMode != MemoryMode::STAGED
+        || config->groups % Parameters::_NUM_STAGING_CHUNKS == 0U;
+    if (!error.empty() || !stageable) {
+        return;
+    }
+    mConfig = *config;
+    if (mOutStream) {
+        *mOutStream << "Using tuned parameters " << mConfig.itemsPerGroup << "x" << mConfig.groups
+                    << ", " << mConfig.bitsPerRadix << " bits, " << mConfig.histoSplit << " splits" << std::endl;
+    }
+}
+
+template <typename DataType>
+void RadixSortGPU<DataType>::setConfig(const RadixSortConfig& config) noexcept
+{
+    mConfig = config;
+    mConfigSet = true;
+}
+
+template <typename DataType>
+const RadixSortConfig& RadixSortGPU<DataType>::config() const noexcept
+{
+    return mConfig;
+}
+
 template <typename DataType>
 RuntimesGPU RadixSortGPU<DataType>::getRuntimes() const
 {
@@ -600,3 +2551,20 @@ template class RadixSortGPU < int64_t >;
 template class RadixSortGPU < uint32_t >;
 template class RadixSortGPU < uint64_t >;
 
+// Specialize reduceByKeyBuffer for the supported key and value types.
+#define INSTANTIATE_REDUCE_BY_KEY(KeyType, ValueType) \
+    template OperationStatus RadixSortGPU<KeyType>::reduceByKeyBuffer<ValueType>( \
+        cl::CommandQueue, const cl::Buffer&, const cl::Buffer&, size_t, size_t, \
+        const AggregateBuffers<KeyType, ValueType>&, size_t&);
+#define INSTANTIATE_REDUCE_BY_KEY_VALUES(KeyType) \
+    INSTANTIATE_REDUCE_BY_KEY(KeyType, int32_t) \
+    INSTANTIATE_REDUCE_BY_KEY(KeyType, int64_t) \
+    INSTANTIATE_REDUCE_BY_KEY(KeyType, uint32_t) \
+    INSTANTIATE_REDUCE_BY_KEY(KeyType, uint64_t)
+INSTANTIATE_REDUCE_BY_KEY_VALUES(int32_t)
+INSTANTIATE_REDUCE_BY_KEY_VALUES(int64_t)
+INSTANTIATE_REDUCE_BY_KEY_VALUES(uint32_t)
+INSTANTIATE_REDUCE_BY_KEY_VALUES(uint64_t)
+#undef INSTANTIATE_REDUCE_BY_KEY_VALUES
+#undef INSTANTIATE_REDUCE_BY_KEY
+
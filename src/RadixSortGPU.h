@@ -7,31 +7,65 @@
 #include "HostData.h"
 #include "Statistics.h"
 #include "OperationStatus.h"
+#include "MemoryMode.h"
+#include "RadixSortConfig.h"
+#include "SortHandle.h"
+#include "RecordedPasses.h"
+#include "Presortedness.h"
+#include "RadixSelect.h"
+#include "ReduceByKey.h"
 
 #include <memory>
+#include <span>
 #include <iostream>
 #include <cstdint>
+#include <map>
 #include <string>
+#include <type_traits>
+#include <vector>
 
 /// Runtime statistics of GPU implementation algorithms
 /// @note Radix sort specific
 struct RuntimesGPU {
+    Statistics timeUpload{};
+    Statistics timeDownload{};
     Statistics timeHisto{};
     Statistics timeScan{};
     Statistics timeReorder{};
     Statistics timePaste{};
+    Statistics timeLocalSort{};
+    Statistics timeKeyRange{};
+    /// Presortedness check, including the shortcut it selected
+    Statistics timePresorted{};
+    /// Counting sort of keys of a small range or few distinct values
+    Statistics timeCounting{};
     Statistics timeTotal{};
+    /// Path taken by the last sort
+    SortPath path{SortPath::RADIX};
+};
+
+/// Device buffers receiving the output of reduceByKeyBuffer(),
+/// each holding an entry per key reduced
+template <typename DataType, typename ValueType = DataType>
+struct AggregateBuffers {
+    /// Distinct keys in ascending order
+    cl::Buffer keys;
+    /// Number of values per key as cl_uint
+    cl::Buffer counts;
+    /// Sum of the values per key as AggregateSum<ValueType>
+    cl::Buffer sums;
+    /// Minimum and maximum value per key as ValueType
+    cl::Buffer mins;
+    cl::Buffer maxs;
 };
 
 template <typename DataType>
 struct ComputeDeviceData;
 
-/// TODO: Avoid clFinish calls
-///       For profiling use clGetEventProfilingInfo api
-///       Provide more granular API:
-///        +writeData()
-///        +sort()
-///        +readData()
+template <typename DataType>
+class SegmentedRadixSortGPU;
+
+/// TODO: For profiling use clGetEventProfilingInfo api
 template <typename DataType>
 class RadixSortGPU
 {
@@ -41,7 +75,7 @@ public:
     OperationStatus initialize(
         cl::Device Device,
         cl::Context Context,
-        uint32_t nn,
+        size_t nn,
         const HostSpans<DataType>& hostSpans
     );
 
@@ -51,7 +85,9 @@ public:
         cl::CommandQueue CommandQueue
     );
 
-    /// Performs radix sort algorithm on previously provided data
+    /// Performs radix sort algorithm on previously provided data.
+    /// Every step is timed on its own, sortAsync() and sortBuffer()
+    /// replay the recorded passes instead.
     /// @param CommandQueue OpenCL Command Queue
 	OperationStatus calculate(
         cl::CommandQueue CommandQueue
@@ -63,6 +99,28 @@ public:
         cl::CommandQueue CommandQueue
     );
 
+    /// Enqueues upload, sort and download without blocking.
+    /// Host spans must stay untouched until the returned handle has completed.
+    /// @note No runtimes are recorded. Staged transfers are replaced by direct
+    ///       ones, and in zero-copy mode the sorted keys remain in the key span.
+    /// @param CommandQueue OpenCL Command Queue, may be out-of-order
+    /// @return Handle completing once the result is on the host, or
+    ///         reporting the error if the sort could not be enqueued
+    SortHandle sortAsync(
+        cl::CommandQueue CommandQueue
+    );
+
+    /// Enqueues an asynchronous sort starting after another operation
+    /// @param CommandQueue OpenCL Command Queue, may be out-of-order
+    /// @param after Handle the sort depends on, e.g. of a previous sort.
+    ///              If it failed, so does this sort without being enqueued.
+    /// @return Handle completing once the result is on the host, or
+    ///         reporting the error if the sort could not be enqueued
+    SortHandle sortAsync(
+        cl::CommandQueue CommandQueue,
+        const SortHandle& after
+    );
+
     /// Frees device buffers
     OperationStatus release();
 
@@ -70,11 +128,32 @@ public:
     /// @param[in,out] out Log text stream
     void setLogStream(std::ostream* out) noexcept;
 
-    /// Rounds argument to next multiple of NumItems.
+    /// Selects how host spans are exchanged with the device.
+    /// Must be called before initialize().
+    /// @param mode Requested memory mode
+    void setMemoryMode(MemoryMode mode) noexcept;
+
+    /// Returns memory mode in effect. Zero-copy falls back to copying
+    /// if the host spans do not meet the device alignment.
+    /// @return Effective memory mode
+    MemoryMode memoryMode() const noexcept;
+
+    /// Selects the algorithm parameters the kernels are built with,
+    /// validated against the device on initialize(). Without it,
+    /// initialize() takes the tuned parameters of the device profile.
+    /// Must be called before initialize() and Resize().
+    /// @param config Requested algorithm parameters
+    void setConfig(const RadixSortConfig& config) noexcept;
+
+    /// Returns algorithm parameters in effect
+    const RadixSortConfig& config() const noexcept;
+
+    /// Rounds argument to next multiple of the configured number of items.
     /// @return Possibly rounded up number of elements
-	uint32_t Resize(uint32_t nn) const noexcept;
+	size_t Resize(size_t nn) const noexcept;
 
-    /// Pads GPU data buffers
+    /// Pads GPU data buffers and records the actual number of keys,
+    /// which the pre-passes of calculate() are limited to
     /// @param CommandQueue OpenCL Command Queue
     /// @param paddingOffset Padding offset in bytes
 	void padGPUData(
@@ -82,6 +161,144 @@ public:
         size_t paddingOffset
     );
 
+    /// Sorts keys of a device buffer in place with the global passes,
+    /// moving them through the sorter's own device buffers
+    /// @param CommandQueue OpenCL Command Queue
+    /// @param keys Device buffer holding the keys
+    /// @param offset Index of the first key within keys
+    /// @param count Number of keys, at most the size passed to initialize()
+    OperationStatus sortBuffer(
+        cl::CommandQueue CommandQueue,
+        const cl::Buffer& keys,
+        size_t offset,
+        size_t count
+    );
+
+    /// Moves the k smallest keys of a device buffer to the front in ascending
+    /// order, or the k largest in descending order, the other keys follow in
+    /// unspecified order. A radix select finds the k-th key with a histogram
+    /// pass per _NUM_SELECT_BITS bits, only the keys before it are sorted.
+    /// The top-k keys are the first k keys afterwards.
+    /// @note Sorts all keys if the sorter was initialized for positions beyond 32 bits
+    /// @param CommandQueue OpenCL Command Queue
+    /// @param keys Device buffer holding the keys
+    /// @param offset Index of the first key within keys
+    /// @param count Number of keys, at most the size passed to initialize()
+    /// @param k Number of keys sorted, at most count
+    /// @param largest Selects the largest instead of the smallest keys
+    OperationStatus partialSortBuffer(
+        cl::CommandQueue CommandQueue,
+        const cl::Buffer& keys,
+        size_t offset,
+        size_t count,
+        size_t k,
+        bool largest = false
+    );
+
+    /// Finds the key at a position of the ascending order of a device buffer
+    /// without sorting or moving it. Every _NUM_SELECT_BITS bits take a
+    /// histogram pass, only the bucket counts are read back.
+    /// @note Needs a sorter initialized for positions of at most 32 bits
+    /// @param CommandQueue OpenCL Command Queue
+    /// @param keys Device buffer holding the keys
+    /// @param offset Index of the first key within keys
+    /// @param count Number of keys
+    /// @param rank Position in the sorted keys, less than count
+    /// @param[out] key Key at rank
+    OperationStatus selectBuffer(
+        cl::CommandQueue CommandQueue,
+        const cl::Buffer& keys,
+        size_t offset,
+        size_t count,
+        size_t rank,
+        DataType& key
+    );
+
+    /// Finds quantiles of a device buffer like selectBuffer(), see quantileRank().
+    /// Quantiles sharing the bucket of a digit share its histogram pass.
+    /// @param CommandQueue OpenCL Command Queue
+    /// @param keys Device buffer holding the keys
+    /// @param offset Index of the first key within keys
+    /// @param count Number of keys, not 0
+    /// @param probabilities Probabilities of the quantiles
+    /// @param[out] quantiles Quantile per probability
+    OperationStatus quantilesBuffer(
+        cl::CommandQueue CommandQueue,
+        const cl::Buffer& keys,
+        size_t offset,
+        size_t count,
+        std::span<const double> probabilities,
+        std::vector<DataType>& quantiles
+    );
+
+    /// Sorts the pairs of keys[offset, offset + count) and values[offset, offset + count)
+    /// by key and aggregates the values of every key, see reduceByKey(). The sort
+    /// carries the positions of the keys along, a segmented scan over the sorted
+    /// keys reads the values through them. Neither the sorted pairs nor the values
+    /// leave the device, the inputs are left unchanged.
+    /// @note Needs a sorter initialized for positions of at most 32 bits
+    /// @param CommandQueue OpenCL Command Queue
+    /// @param keys Device buffer holding the keys
+    /// @param values Device buffer holding a value per key
+    /// @param offset Index of the first key and value
+    /// @param count Number of pairs, at most the size passed to initialize()
+    /// @param result Buffers receiving the unique keys and their aggregates
+    /// @param[out] numUnique Number of distinct keys written to result
+    /// @tparam ValueType Type of the values, whose kernels are built on
+    ///         first use unless it is the key type
+    template <typename ValueType = DataType>
+    OperationStatus reduceByKeyBuffer(
+        cl::CommandQueue CommandQueue,
+        const cl::Buffer& keys,
+        const cl::Buffer& values,
+        size_t offset,
+        size_t count,
+        const AggregateBuffers<DataType, ValueType>& result,
+        size_t& numUnique
+    );
+
+    /// Checks whether the recorded passes are replayed through a
+    /// cl_khr_command_buffer instead of a prerecorded launch list
+    bool usesCommandBuffers() const noexcept;
+
+    /// Enables the pre-pass computing minimum and maximum of the keys,
+    /// after which only the bits that vary between keys are sorted.
+    /// Enabled by default. sortAsync() always runs all passes, since
+    /// the number of passes is only known once the pre-pass completed.
+    /// @param enabled Runs the pre-pass if set
+    void setRangeReduction(bool enabled) noexcept;
+
+    /// Returns number of global passes run by the last sort
+    uint32_t numPasses() const noexcept;
+
+    /// Enables the check for ascending, descending and few ascending runs
+    /// of keys. Ascending keys are left as they are, descending ones are
+    /// reversed and few runs are merged instead of running the passes.
+    /// Enabled by default, sortAsync() always runs the passes.
+    /// @param enabled Runs the check if set
+    void setPresortedDetection(bool enabled) noexcept;
+
+    /// Enables the counting sort of keys spanning at most _MAX_COUNTING_RANGE
+    /// values, or of keys with few distinct values in a sample of them.
+    /// It takes a single pass instead of the radix passes. Enabled by default,
+    /// sortAsync() always runs the passes.
+    /// @param enabled Counts keys if applicable
+    void setCountingSort(bool enabled) noexcept;
+
+    /// Returns the maximum number of keys a single work-group can sort
+    /// in local memory on the initialized device
+    size_t localSortCapacity() const noexcept;
+
+    /// Returns the largest power of two number of keys sorted by the
+    /// single work-group local sort instead of the global passes.
+    /// Measured per device and key type on initialize(), 0 if disabled.
+    size_t localSortThreshold() const noexcept;
+
+    /// Overrides the measured local sort threshold.
+    /// Calling it before initialize() skips the measurement.
+    /// @param threshold Number of keys, 0 disables the local sort
+    void setLocalSortThreshold(size_t threshold) noexcept;
+
     /// Returns runtimes of individual algorithm steps
     /// @return runtimes of individual algorithm steps
     RuntimesGPU getRuntimes() const;
@@ -93,20 +310,187 @@ public:
     ///        +reorder
 
 private:
+    template <typename> friend class SegmentedRadixSortGPU;
+
     using Parameters = AlgorithmParameters<DataType>;
 
-    static std::string BuildPreamble();
-    /// Compiles build options for OpenCL kernel
-    static std::string BuildOptions();
+    /// @param indexSize Size of key positions in bytes, selects IndexType
+    /// @tparam ValueType Type of the values aggregated by key
+    template <typename ValueType = DataType>
+    static std::string BuildPreamble(size_t indexSize);
+    /// Compiles build options for OpenCL kernel from the configuration
+    std::string BuildOptions() const;
+    /// Checks the configuration against the device and the built kernels
+    /// @return Reason the configuration is invalid, empty if valid
+    std::string ValidateConfig(cl::Device Device, bool checkKernels) const;
+    /// Takes the configuration of the device profile if there is one for
+    /// the key type and the host spans hold its rounded number of keys
+    void ApplyProfile(cl::Device Device, size_t nn, const HostSpans<DataType>& hostSpans);
+    /// Enqueues a kernel launch
+    static cl_int EnqueueLaunch(
+        cl::CommandQueue CommandQueue,
+        const RecordedLaunch& launch,
+        const std::vector<cl::Event>* eventWaitList,
+        cl::Event* event
+    );
+    /// Binds the arguments of the histogram of a range of groups to kernel
+    RecordedLaunch HistogramLaunch(cl::Kernel kernel, int pass, size_t firstGroup, size_t numGroups);
+    /// Binds the arguments of the local or global histogram scan to kernel
+    RecordedLaunch ScanHistogramLaunch(cl::Kernel kernel, bool globalSums);
+    /// Binds the arguments of the histogram paste to kernel
+    RecordedLaunch PasteHistogramLaunch(cl::Kernel kernel);
+    /// Binds the arguments of a reorder pass to kernel
+    RecordedLaunch ReorderLaunch(cl::Kernel kernel, int pass);
+    /// Swaps input and output keys and permutations after a reorder
+    void SwapBuffers();
+    /// Enqueues all passes from a recording of the current size and buffers,
+    /// recording them first if needed, and swaps buffers as the passes do
+	cl_int EnqueuePasses(
+        cl::CommandQueue CommandQueue,
+        const std::vector<cl::Event>* eventWaitList,
+        cl::Event* event
+    );
+    /// Enqueues histogram calculation for a contiguous range of groups
+    /// without waiting for its completion
+	cl_int EnqueueHistogram(
+        cl::CommandQueue CommandQueue,
+        int pass,
+        size_t firstGroup,
+        size_t numGroups,
+        const std::vector<cl::Event>* eventWaitList,
+        cl::Event* event
+    );
+    /// Enqueues the local sort of all rounded keys in inputKeys
+	cl_int EnqueueLocalSortAll(
+        cl::CommandQueue CommandQueue,
+        const std::vector<cl::Event>* eventWaitList,
+        cl::Event* event
+    );
+    /// Sets a key count argument matching the IndexType of the program
+    void SetIndexArg(cl::Kernel& kernel, cl_uint argIdx, size_t value) const;
+    /// Computes the range of the first n input keys on the device and
+    /// selects the passes over the bits that vary
+    cl_int ReduceKeyRange(cl::CommandQueue CommandQueue, size_t n);
+    /// Selects all passes over the full range of the key type
+    void UseFullKeyRange();
+    /// Counts descents and ascents of keys[offset, offset + n) on the device,
+    /// selects the sort path and keeps the run starts for a merge
+    cl_int DetectPresortedness(cl::CommandQueue CommandQueue, const cl::Buffer& keys, size_t offset, size_t n);
+    /// Enqueues the in-place reversal of keys[offset, offset + n)
+    cl_int EnqueueReverse(cl::CommandQueue CommandQueue, const cl::Buffer& keys, size_t offset, size_t n);
+    /// Merges the detected runs of the first n input keys pairwise,
+    /// swapping buffers after every level
+    cl_int MergeRuns(cl::CommandQueue CommandQueue, size_t n);
+    /// Sorts the first n input keys by counting them if their range is small
+    /// or a sample finds few distinct keys, swapping buffers
+    /// @param[out] counted Set if the keys were sorted
+    cl_int SortByCounting(cl::CommandQueue CommandQueue, size_t n, bool& counted);
+    /// Finds the keys at positions ranks of the ascending order of keys[offset, offset + n)
+    /// digit by digit, only the bucket counts of every digit are read back
+    cl_int SelectKeys(
+        cl::CommandQueue CommandQueue,
+        const cl::Buffer& keys,
+        size_t offset,
+        size_t n,
+        std::span<const size_t> ranks,
+        std::vector<SelectedKey<DataType>>& selected
+    );
+    /// Sorts keys[offset, offset + n) into inputKeys with the global passes,
+    /// inputPermutations receives the position every key came from
+    cl_int SortPairs(cl::CommandQueue CommandQueue, const cl::Buffer& keys, size_t offset, size_t n);
+    /// Returns the segment kernels for values of another type than the keys,
+    /// built from the program source on first use
+    template <typename ValueType>
+    std::map<std::string, cl::Kernel>& SegmentKernels(cl::CommandQueue CommandQueue);
+    /// Aggregates the values of the n keys sorted by SortPairs() per key
+    template <typename ValueType>
+    cl_int ReduceSegments(
+        cl::CommandQueue CommandQueue,
+        const cl::Buffer& values,
+        size_t offset,
+        size_t n,
+        const AggregateBuffers<DataType, ValueType>& result,
+        size_t& numUnique
+    );
+    /// Checks whether the current input is sorted in local memory
+    bool UseLocalSort() const noexcept;
+    /// Finds the largest size at which the local sort beats the global
+    /// passes. Results are cached per device and key type.
+    size_t CalibrateLocalSort(cl::Device Device, cl::Context Context);
     /// Performs histogram calculation
 	void Histogram(cl::CommandQueue CommandQueue, int pass);
+    /// Enqueues local and global histogram scans
+	cl_int EnqueueScanHistogram(
+        cl::CommandQueue CommandQueue,
+        const std::vector<cl::Event>* eventWaitList,
+        cl::Event* event
+    );
+    /// Enqueues pasting of the scanned local histograms
+	cl_int EnqueuePasteHistogram(
+        cl::CommandQueue CommandQueue,
+        const std::vector<cl::Event>* eventWaitList,
+        cl::Event* event
+    );
     /// Performs histogram scan
 	void ScanHistogram(cl::CommandQueue CommandQueue);
+    /// Enqueues reorder step and swaps input and output buffers
+	cl_int EnqueueReorder(
+        cl::CommandQueue CommandQueue,
+        int pass,
+        const std::vector<cl::Event>* eventWaitList,
+        cl::Event* event
+    );
     /// Performs reorder step
 	void Reorder(cl::CommandQueue CommandQueue, int pass);
+    /// Enqueues the bitonic local memory sort of segments
+    /// segmentIds[firstSegment, firstSegment + numSegments) of at most sortSize keys
+	cl_int EnqueueLocalSort(
+        cl::CommandQueue CommandQueue,
+        const cl::Buffer& keys,
+        const cl::Buffer& segmentOffsets,
+        const cl::Buffer& segmentIds,
+        uint32_t firstSegment,
+        size_t numSegments,
+        uint32_t sortSize,
+        const std::vector<cl::Event>* eventWaitList,
+        cl::Event* event
+    );
 
-	void CopyDataToDevice(cl::CommandQueue CommandQueue);
-	void CopyDataFromDevice(cl::CommandQueue CommandQueue);
+    /// Enqueues transfers, event (if given) completes with all of them
+	void CopyDataToDevice(
+        cl::CommandQueue CommandQueue,
+        const std::vector<cl::Event>* eventWaitList = nullptr,
+        cl::Event* event = nullptr
+    );
+	void CopyDataFromDevice(
+        cl::CommandQueue CommandQueue,
+        const std::vector<cl::Event>* eventWaitList = nullptr,
+        cl::Event* event = nullptr
+    );
+    /// Synchronizes host-wrapped buffers instead of copying
+	void MapDataToDevice(
+        cl::CommandQueue CommandQueue,
+        const std::vector<cl::Event>* eventWaitList = nullptr,
+        cl::Event* event = nullptr
+    );
+	void MapDataFromDevice(
+        cl::CommandQueue CommandQueue,
+        const std::vector<cl::Event>* eventWaitList = nullptr,
+        cl::Event* event = nullptr
+    );
+    /// Downloads auxiliary histogram buffers
+	void CopyHistogramsFromDevice(cl::CommandQueue CommandQueue);
+    /// Chunked transfers through the pinned staging ring on the transfer queue.
+    /// Uploading keys computes the first histogram pass chunk by chunk.
+	void StageDataToDevice(cl::CommandQueue CommandQueue);
+	void StageDataFromDevice(cl::CommandQueue CommandQueue);
+    /// Allocates and persistently maps the pinned staging ring
+    bool InitStaging(cl::Device Device, cl::Context Context);
+    /// Unmaps the pinned staging ring
+    void ReleaseStaging();
+
+    /// Checks whether host spans can be wrapped by device buffers
+    bool CanWrapHostSpans(cl::Device Device) const;
 
     /// Device program, kernels and buffers
     std::shared_ptr<ComputeDeviceData<DataType>> mDeviceData;
@@ -117,8 +501,49 @@ private:
     RuntimesGPU mRuntimesGPU{};
 
     // list of keys
-    uint32_t mNumberKeysRounded{0U}; // next multiple of _ITEMS*_GROUPS
+    size_t mNumberKeys{0U}; // actual number of keys, without padding
+    size_t mNumberKeysRounded{0U}; // next multiple of _ITEMS*_GROUPS
 
     /// log stream used for debugging
     std::ostream* mOutStream{nullptr};
+
+    /// Host/device memory exchange strategy
+    MemoryMode mMemoryMode{MemoryMode::COPY};
+
+    /// Algorithm parameters, the compile-time ones unless set
+    RadixSortConfig mConfig{RadixSortConfig::Defaults<DataType>()};
+    /// Set if the configuration was provided by the user
+    bool mConfigSet{false};
+
+    /// Runs the key range pre-pass
+    bool mRangeReduction{true};
+    /// Set if the passes are bound to the reduced key range
+    bool mRangeReduced{false};
+    /// Number of passes over the selected key range
+    uint32_t mNumPasses{0U};
+    /// Difference of maximum and minimum key of the reduced range
+    std::make_unsigned_t<DataType> mKeySpan{0U};
+    /// Counts keys of a small range or few distinct values
+    bool mCountingSort{true};
+
+    /// Runs the presortedness check
+    bool mPresortedDetection{true};
+    /// Path selected by the last check
+    SortPath mSortPath{SortPath::RADIX};
+    /// Starts of the detected runs with the number of keys appended
+    std::vector<size_t> mRunOffsets;
+
+    /// Second queue used for staged transfers
+    cl::CommandQueue mTransferQueue;
+    /// Set if the histogram of the first pass was computed during upload
+    bool mFirstHistogramReady{false};
+
+    /// Keys sortable in local memory by one work-group, power of two
+    size_t mLocalSortCapacity{0U};
+    /// Work-group size of the local sort, power of two
+    size_t mLocalSortGroupSize{1U};
+    /// Inputs up to this size are sorted in local memory
+    size_t mLocalSortThreshold{0U};
+    /// Set if the threshold was provided by the user
+    bool mLocalSortThresholdSet{false};
 };
@@ -1,7 +1,10 @@
 #pragma once
 
 #include "Parameters.h"
+#include "MemoryMode.h"
+#include "RadixSortConfig.h"
 
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -13,18 +16,25 @@ struct RadixSortOptions
     bool perf_to_csv;
     bool perf_csv_to_stdout;
     bool verbose;
+    /// Host/device memory exchange strategy
+    MemoryMode memory_mode;
+    /// Algorithm parameters the kernels are built with,
+    /// those of the device profile if none are given
+    std::optional<RadixSortConfig> config;
 
     explicit RadixSortOptions(std::vector<std::string> args) :
-        num_elements(AlgorithmParameters<float>::_NUM_MAX_INPUT_ELEMS),
+        num_elements(AlgorithmParameters<float>::_NUM_DEFAULT_INPUT_ELEMS),
         perf_to_stdout(false),
         perf_to_csv(false),
         perf_csv_to_stdout(false),
-        verbose(false)
+        verbose(false),
+        memory_mode(MemoryMode::COPY),
+        config{}
     {
         for (std::size_t i = 0; i < args.size(); i++) {
             auto arg = args[i];
             if (arg == "--num-elements") {
-                num_elements = std::stoi(args[i + 1]);
+                num_elements = std::stoull(args[i + 1]);
                 i++;
             } else if (arg == "--perf-to-stdout") {
                 perf_to_stdout = true;
@@ -34,6 +44,26 @@ struct RadixSortOptions
                 perf_csv_to_stdout = true;
             } else if (arg == "-v" || arg == "--verbose") {
                 verbose = true;
+            } else if (arg == "--zero-copy") {
+                memory_mode = MemoryMode::ZERO_COPY;
+            } else if (arg == "--staged") {
+                memory_mode = MemoryMode::STAGED;
+            } else if (arg == "--items-per-group") {
+                config = config.value_or(RadixSortConfig{});
+                config->itemsPerGroup = static_cast<uint32_t>(std::stoul(args[i + 1]));
+                i++;
+            } else if (arg == "--groups") {
+                config = config.value_or(RadixSortConfig{});
+                config->groups = static_cast<uint32_t>(std::stoul(args[i + 1]));
+                i++;
+            } else if (arg == "--histosplit") {
+                config = config.value_or(RadixSortConfig{});
+                config->histoSplit = static_cast<uint32_t>(std::stoul(args[i + 1]));
+                i++;
+            } else if (arg == "--bits") {
+                config = config.value_or(RadixSortConfig{});
+                config->bitsPerRadix = static_cast<uint32_t>(std::stoul(args[i + 1]));
+                i++;
             }
         }
     }
@@ -0,0 +1,223 @@
+#include "RadixSortPipeline.h"
+
+#include <CL/Utils/Error.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+template <typename DataType>
+RadixSortPipeline<DataType>::~RadixSortPipeline()
+{
+    release();
+}
+
+template <typename DataType>
+OperationStatus RadixSortPipeline<DataType>::initialize(
+    cl::Device Device,
+    cl::Context Context,
+    std::size_t maxBatchSize,
+    std::size_t numSlots
+)
+{
+    using S = OperationStatus;
+    mMaxBatchSize = maxBatchSize;
+    mStopping = false;
+
+    for (std::size_t i = 0U; i < numSlots; i++) {
+        auto slot = std::make_unique<Slot>();
+
+        // Every slot gets its own in-order queue, the device may execute them concurrently
+        cl_int clError{CL_SUCCESS};
+        slot->queue = cl::CommandQueue(Context, Device, 0, &clError);
+        if (clError) {
+            std::cerr<<cl::util::Error(clError, "Failed to create pipeline slot queue").what()<<"\n";
+            return S::INITIALIZATION_FAILED;
+        }
+
+        const auto numRounded = slot->sorter.Resize(maxBatchSize);
+        auto& buffers {slot->hostBuffers};
+        buffers.m_hKeys.resize(numRounded);
+        buffers.m_hResultFromGPU.resize(numRounded);
+        buffers.h_Permut.resize(numRounded);
+        buffers.m_hHistograms.resize(Parameters::_RADIX * Parameters::_NUM_ITEMS);
+        buffers.m_hGlobsum.resize(Parameters::_NUM_HISTOSPLIT);
+
+        HostSpans<DataType> spans {
+            {buffers.m_hKeys.data(), buffers.m_hKeys.size()},
+            {buffers.m_hHistograms.data(), buffers.m_hHistograms.size()},
+            {buffers.m_hGlobsum.data(), buffers.m_hGlobsum.size()},
+            {buffers.h_Permut.data(), buffers.h_Permut.size()},
+            {buffers.m_hResultFromGPU.data(), buffers.m_hResultFromGPU.size()},
+        };
+        const auto status = slot->sorter.initialize(
+            Device,
+            Context,
+            maxBatchSize,
+            spans
+        );
+        if (status != S::OK) {
+            return status;
+        }
+        mSlots.push_back(std::move(slot));
+    }
+
+    for (auto& slot : mSlots) {
+        slot->worker = std::thread([this, &slot = *slot]() { WorkerLoop(slot); });
+    }
+    return S::OK;
+}
+
+template <typename DataType>
+std::future<typename RadixSortPipeline<DataType>::Batch>
+RadixSortPipeline<DataType>::submit(Batch batch, Callback onSorted)
+{
+    Job job;
+    job.keys = std::move(batch);
+    job.onSorted = std::move(onSorted);
+    job.submitted = Clock::now();
+    auto future = job.promise.get_future();
+
+    if (job.keys.size() > mMaxBatchSize) {
+        job.promise.set_exception(std::make_exception_ptr(
+            std::length_error("Batch exceeds the maximum batch size of the pipeline")));
+        return future;
+    }
+
+    {
+        std::lock_guard lock(mMutex);
+        mJobs.push_back(std::move(job));
+        mNumOutstanding++;
+    }
+    mJobAvailable.notify_one();
+    return future;
+}
+
+template <typename DataType>
+void RadixSortPipeline<DataType>::drain()
+{
+    std::unique_lock lock(mMutex);
+    mJobDone.wait(lock, [this]() { return mNumOutstanding == 0U; });
+}
+
+template <typename DataType>
+OperationStatus RadixSortPipeline<DataType>::release()
+{
+    {
+        std::lock_guard lock(mMutex);
+        mStopping = true;
+    }
+    mJobAvailable.notify_all();
+    for (auto& slot : mSlots) {
+        if (slot->worker.joinable()) {
+            slot->worker.join();
+        }
+        slot->sorter.release();
+    }
+    mSlots.clear();
+    return OperationStatus::OK;
+}
+
+template <typename DataType>
+PipelineStatistics RadixSortPipeline<DataType>::getStatistics() const
+{
+    std::lock_guard lock(mMutex);
+
+    PipelineStatistics stats;
+    stats.numBatches = mLatencies.size();
+    for (const auto latency : mLatencies) {
+        stats.latency.update(latency);
+    }
+    stats.latencyP50 = percentile(mLatencies, 50.0);
+    stats.latencyP90 = percentile(mLatencies, 90.0);
+    stats.latencyP99 = percentile(mLatencies, 99.0);
+
+    // Steady state: completions after the first one, excluding pipeline fill
+    const std::chrono::duration<double> elapsed = mLastCompletion - mFirstCompletion;
+    if (stats.numBatches > 1U && elapsed.count() > 0.0) {
+        stats.batchesPerSecond = static_cast<double>(stats.numBatches - 1U) / elapsed.count();
+    }
+    return stats;
+}
+
+template <typename DataType>
+void RadixSortPipeline<DataType>::WorkerLoop(Slot& slot)
+{
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock lock(mMutex);
+            mJobAvailable.wait(lock, [this]() { return mStopping || !mJobs.empty(); });
+            if (mJobs.empty()) {
+                return;
+            }
+            job = std::move(mJobs.front());
+            mJobs.pop_front();
+        }
+
+        try {
+            SortBatch(slot, job);
+        } catch (...) {
+            // OpenCL errors surface as exceptions, hand them to the waiting caller
+            job.promise.set_exception(std::current_exception());
+        }
+
+        {
+            std::lock_guard lock(mMutex);
+            mNumOutstanding--;
+        }
+        mJobDone.notify_all();
+    }
+}
+
+template <typename DataType>
+void RadixSortPipeline<DataType>::SortBatch(Slot& slot, Job& job)
+{
+    using S = OperationStatus;
+    auto& buffers {slot.hostBuffers};
+    const auto numKeys = job.keys.size();
+
+    // Pad with the maximum so that padding sorts behind the batch
+    std::copy(job.keys.begin(), job.keys.end(), buffers.m_hKeys.begin());
+    std::fill(buffers.m_hKeys.begin() + numKeys, buffers.m_hKeys.end(), std::numeric_limits<DataType>::max());
+    std::iota(buffers.h_Permut.begin(), buffers.h_Permut.end(), 0U);
+
+    auto status = slot.sorter.uploadData(slot.queue);
+    if (status == S::OK) {
+        status = slot.sorter.calculate(slot.queue);
+    }
+    if (status == S::OK) {
+        status = slot.sorter.downloadData(slot.queue);
+    }
+    if (status != S::OK) {
+        job.promise.set_exception(std::make_exception_ptr(
+            std::runtime_error("Sorting batch on device failed")));
+        return;
+    }
+
+    // Reuse the batch storage for the result
+    std::copy_n(buffers.m_hResultFromGPU.begin(), numKeys, job.keys.begin());
+
+    const auto completed = Clock::now();
+    {
+        std::lock_guard lock(mMutex);
+        if (mLatencies.empty()) {
+            mFirstCompletion = completed;
+        }
+        mLastCompletion = completed;
+        mLatencies.push_back(std::chrono::duration<double, std::milli>(completed - job.submitted).count());
+    }
+
+    if (job.onSorted) {
+        job.onSorted(job.keys);
+    }
+    job.promise.set_value(std::move(job.keys));
+}
+
+// Specialize RadixSortPipeline for the supported types.
+template class RadixSortPipeline < int32_t >;
+template class RadixSortPipeline < int64_t >;
+template class RadixSortPipeline < uint32_t >;
+template class RadixSortPipeline < uint64_t >;
@@ -0,0 +1,117 @@
+#pragma once
+
+#define CL_HPP_MINIMUM_OPENCL_VERSION 120
+#define CL_HPP_TARGET_OPENCL_VERSION 120
+#include <CL/opencl.hpp>
+
+#include "RadixSortGPU.h"
+#include "HostData.h"
+#include "Statistics.h"
+#include "OperationStatus.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Throughput and latency of a batch pipeline
+struct PipelineStatistics {
+    /// Number of completed batches
+    std::size_t numBatches{0U};
+    /// Completed batches per second between first and last completion
+    double batchesPerSecond{0.0};
+    /// Submit-to-completion latency in ms
+    Statistics latency{};
+    double latencyP50{0.0};
+    double latencyP90{0.0};
+    double latencyP99{0.0};
+};
+
+/// Sorts a stream of independent batches with several device slots in flight.
+/// Each slot owns its sorter, host buffers and in-order queue, so that the
+/// upload of one batch overlaps the sort and download of the others.
+/// @tparam DataType Type of data to be sorted
+template <typename DataType>
+class RadixSortPipeline
+{
+public:
+    using Batch    = std::vector<DataType>;
+    /// Invoked on a worker thread with the sorted batch
+    using Callback = std::function<void(const Batch&)>;
+
+    RadixSortPipeline() = default;
+    ~RadixSortPipeline();
+
+    RadixSortPipeline(const RadixSortPipeline&) = delete;
+    RadixSortPipeline& operator=(const RadixSortPipeline&) = delete;
+
+    /// Creates device slots and starts their workers
+    /// @param Device OpenCL device
+    /// @param Context OpenCL context
+    /// @param maxBatchSize Maximum number of keys per batch
+    /// @param numSlots Number of batches in flight, typically 2 or 3
+    OperationStatus initialize(
+        cl::Device Device,
+        cl::Context Context,
+        std::size_t maxBatchSize,
+        std::size_t numSlots = 3U
+    );
+
+    /// Enqueues a batch for sorting
+    /// @param batch Keys, at most maxBatchSize
+    /// @param onSorted Optional completion callback, called before the future is ready
+    /// @return Future of the sorted batch
+    std::future<Batch> submit(Batch batch, Callback onSorted = {});
+
+    /// Blocks until all submitted batches are completed
+    void drain();
+
+    /// Stops workers and frees device resources
+    OperationStatus release();
+
+    /// Returns statistics of all batches completed so far
+    PipelineStatistics getStatistics() const;
+
+private:
+    using Parameters = AlgorithmParameters<DataType>;
+    using Clock = std::chrono::steady_clock;
+
+    struct Job {
+        Batch keys;
+        Callback onSorted;
+        std::promise<Batch> promise;
+        Clock::time_point submitted;
+    };
+
+    struct Slot {
+        RadixSortGPU<DataType> sorter;
+        HostData<DataType> hostBuffers;
+        cl::CommandQueue queue;
+        std::thread worker;
+    };
+
+    void WorkerLoop(Slot& slot);
+    void SortBatch(Slot& slot, Job& job);
+
+    std::vector<std::unique_ptr<Slot>> mSlots;
+    std::size_t mMaxBatchSize{0U};
+
+    /// Pending jobs, shared by all slots
+    std::deque<Job> mJobs;
+    std::size_t mNumOutstanding{0U};
+    bool mStopping{false};
+    mutable std::mutex mMutex;
+    std::condition_variable mJobAvailable;
+    std::condition_variable mJobDone;
+
+    /// Completion records for statistics
+    std::vector<double> mLatencies;
+    Clock::time_point mFirstCompletion;
+    Clock::time_point mLastCompletion;
+};
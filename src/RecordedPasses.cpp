@@ -0,0 +1,187 @@
+#include "RecordedPasses.h"
+
+#include <string>
+
+RecordedPasses::RecordedPasses(
+    cl::CommandQueue CommandQueue,
+    const Key& key,
+    std::vector<RecordedLaunch> launches
+)
+    : mKey(key)
+    , mLaunches(std::move(launches))
+{
+#if defined(cl_khr_command_buffer)
+    RecordCommandBuffer(CommandQueue);
+#else
+    static_cast<void>(CommandQueue);
+#endif
+}
+
+RecordedPasses::~RecordedPasses()
+{
+#if defined(cl_khr_command_buffer)
+    if (mCommandBuffer) {
+        mReleaseCommandBuffer(mCommandBuffer);
+    }
+#endif
+}
+
+const RecordedPasses::Key& RecordedPasses::key() const noexcept
+{
+    return mKey;
+}
+
+bool RecordedPasses::usesCommandBuffer() const noexcept
+{
+#if defined(cl_khr_command_buffer)
+    return mCommandBuffer != nullptr;
+#else
+    return false;
+#endif
+}
+
+cl_int RecordedPasses::enqueue(
+    cl::CommandQueue CommandQueue,
+    const std::vector<cl::Event>* eventWaitList,
+    cl::Event* event
+)
+{
+#if defined(cl_khr_command_buffer)
+    // A command buffer without simultaneous use may only be pending once,
+    // overlapping replays, e.g. chained asynchronous sorts, take the launch list
+    const auto idle = mLastEnqueue() == nullptr
+        || mLastEnqueue.getInfo<CL_EVENT_COMMAND_EXECUTION_STATUS>() == CL_COMPLETE;
+    if (mCommandBuffer && CommandQueue() == mCommandBufferQueue() && idle) {
+        std::vector<cl_event> waitEvents;
+        if (eventWaitList) {
+            for (const auto& waitEvent : *eventWaitList) {
+                waitEvents.push_back(waitEvent());
+            }
+        }
+        cl_command_queue queue = CommandQueue();
+        cl_event done{nullptr};
+        const auto err = mEnqueueCommandBuffer(
+            1U,
+            &queue,
+            mCommandBuffer,
+            static_cast<cl_uint>(waitEvents.size()),
+            waitEvents.empty() ? nullptr : waitEvents.data(),
+            &done
+        );
+        if (err == CL_SUCCESS) {
+            mLastEnqueue = cl::Event(done);
+            if (event) {
+                *event = mLastEnqueue;
+            }
+            return CL_SUCCESS;
+        }
+    }
+#endif
+    return EnqueueLaunches(CommandQueue, eventWaitList, event);
+}
+
+cl_int RecordedPasses::EnqueueLaunches(
+    cl::CommandQueue CommandQueue,
+    const std::vector<cl::Event>* eventWaitList,
+    cl::Event* event
+) const
+{
+    // An in-order queue orders the launches by itself, only an
+    // out-of-order queue needs an event per launch
+    const auto outOfOrder = (CommandQueue.getInfo<CL_QUEUE_PROPERTIES>() & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE) != 0U;
+
+    std::vector<cl::Event> waitList;
+    const std::vector<cl::Event>* wait = eventWaitList;
+    for (std::size_t i = 0U; i < mLaunches.size(); i++) {
+        const auto& launch = mLaunches[i];
+        const auto isLast = i + 1U == mLaunches.size();
+        cl::Event done;
+        const auto err = CommandQueue.enqueueNDRangeKernel(
+            launch.kernel,
+            launch.offset,
+            launch.global,
+            launch.local,
+            wait,
+            outOfOrder || (isLast && event) ? &done : nullptr
+        );
+        if (err != CL_SUCCESS) {
+            return err;
+        }
+        if (outOfOrder) {
+            waitList = {done};
+            wait = &waitList;
+        } else {
+            wait = nullptr;
+        }
+        if (isLast && event) {
+            *event = done;
+        }
+    }
+    return CL_SUCCESS;
+}
+
+#if defined(cl_khr_command_buffer)
+namespace {
+template <typename Function>
+Function LoadFunction(cl_platform_id platform, const char* name)
+{
+    return reinterpret_cast<Function>(clGetExtensionFunctionAddressForPlatform(platform, name));
+}
+} // namespace
+
+void RecordedPasses::RecordCommandBuffer(cl::CommandQueue CommandQueue)
+{
+    const auto device = CommandQueue.getInfo<CL_QUEUE_DEVICE>();
+    if (device.getInfo<CL_DEVICE_EXTENSIONS>().find("cl_khr_command_buffer") == std::string::npos) {
+        return;
+    }
+    const auto platform = cl::Platform(device.getInfo<CL_DEVICE_PLATFORM>())();
+    const auto createCommandBuffer = LoadFunction<clCreateCommandBufferKHR_fn>(platform, "clCreateCommandBufferKHR");
+    const auto commandNDRangeKernel = LoadFunction<clCommandNDRangeKernelKHR_fn>(platform, "clCommandNDRangeKernelKHR");
+    const auto finalizeCommandBuffer = LoadFunction<clFinalizeCommandBufferKHR_fn>(platform, "clFinalizeCommandBufferKHR");
+    mEnqueueCommandBuffer = LoadFunction<clEnqueueCommandBufferKHR_fn>(platform, "clEnqueueCommandBufferKHR");
+    mReleaseCommandBuffer = LoadFunction<clReleaseCommandBufferKHR_fn>(platform, "clReleaseCommandBufferKHR");
+    if (!createCommandBuffer || !commandNDRangeKernel || !finalizeCommandBuffer
+        || !mEnqueueCommandBuffer || !mReleaseCommandBuffer) {
+        return;
+    }
+
+    cl_command_queue queue = CommandQueue();
+    cl_int err{CL_SUCCESS};
+    auto commandBuffer = createCommandBuffer(1U, &queue, nullptr, &err);
+    if (err != CL_SUCCESS) {
+        return;
+    }
+
+    // Commands of a command buffer are unordered unless chained by sync points
+    cl_sync_point_khr previous{0U};
+    for (std::size_t i = 0U; i < mLaunches.size() && err == CL_SUCCESS; i++) {
+        const auto& launch = mLaunches[i];
+        cl_sync_point_khr syncPoint{0U};
+        err = commandNDRangeKernel(
+            commandBuffer,
+            nullptr,
+            nullptr,
+            launch.kernel(),
+            static_cast<cl_uint>(launch.global.dimensions()),
+            launch.offset.dimensions() ? launch.offset.get() : nullptr,
+            launch.global.get(),
+            launch.local.dimensions() ? launch.local.get() : nullptr,
+            i == 0U ? 0U : 1U,
+            i == 0U ? nullptr : &previous,
+            &syncPoint,
+            nullptr
+        );
+        previous = syncPoint;
+    }
+    if (err == CL_SUCCESS) {
+        err = finalizeCommandBuffer(commandBuffer);
+    }
+    if (err != CL_SUCCESS) {
+        mReleaseCommandBuffer(commandBuffer);
+        return;
+    }
+    mCommandBuffer = commandBuffer;
+    mCommandBufferQueue = CommandQueue;
+}
+#endif
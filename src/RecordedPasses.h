@@ -0,0 +1,96 @@
+#pragma once
+
+#define CL_HPP_MINIMUM_OPENCL_VERSION 120
+#define CL_HPP_TARGET_OPENCL_VERSION 120
+#include <CL/opencl.hpp>
+#include <CL/cl_ext.h>
+
+#include <cstddef>
+#include <vector>
+
+/// Kernel launch with all arguments bound to its own kernel object
+struct RecordedLaunch {
+    cl::Kernel kernel;
+    cl::NDRange offset;
+    cl::NDRange global;
+    cl::NDRange local;
+};
+
+/// Kernel sequence of all passes of a sort, recorded once per buffer
+/// configuration and replayed without setting arguments or looking up
+/// buffers. Uses a cl_khr_command_buffer if the device supports it,
+/// otherwise the launches are enqueued from the prerecorded list.
+class RecordedPasses
+{
+public:
+    /// Buffers and size a sequence was recorded for.
+    /// Holding the buffers keeps their handles from being reused while recorded.
+    struct Key {
+        std::size_t numKeysRounded{0U};
+        std::size_t numPasses{0U};
+        cl::Buffer inputKeys;
+        cl::Buffer outputKeys;
+        cl::Buffer inputPermutations;
+        cl::Buffer outputPermutations;
+        cl::Buffer keyRange;
+
+        bool operator==(const Key& other) const noexcept
+        {
+            return numKeysRounded == other.numKeysRounded
+                && numPasses == other.numPasses
+                && inputKeys() == other.inputKeys()
+                && outputKeys() == other.outputKeys()
+                && inputPermutations() == other.inputPermutations()
+                && outputPermutations() == other.outputPermutations()
+                && keyRange() == other.keyRange();
+        }
+    };
+
+    /// Takes the launches and records them into a command buffer
+    /// of the queue where supported
+    /// @param CommandQueue OpenCL Command Queue the command buffer is created for
+    RecordedPasses(cl::CommandQueue CommandQueue, const Key& key, std::vector<RecordedLaunch> launches);
+    ~RecordedPasses();
+
+    RecordedPasses(const RecordedPasses&) = delete;
+    RecordedPasses& operator=(const RecordedPasses&) = delete;
+
+    const Key& key() const noexcept;
+
+    /// Checks whether replays go through a command buffer
+    bool usesCommandBuffer() const noexcept;
+
+    /// Enqueues the whole sequence, each launch waits for its predecessor
+    /// @param CommandQueue OpenCL Command Queue, may be out-of-order
+    /// @param eventWaitList Events the first launch waits for
+    /// @param event Completes with the last launch
+    cl_int enqueue(
+        cl::CommandQueue CommandQueue,
+        const std::vector<cl::Event>* eventWaitList,
+        cl::Event* event
+    );
+
+private:
+    /// Enqueues the launches one by one
+    cl_int EnqueueLaunches(
+        cl::CommandQueue CommandQueue,
+        const std::vector<cl::Event>* eventWaitList,
+        cl::Event* event
+    ) const;
+
+    Key mKey;
+    std::vector<RecordedLaunch> mLaunches;
+
+#if defined(cl_khr_command_buffer)
+    /// Records the launches, leaves mCommandBuffer empty on failure
+    void RecordCommandBuffer(cl::CommandQueue CommandQueue);
+
+    cl_command_buffer_khr mCommandBuffer{nullptr};
+    /// Queue the command buffer was created for
+    cl::CommandQueue mCommandBufferQueue;
+    /// Completion of the last enqueue, the buffer is not enqueued twice at once
+    cl::Event mLastEnqueue;
+    clEnqueueCommandBufferKHR_fn mEnqueueCommandBuffer{nullptr};
+    clReleaseCommandBufferKHR_fn mReleaseCommandBuffer{nullptr};
+#endif
+};
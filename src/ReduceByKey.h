@@ -0,0 +1,110 @@
+#pragma once
+
+#include "CRadixSortCPU.h"
+#include "Partition.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/// Type of the sums of values, 64 bits of the signedness of the values.
+/// Sums of 64-bit values wrap around on overflow.
+template <typename V>
+using AggregateSum = std::conditional_t<std::is_signed_v<V>, int64_t, uint64_t>;
+
+/// Unique key with the count, sum, minimum and maximum of its values
+template <typename K, typename V>
+struct KeyAggregate {
+    K key{};
+    std::size_t count{0U};
+    AggregateSum<V> sum{0};
+    V min{};
+    V max{};
+
+    bool operator==(const KeyAggregate&) const = default;
+};
+
+/// Aggregates sorted keys and their values, one entry per run of equal keys
+/// @param keys Keys in ascending order
+/// @param values Values, as many as keys
+/// @param numThreads Number of threads, 0 selects the hardware concurrency
+template <typename K, typename V>
+std::vector<KeyAggregate<K, V>> reduceSortedByKey(
+    std::span<const K> keys,
+    std::span<const V> values,
+    std::size_t numThreads = 0U
+)
+{
+    const auto n = keys.size();
+    numThreads = partitionThreads(n, numThreads);
+
+    // chunks start at the first head at or after an even split,
+    // so that no run of equal keys crosses chunks
+    std::vector<std::size_t> bounds(numThreads + 1U, n);
+    bounds.front() = 0U;
+    for (std::size_t t = 1U; t < numThreads; t++) {
+        auto i = std::max(n * t / numThreads, bounds[t - 1U]);
+        while (i > 0U && i < n && keys[i] == keys[i - 1U]) {
+            i++;
+        }
+        bounds[t] = i;
+    }
+
+    std::vector<std::vector<KeyAggregate<K, V>>> parts(numThreads);
+    const auto reduceChunk = [&](std::size_t t) {
+        auto& part = parts[t];
+        for (auto i = bounds[t]; i < bounds[t + 1U]; i++) {
+            const auto value = values[i];
+            if (part.empty() || part.back().key != keys[i]) {
+                part.push_back({keys[i], 0U, 0, value, value});
+            }
+            auto& aggregate = part.back();
+            aggregate.count++;
+            // sums wrap around like the 64-bit sums of the device
+            aggregate.sum = static_cast<AggregateSum<V>>(
+                static_cast<uint64_t>(aggregate.sum) + static_cast<uint64_t>(static_cast<AggregateSum<V>>(value)));
+            aggregate.min = std::min(aggregate.min, value);
+            aggregate.max = std::max(aggregate.max, value);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (std::size_t t = 1U; t < numThreads; t++) {
+        threads.emplace_back(reduceChunk, t);
+    }
+    reduceChunk(0U);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::vector<KeyAggregate<K, V>> aggregates;
+    for (const auto& part : parts) {
+        aggregates.insert(aggregates.end(), part.begin(), part.end());
+    }
+    return aggregates;
+}
+
+/// Sorts pairs of keys and values by key and aggregates the values
+/// of every key: count, sum, minimum and maximum. The pairs are radix
+/// sorted in copies, the inputs are left unchanged.
+/// @param keys Keys
+/// @param values Values, as many as keys
+/// @param numThreads Number of threads, 0 selects the hardware concurrency
+/// @return One entry per distinct key in ascending order of keys
+template <typename K, typename V>
+std::vector<KeyAggregate<K, V>> reduceByKey(
+    std::span<const K> keys,
+    std::span<const V> values,
+    std::size_t numThreads = 0U
+)
+{
+    std::vector<K> sortedKeys(keys.begin(), keys.end());
+    std::vector<V> sortedValues(values.begin(), values.begin() + keys.size());
+    std::span<K> keySpan(sortedKeys);
+    std::span<V> valueSpan(sortedValues);
+    RadixSortCPU<K>::sortPairsParallel(keySpan, valueSpan, numThreads);
+    return reduceSortedByKey(std::span<const K>(sortedKeys), std::span<const V>(sortedValues), numThreads);
+}
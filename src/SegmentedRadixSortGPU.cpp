@@ -0,0 +1,165 @@
+#include "SegmentedRadixSortGPU.h"
+
+#include <CL/Utils/Error.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <iostream>
+#include <vector>
+
+template <typename DataType>
+OperationStatus SegmentedRadixSortGPU<DataType>::initialize(
+    cl::Device Device,
+    cl::Context Context,
+    uint32_t maxSegmentSize
+)
+{
+    mDevice = Device;
+    mContext = Context;
+    mMaxSegmentSize = static_cast<uint32_t>(mSorter.Resize(std::max(maxSegmentSize, 1U)));
+
+    // keys are exchanged through device buffers only, no host spans needed
+    return mSorter.initialize(Device, Context, mMaxSegmentSize, HostSpans<DataType>{});
+}
+
+template <typename DataType>
+OperationStatus SegmentedRadixSortGPU<DataType>::sort(
+    cl::CommandQueue CommandQueue,
+    std::span<DataType> keys,
+    std::span<const uint32_t> segmentOffsets
+)
+{
+    using S = OperationStatus;
+    if (segmentOffsets.size() < 2U || keys.empty()) {
+        return S::OK;
+    }
+    if (segmentOffsets.back() != keys.size()
+        || !std::is_sorted(segmentOffsets.begin(), segmentOffsets.end()))
+    {
+        std::cerr << "Segment offsets must be non-decreasing and end at the number of keys\n";
+        return S::CALCULATION_FAILED;
+    }
+
+    const auto numSegments = segmentOffsets.size() - 1U;
+    const auto capacity = mSorter.localSortCapacity();
+
+    // bucket segments by power of two size class, remember large ones
+    const auto numClasses = static_cast<size_t>(std::bit_width(capacity));
+    std::vector<std::vector<uint32_t>> classes(numClasses + 1U);
+    std::vector<uint32_t> largeSegments;
+    uint32_t largestSegment = 0U;
+    for (uint32_t segment = 0U; segment < numSegments; segment++) {
+        const auto size = segmentOffsets[segment + 1U] - segmentOffsets[segment];
+        if (size <= 1U) {
+            continue;
+        }
+        if (size > capacity) {
+            largeSegments.push_back(segment);
+            largestSegment = std::max(largestSegment, size);
+            continue;
+        }
+        classes[std::bit_width(std::bit_ceil(size)) - 1U].push_back(segment);
+    }
+
+    // grow the fallback sorter before any of its kernels are enqueued
+    if (largestSegment > mMaxSegmentSize) {
+        mSorter.release();
+        const auto status = initialize(mDevice, mContext, largestSegment);
+        if (status != S::OK) {
+            return status;
+        }
+    }
+
+    // segment ids ordered by class, so that each launch reads a contiguous range
+    std::vector<uint32_t> segmentIds;
+    segmentIds.reserve(numSegments);
+    for (const auto& ids : classes) {
+        segmentIds.insert(segmentIds.end(), ids.begin(), ids.end());
+    }
+
+    cl_int clError{CL_SUCCESS};
+    cl::Buffer keysBuffer(mContext, CL_MEM_READ_WRITE, sizeof(DataType) * keys.size(), nullptr, &clError);
+    if (clError) {
+        std::cerr<<cl::util::Error(clError, "Failed to create segmented key buffer").what()<<"\n";
+        return S::HOST_BUFFERS_FAILED;
+    }
+    cl::Buffer offsetsBuffer(
+        mContext,
+        CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+        sizeof(uint32_t) * segmentOffsets.size(),
+        const_cast<uint32_t*>(segmentOffsets.data()),
+        &clError);
+    if (clError) {
+        std::cerr<<cl::util::Error(clError, "Failed to create segment offset buffer").what()<<"\n";
+        return S::HOST_BUFFERS_FAILED;
+    }
+    cl::Buffer idsBuffer;
+    if (!segmentIds.empty()) {
+        idsBuffer = cl::Buffer(
+            mContext,
+            CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+            sizeof(uint32_t) * segmentIds.size(),
+            segmentIds.data(),
+            &clError);
+        if (clError) {
+            std::cerr<<cl::util::Error(clError, "Failed to create segment id buffer").what()<<"\n";
+            return S::HOST_BUFFERS_FAILED;
+        }
+    }
+
+    const auto blocking = CL_FALSE;
+    CommandQueue.enqueueWriteBuffer(keysBuffer, blocking, 0, sizeof(DataType) * keys.size(), keys.data());
+
+    // one launch per size class, in-order queue serializes them after the upload
+    uint32_t firstSegment = 0U;
+    for (size_t sizeClass = 0U; sizeClass < classes.size(); sizeClass++) {
+        const auto count = classes[sizeClass].size();
+        if (count == 0U) {
+            continue;
+        }
+        const auto sortSize = 1U << sizeClass;
+        clError = mSorter.EnqueueLocalSort(
+            CommandQueue,
+            keysBuffer,
+            offsetsBuffer,
+            idsBuffer,
+            firstSegment,
+            count,
+            sortSize,
+            nullptr,
+            nullptr);
+        if (clError) {
+            std::cerr<<cl::util::Error(clError, "Failed to enqueue local sort").what()<<"\n";
+            return S::CALCULATION_FAILED;
+        }
+        firstSegment += static_cast<uint32_t>(count);
+    }
+
+    // segments beyond local memory go through the global passes one by one
+    for (const auto segment : largeSegments) {
+        const auto start = segmentOffsets[segment];
+        const auto status = mSorter.sortBuffer(
+            CommandQueue,
+            keysBuffer,
+            start,
+            segmentOffsets[segment + 1U] - start);
+        if (status != S::OK) {
+            return status;
+        }
+    }
+
+    CommandQueue.enqueueReadBuffer(keysBuffer, CL_TRUE, 0, sizeof(DataType) * keys.size(), keys.data());
+    return S::OK;
+}
+
+template <typename DataType>
+OperationStatus SegmentedRadixSortGPU<DataType>::release()
+{
+    return mSorter.release();
+}
+
+// Specialize SegmentedRadixSortGPU for the supported types.
+template class SegmentedRadixSortGPU < int32_t >;
+template class SegmentedRadixSortGPU < int64_t >;
+template class SegmentedRadixSortGPU < uint32_t >;
+template class SegmentedRadixSortGPU < uint64_t >;
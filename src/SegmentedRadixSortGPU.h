@@ -0,0 +1,52 @@
+#pragma once
+
+#define CL_HPP_MINIMUM_OPENCL_VERSION 120
+#define CL_HPP_TARGET_OPENCL_VERSION 120
+#include <CL/opencl.hpp>
+
+#include "RadixSortGPU.h"
+#include "OperationStatus.h"
+
+#include <cstdint>
+#include <span>
+
+/// Sorts many independent segments of one key array in a single call.
+/// Segments fitting into local memory are sorted by one work-group each,
+/// batched into one launch per power of two size class. Larger segments
+/// fall back to the global radix sort passes.
+/// @tparam DataType Type of data to be sorted
+template <typename DataType>
+class SegmentedRadixSortGPU
+{
+public:
+    /// Creates program, kernels and the fallback sorter
+    /// @param Device OpenCL device
+    /// @param Context OpenCL context
+    /// @param maxSegmentSize Expected size of the largest segment,
+    ///        larger segments grow the fallback sorter on demand
+    OperationStatus initialize(
+        cl::Device Device,
+        cl::Context Context,
+        uint32_t maxSegmentSize = 1U << 16U
+    );
+
+    /// Sorts each segment [segmentOffsets[i], segmentOffsets[i+1]) in place
+    /// @param CommandQueue OpenCL Command Queue
+    /// @param keys Keys of all segments
+    /// @param segmentOffsets Non-decreasing segment starts, with keys.size() appended
+    OperationStatus sort(
+        cl::CommandQueue CommandQueue,
+        std::span<DataType> keys,
+        std::span<const uint32_t> segmentOffsets
+    );
+
+    /// Frees device buffers
+    OperationStatus release();
+
+private:
+    /// Sorter providing the kernels and the fallback for large segments
+    RadixSortGPU<DataType> mSorter;
+    cl::Device mDevice;
+    cl::Context mContext;
+    uint32_t mMaxSegmentSize{0U};
+};
@@ -0,0 +1,82 @@
+#include "SortHandle.h"
+
+#include <memory>
+
+namespace {
+
+void CL_CALLBACK InvokeCallback(cl_event, cl_int status, void* userData)
+{
+    std::unique_ptr<SortHandle::Callback> callback(static_cast<SortHandle::Callback*>(userData));
+    (*callback)(status);
+}
+
+} // namespace
+
+SortHandle::SortHandle(cl::Event event)
+    : mEvent(std::move(event))
+{}
+
+SortHandle::SortHandle(cl::Event event, cl_int error)
+    : mEvent(std::move(event))
+    , mError(error)
+{}
+
+cl_int SortHandle::status() const
+{
+    if (mError != CL_SUCCESS) {
+        return mError;
+    }
+    if (mEvent() == nullptr) {
+        return CL_COMPLETE;
+    }
+    return mEvent.getInfo<CL_EVENT_COMMAND_EXECUTION_STATUS>();
+}
+
+void SortHandle::wait() const
+{
+    if (mEvent() != nullptr) {
+        mEvent.wait();
+    }
+}
+
+bool SortHandle::ready() const
+{
+    // CL_COMPLETE is zero, errors are negative
+    return status() <= CL_COMPLETE;
+}
+
+void SortHandle::then(Callback callback) const
+{
+    if (mError != CL_SUCCESS) {
+        callback(mError);
+        return;
+    }
+    if (mEvent() == nullptr) {
+        callback(CL_COMPLETE);
+        return;
+    }
+    auto userData = std::make_unique<Callback>(std::move(callback));
+    // The event is a reference counted handle, registering on a copy is sufficient
+    cl::Event event {mEvent};
+    event.setCallback(CL_COMPLETE, InvokeCallback, userData.get());
+    userData.release();
+}
+
+std::future<void> SortHandle::toFuture() const
+{
+    auto promise = std::make_shared<std::promise<void>>();
+    auto future = promise->get_future();
+    then([promise](cl_int status) {
+        if (status < 0) {
+            promise->set_exception(std::make_exception_ptr(cl::Error(status, "Asynchronous sort failed")));
+        } else {
+            promise->set_value();
+        }
+    });
+    return future;
+}
+
+const cl::Event& SortHandle::event() const noexcept
+{
+    return mEvent;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#define CL_HPP_MINIMUM_OPENCL_VERSION 120
+#define CL_HPP_TARGET_OPENCL_VERSION 120
+#include <CL/opencl.hpp>
+
+#include <functional>
+#include <future>
+
+/// Completion handle of an asynchronously enqueued sort.
+/// Wraps the event of the last command of the sort, or the error
+/// of a sort that could not be enqueued completely.
+class SortHandle
+{
+public:
+    /// Callback receiving the OpenCL execution status, negative on failure
+    using Callback = std::function<void(cl_int)>;
+
+    SortHandle() = default;
+    explicit SortHandle(cl::Event event);
+    /// Handle of a sort that failed to enqueue, it never completes
+    /// @param event Event of the last command enqueued before the failure, may be empty
+    /// @param error Negative OpenCL error code
+    SortHandle(cl::Event event, cl_int error);
+
+    /// Returns the error the sort failed to enqueue with, or otherwise the
+    /// execution status of its last command: CL_COMPLETE once completed,
+    /// positive while pending, negative if the device reported an error
+    cl_int status() const;
+
+    /// Blocks until the sort has completed, or the commands
+    /// enqueued before a failure have
+    void wait() const;
+
+    /// Polls completion without blocking
+    /// @return true if the sort has completed or failed
+    bool ready() const;
+
+    /// Registers a callback invoked once the sort has completed,
+    /// immediately with the error if it failed to enqueue
+    /// @note Runs on a thread of the OpenCL runtime and must not call
+    ///       blocking OpenCL functions
+    void then(Callback callback) const;
+
+    /// Returns a future becoming ready once the sort has completed.
+    /// Fails with cl::Error if the sort failed to enqueue or the device reports an error.
+    std::future<void> toFuture() const;
+
+    /// Event of the last command, for wait lists of dependent commands
+    const cl::Event& event() const noexcept;
+
+private:
+    cl::Event mEvent;
+    /// Error of a failed enqueue, CL_SUCCESS otherwise
+    cl_int mError{CL_SUCCESS};
+};
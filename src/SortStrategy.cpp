@@ -0,0 +1,399 @@
+#include "SortStrategy.h"
+#include "CRadixSortCPU.h"
+#include "CountingSort.h"
+#include "Partition.h"
+
+#include "Common/CTimer.h"
+#include <CL/Utils/Error.hpp>
+
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <random>
+
+const char* toString(SortAlgorithm algorithm) noexcept
+{
+    switch (algorithm) {
+        case SortAlgorithm::COMPARISON:     return "comparison";
+        case SortAlgorithm::HOST_PRESORTED: return "host-presorted";
+        case SortAlgorithm::HOST_LSD:       return "host-lsd";
+        case SortAlgorithm::HOST_MSD:       return "host-msd";
+        case SortAlgorithm::HOST_COUNTING:  return "host-counting";
+        case SortAlgorithm::DEVICE:         return "device";
+    }
+    return "unknown";
+}
+
+template <typename DataType>
+OperationStatus SortStrategy<DataType>::initialize(cl::Device Device, cl::Context Context)
+{
+    mDevice = Device;
+    mContext = Context;
+
+    // the largest buffer the device can allocate bounds the device algorithm
+    const auto maxAlloc = Device.getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>();
+    mMaxDeviceKeys = maxAlloc / sizeof(DataType) / Parameters::_NUM_ITEMS * Parameters::_NUM_ITEMS;
+
+    // The device sorter starts small and grows with the largest input
+    mCapacity = 0U;
+    const auto status = SortOnDevice(cl::CommandQueue(Context, Device), {});
+    mDeviceReady = status == OperationStatus::OK;
+    return status;
+}
+
+template <typename DataType>
+SampleStatistics SortStrategy<DataType>::analyze(
+    std::span<const DataType> keys,
+    std::size_t numPartitions
+)
+{
+    using U = std::make_unsigned_t<DataType>;
+    constexpr auto BITS = Parameters::_NUM_BITS_PER_RADIX;
+    const auto passesOf = [](U range) {
+        return static_cast<double>((std::bit_width(range) + BITS - 1U) / BITS);
+    };
+
+    SampleStatistics statistics;
+    statistics.numKeys = keys.size();
+    auto sample = sampleKeys(keys, Parameters::_NUM_STRATEGY_SAMPLES);
+    const auto sampleSize = sample.size();
+    statistics.sampleSize = sampleSize;
+    if (sampleSize == 0U) {
+        statistics.sortedness = 1.0;
+        return statistics;
+    }
+
+    // order of neighbouring samples, before they get sorted
+    std::size_t ascending = 0U;
+    for (std::size_t i = 1U; i < sampleSize; i++) {
+        ascending += static_cast<std::size_t>(sample[i - 1U] <= sample[i]);
+    }
+    statistics.sortedness = sampleSize > 1U
+        ? static_cast<double>(ascending) / static_cast<double>(sampleSize - 1U)
+        : 1.0;
+
+    std::ranges::sort(sample);
+    const auto range = static_cast<U>(orderedKey(sample.back()) - orderedKey(sample.front()));
+    statistics.range = range;
+    statistics.lsdPasses = passesOf(range);
+
+    // plug-in entropy of the frequencies of the distinct samples
+    for (std::size_t begin = 0U; begin < sampleSize;) {
+        auto end = begin + 1U;
+        while (end < sampleSize && sample[end] == sample[begin]) {
+            end++;
+        }
+        const auto p = static_cast<double>(end - begin) / static_cast<double>(sampleSize);
+        statistics.entropy -= p * std::log2(p);
+        statistics.distinct++;
+        begin = end;
+    }
+
+    // The sorted sample falls into contiguous partitions of the bounds the
+    // MSD sort would derive, each partition only sorts its own varying bits
+    const std::vector<double> weights(std::max<std::size_t>(numPartitions, 1U), 1.0);
+    const auto bounds = partitionBounds(std::span<const DataType>(sample), weights, PartitionScheme::TOP_BITS, 1U);
+    for (std::size_t begin = 0U; begin < sampleSize;) {
+        const auto bound = std::ranges::upper_bound(bounds, orderedKey(sample[begin]));
+        auto end = begin + 1U;
+        while (end < sampleSize && (bound == bounds.end() || orderedKey(sample[end]) < *bound)) {
+            end++;
+        }
+        const auto partRange = static_cast<U>(orderedKey(sample[end - 1U]) - orderedKey(sample[begin]));
+        statistics.msdPasses += passesOf(partRange) * static_cast<double>(end - begin);
+        begin = end;
+    }
+    statistics.msdPasses /= static_cast<double>(sampleSize);
+
+    statistics.countable = range < Parameters::_MAX_COUNTING_RANGE
+        || (statistics.distinct <= Parameters::_MAX_COUNTING_DICTIONARY
+            && 4U * statistics.distinct <= sampleSize);
+    return statistics;
+}
+
+template <typename DataType>
+StrategyDecision SortStrategy<DataType>::decide(std::span<const DataType> keys) const
+{
+    constexpr double nsPerMs = 1e6;
+    StrategyDecision decision;
+    decision.statistics = analyze(keys, mNumPartitions);
+    const auto& statistics = decision.statistics;
+    const auto& c = mCosts;
+    const auto n = static_cast<double>(statistics.numKeys);
+
+    auto& candidates = decision.candidates;
+    const auto add = [&](SortAlgorithm algorithm, double time) {
+        candidates.push_back({algorithm, time / nsPerMs});
+    };
+    add(SortAlgorithm::COMPARISON, c.compare * n * std::log2(std::max(n, 2.0)));
+    // a single descent in the sample rules out both fast paths, reversing reads the keys twice
+    if (statistics.sortedness == 1.0 || statistics.sortedness == 0.0) {
+        add(SortAlgorithm::HOST_PRESORTED, c.hostScan * n * (statistics.sortedness == 1.0 ? 1.0 : 2.0));
+    }
+    // one more pass each for the minimum and maximum
+    add(SortAlgorithm::HOST_LSD, c.hostThreads + c.hostPass * n * (1.0 + statistics.lsdPasses));
+    add(SortAlgorithm::HOST_MSD,
+        c.hostThreads + c.hostPartition * n + c.hostPass * n * (1.0 + statistics.msdPasses));
+    if (statistics.countable) {
+        add(SortAlgorithm::HOST_COUNTING, c.hostThreads + c.hostCount * n);
+    }
+    if (mDeviceReady && statistics.numKeys <= mMaxDeviceKeys) {
+        // the device counts countable keys in a single pass, and always
+        // checks the order and the key range beforehand
+        const auto passes = statistics.countable ? 1.0 : statistics.lsdPasses;
+        add(SortAlgorithm::DEVICE, c.deviceLaunch + c.devicePassLaunch * passes
+            + c.deviceTransfer * 2.0 * n * static_cast<double>(sizeof(DataType))
+            + c.devicePass * n * (2.0 + passes));
+    }
+
+    // ties keep the order above, which prefers the simpler algorithm
+    std::ranges::stable_sort(candidates, {}, &StrategyCandidate::predictedTime);
+    decision.algorithm = candidates.front().algorithm;
+    decision.predictedTime = candidates.front().predictedTime;
+    return decision;
+}
+
+template <typename DataType>
+OperationStatus SortStrategy<DataType>::sort(
+    cl::CommandQueue CommandQueue,
+    std::span<DataType> keys
+)
+{
+    auto decision = decide(keys);
+
+    CTimer timer;
+    timer.Start();
+    const auto status = run(CommandQueue, decision.algorithm, keys);
+    timer.Stop();
+    decision.measuredTime = timer.GetElapsedMilliseconds();
+
+    if (mOutStream) {
+        const auto& statistics = decision.statistics;
+        *mOutStream << "Sorted " << statistics.numKeys << " keys (entropy " << statistics.entropy
+                    << " bits, range " << statistics.range << ", sortedness " << statistics.sortedness
+                    << ") with " << toString(decision.algorithm) << " in " << decision.measuredTime
+                    << " ms, predicted " << decision.predictedTime << " ms" << std::endl;
+    }
+    mDecisions.push_back(std::move(decision));
+    return status;
+}
+
+template <typename DataType>
+OperationStatus SortStrategy<DataType>::run(
+    cl::CommandQueue CommandQueue,
+    SortAlgorithm algorithm,
+    std::span<DataType> keys
+)
+{
+    switch (algorithm) {
+        case SortAlgorithm::COMPARISON:
+            std::ranges::sort(keys);
+            break;
+        case SortAlgorithm::HOST_PRESORTED:
+            // falls back to a radix sort if the sample missed a descent
+            RadixSortCPU<DataType>::sortAdaptive(keys, mNumThreads);
+            break;
+        case SortAlgorithm::HOST_LSD:
+            RadixSortCPU<DataType>::sortParallel(keys, mNumThreads);
+            break;
+        case SortAlgorithm::HOST_MSD:
+            SortMSD(keys);
+            break;
+        case SortAlgorithm::HOST_COUNTING:
+            if (!countingSort(keys, mNumThreads)) {
+                RadixSortCPU<DataType>::sortParallel(keys, mNumThreads);
+            }
+            break;
+        case SortAlgorithm::DEVICE:
+            if (!mDeviceReady) {
+                return OperationStatus::INITIALIZATION_FAILED;
+            }
+            return SortOnDevice(CommandQueue, keys);
+    }
+    return OperationStatus::OK;
+}
+
+template <typename DataType>
+void SortStrategy<DataType>::SortMSD(std::span<DataType> keys) const
+{
+    using U = std::make_unsigned_t<DataType>;
+    const std::span<const DataType> input = keys;
+    const std::vector<double> weights(mNumPartitions, 1.0);
+    const auto bounds = partitionBounds(input, weights, PartitionScheme::TOP_BITS, mNumThreads);
+    std::vector<DataType> partitioned(keys.size());
+    const auto offsets = partitionKeys(input, std::span<DataType>(partitioned), std::span<const U>(bounds), mNumThreads);
+
+    // Skewed keys give partitions of different sizes, threads take the
+    // next unsorted partition until none is left
+    const auto numParts = offsets.size() - 1U;
+    std::atomic<std::size_t> nextPart{0U};
+    const auto sortParts = [&]() {
+        for (auto part = nextPart++; part < numParts; part = nextPart++) {
+            std::span<DataType> partition(partitioned.data() + offsets[part], offsets[part + 1U] - offsets[part]);
+            RadixSortCPU<DataType>::sortParallel(partition, 1U);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (std::size_t t = 1U; t < partitionThreads(keys.size(), mNumThreads); t++) {
+        threads.emplace_back(sortParts);
+    }
+    sortParts();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    std::ranges::copy(partitioned, keys.begin());
+}
+
+template <typename DataType>
+OperationStatus SortStrategy<DataType>::calibrate(cl::CommandQueue CommandQueue)
+{
+    constexpr std::size_t size = 1U << 20U;
+    constexpr auto iterations = 3U;
+    constexpr double nsPerMs = 1e6;
+    constexpr auto minCost = 1e-3;
+    const auto n = static_cast<double>(size);
+
+    // random keys for the radix passes, narrow ones for counting
+    // and sorted ones for the order check
+    std::mt19937_64 generator(size);
+    std::vector<DataType> random(size);
+    std::ranges::generate(random, [&]() { return static_cast<DataType>(generator()); });
+    std::vector<DataType> narrow(size);
+    std::ranges::generate(narrow, [&]() { return static_cast<DataType>(generator() % 1000U); });
+    std::vector<DataType> sorted = random;
+    std::ranges::sort(sorted);
+    std::vector<DataType> keys(size);
+
+    auto status = OperationStatus::OK;
+    const auto measure = [&](const std::vector<DataType>& reference, SortAlgorithm algorithm) {
+        double best = std::numeric_limits<double>::max();
+        for (auto i = 0U; i < iterations && status == OperationStatus::OK; i++) {
+            keys = reference;
+            CTimer timer;
+            timer.Start();
+            status = run(CommandQueue, algorithm, keys);
+            timer.Stop();
+            best = std::min(best, timer.GetElapsedMilliseconds());
+        }
+        return best * nsPerMs;
+    };
+    const auto randomStatistics = analyze(random, mNumPartitions);
+
+    // Each coefficient is solved from one measurement,
+    // given the coefficients measured before it
+    StrategyCosts costs = mCosts;
+    costs.compare = std::max(minCost, measure(random, SortAlgorithm::COMPARISON) / (n * std::log2(n)));
+    costs.hostScan = std::max(minCost, measure(sorted, SortAlgorithm::HOST_PRESORTED) / n);
+    costs.hostPass = std::max(minCost, (measure(random, SortAlgorithm::HOST_LSD) - costs.hostThreads)
+        / (n * (1.0 + randomStatistics.lsdPasses)));
+    costs.hostPartition = std::max(minCost, (measure(random, SortAlgorithm::HOST_MSD) - costs.hostThreads
+        - costs.hostPass * n * (1.0 + randomStatistics.msdPasses)) / n);
+    costs.hostCount = std::max(minCost, (measure(narrow, SortAlgorithm::HOST_COUNTING) - costs.hostThreads) / n);
+
+    if (mDeviceReady) {
+        // transfers are timed on their own, the rest is attributed to the passes
+        const auto sizeBytes = sizeof(DataType) * size;
+        const auto device = measure(random, SortAlgorithm::DEVICE);
+        if (status != OperationStatus::OK) {
+            return status;
+        }
+        CTimer timer;
+        timer.Start();
+        CommandQueue.enqueueWriteBuffer(mKeys, CL_TRUE, 0, sizeBytes, keys.data());
+        CommandQueue.enqueueReadBuffer(mKeys, CL_TRUE, 0, sizeBytes, keys.data());
+        timer.Stop();
+        costs.deviceTransfer = std::max(minCost,
+            timer.GetElapsedMilliseconds() * nsPerMs / (2.0 * static_cast<double>(sizeBytes)));
+        const auto passes = randomStatistics.lsdPasses;
+        costs.devicePass = std::max(minCost, (device - costs.deviceLaunch - costs.devicePassLaunch * passes
+            - costs.deviceTransfer * 2.0 * static_cast<double>(sizeBytes)) / (n * (2.0 + passes)));
+    }
+    if (status != OperationStatus::OK) {
+        return status;
+    }
+    mCosts = costs;
+    return OperationStatus::OK;
+}
+
+template <typename DataType>
+OperationStatus SortStrategy<DataType>::SortOnDevice(
+    cl::CommandQueue CommandQueue,
+    std::span<DataType> keys
+)
+{
+    using S = OperationStatus;
+    const auto numKeys = keys.size();
+    if (numKeys > mMaxDeviceKeys) {
+        return S::RESIZE_FAILED;
+    }
+
+    // grow in powers of two to limit the number of program rebuilds
+    const auto required = mSorter.Resize(std::max<size_t>(numKeys, Parameters::_NUM_ITEMS));
+    if (required > mCapacity) {
+        const auto capacity = std::min(std::bit_ceil(required), mMaxDeviceKeys);
+        mSorter.release();
+        auto status = mSorter.initialize(mDevice, mContext, capacity, HostSpans<DataType>{});
+        if (status != S::OK) {
+            return status;
+        }
+        cl_int clError{CL_SUCCESS};
+        mKeys = cl::Buffer(mContext, CL_MEM_READ_WRITE, sizeof(DataType) * capacity, nullptr, &clError);
+        if (clError) {
+            std::cerr<<cl::util::Error(clError, "Failed to create strategy key buffer").what()<<"\n";
+            return S::HOST_BUFFERS_FAILED;
+        }
+        mCapacity = capacity;
+    }
+    if (keys.empty()) {
+        return S::OK;
+    }
+
+    const auto sizeBytes = sizeof(DataType) * keys.size();
+    CommandQueue.enqueueWriteBuffer(mKeys, CL_FALSE, 0, sizeBytes, keys.data());
+    const auto status = mSorter.sortBuffer(CommandQueue, mKeys, 0U, numKeys);
+    if (status != S::OK) {
+        return status;
+    }
+    const auto err = CommandQueue.enqueueReadBuffer(mKeys, CL_TRUE, 0, sizeBytes, keys.data());
+    return err == CL_SUCCESS ? S::OK : S::DATA_DOWNLOAD_FAILED;
+}
+
+template <typename DataType>
+void SortStrategy<DataType>::setCosts(const StrategyCosts& costs) noexcept
+{
+    mCosts = costs;
+}
+
+template <typename DataType>
+const StrategyCosts& SortStrategy<DataType>::costs() const noexcept
+{
+    return mCosts;
+}
+
+template <typename DataType>
+const std::vector<StrategyDecision>& SortStrategy<DataType>::decisions() const noexcept
+{
+    return mDecisions;
+}
+
+template <typename DataType>
+void SortStrategy<DataType>::setLogStream(std::ostream* out) noexcept
+{
+    mOutStream = out;
+}
+
+template <typename DataType>
+OperationStatus SortStrategy<DataType>::release()
+{
+    mKeys = cl::Buffer();
+    mCapacity = 0U;
+    mDeviceReady = false;
+    return mSorter.release();
+}
+
+// Specialize SortStrategy for the supported types.
+template class SortStrategy < int32_t >;
+template class SortStrategy < int64_t >;
+template class SortStrategy < uint32_t >;
+template class SortStrategy < uint64_t >;
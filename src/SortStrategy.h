@@ -0,0 +1,179 @@
+#pragma once
+
+#define CL_HPP_MINIMUM_OPENCL_VERSION 120
+#define CL_HPP_TARGET_OPENCL_VERSION 120
+#include <CL/opencl.hpp>
+
+#include "RadixSortGPU.h"
+#include "OperationStatus.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <span>
+#include <thread>
+#include <vector>
+
+/// Algorithms the strategy layer chooses from
+enum class SortAlgorithm {
+    /// std::sort on the calling thread
+    COMPARISON,
+    /// RadixSortCPU::sortAdaptive(), for input that is sorted or reversed
+    HOST_PRESORTED,
+    /// RadixSortCPU::sortParallel(), least significant digit first
+    HOST_LSD,
+    /// Partitions by the most significant bits, then sorts the partitions
+    /// on their own threads over the bits that vary within them
+    HOST_MSD,
+    /// countingSort() on all hardware threads
+    HOST_COUNTING,
+    /// RadixSortGPU, including transfers
+    DEVICE,
+};
+
+/// Returns printable name of an algorithm
+const char* toString(SortAlgorithm algorithm) noexcept;
+
+/// Properties of the keys estimated from a regular sample
+struct SampleStatistics {
+    std::size_t numKeys{0U};
+    std::size_t sampleSize{0U};
+    /// Number of distinct sampled keys
+    std::size_t distinct{0U};
+    /// Shannon entropy of the sampled keys in bits, at most log2(sampleSize)
+    double entropy{0.0};
+    /// Difference of largest and smallest sampled key
+    uint64_t range{0U};
+    /// Fraction of neighbouring samples in ascending order,
+    /// 1 for sorted and 0 for strictly descending keys
+    double sortedness{0.0};
+    /// Number of digits of the sampled range, run by the LSD sort
+    double lsdPasses{0.0};
+    /// Number of digits varying within the partitions of the MSD sort,
+    /// averaged over the sampled keys
+    double msdPasses{0.0};
+    /// Set if the keys likely fit the counting sort
+    bool countable{false};
+};
+
+/// Cost coefficients of the algorithms in ns, per key unless noted
+struct StrategyCosts {
+    /// Comparison sort, per key and log2 of the number of keys
+    double compare{1.0};
+    /// Host check of the order of neighbouring keys
+    double hostScan{0.3};
+    /// Host radix pass, also the minimum and maximum pass
+    double hostPass{1.0};
+    /// Host partitioning by the most significant bits
+    double hostPartition{2.0};
+    /// Host counting sort
+    double hostCount{1.5};
+    /// Starting and joining the host threads, per call
+    double hostThreads{50000.0};
+    /// Transfer to and from the device, per byte
+    double deviceTransfer{0.1};
+    /// Device pass
+    double devicePass{0.1};
+    /// Device launches, per call and per pass
+    double deviceLaunch{100000.0};
+    double devicePassLaunch{20000.0};
+};
+
+/// Predicted time of an applicable algorithm
+struct StrategyCandidate {
+    SortAlgorithm algorithm{SortAlgorithm::COMPARISON};
+    /// Predicted time in ms
+    double predictedTime{0.0};
+};
+
+/// Audit record of a strategy decision
+struct StrategyDecision {
+    SampleStatistics statistics;
+    SortAlgorithm algorithm{SortAlgorithm::COMPARISON};
+    /// Predicted time of the selected algorithm in ms
+    double predictedTime{0.0};
+    /// All applicable algorithms, fastest first
+    std::vector<StrategyCandidate> candidates;
+    /// Wall clock time of the sort in ms, 0 until it ran
+    double measuredTime{0.0};
+};
+
+/// Samples keys to estimate their entropy, value range and sortedness,
+/// predicts the time of every applicable host and device algorithm from
+/// per-key costs and dispatches to the fastest.
+/// @tparam DataType Type of data to be sorted
+template <typename DataType>
+class SortStrategy
+{
+public:
+    /// Enables the device algorithm. Without it only host algorithms are selected.
+    /// @param Device OpenCL device
+    /// @param Context OpenCL context
+    OperationStatus initialize(cl::Device Device, cl::Context Context);
+
+    /// Estimates properties of keys from a regular sample
+    /// @param keys Keys to be sorted
+    /// @param numPartitions Number of partitions of the MSD sort
+    static SampleStatistics analyze(std::span<const DataType> keys, std::size_t numPartitions);
+
+    /// Predicts the time of every applicable algorithm and selects the fastest
+    /// @param keys Keys to be sorted
+    StrategyDecision decide(std::span<const DataType> keys) const;
+
+    /// Sorts keys in place with the algorithm decide() selects,
+    /// the decision is recorded with its measured time
+    /// @param CommandQueue OpenCL Command Queue used by the device algorithm
+    /// @param keys Keys to be sorted
+    OperationStatus sort(cl::CommandQueue CommandQueue, std::span<DataType> keys);
+
+    /// Sorts keys in place with a given algorithm, e.g. to validate decisions
+    /// @param CommandQueue OpenCL Command Queue used by the device algorithm
+    /// @param algorithm Algorithm to be run
+    /// @param keys Keys to be sorted
+    OperationStatus run(cl::CommandQueue CommandQueue, SortAlgorithm algorithm, std::span<DataType> keys);
+
+    /// Measures the cost coefficients on random, narrow and sorted keys
+    /// @param CommandQueue OpenCL Command Queue used by the device algorithm
+    OperationStatus calibrate(cl::CommandQueue CommandQueue);
+
+    /// Overrides the cost coefficients
+    void setCosts(const StrategyCosts& costs) noexcept;
+    const StrategyCosts& costs() const noexcept;
+
+    /// Returns one record per sort call, in call order
+    const std::vector<StrategyDecision>& decisions() const noexcept;
+
+    /// Sets output log stream receiving a line per decision
+    /// @param[in,out] out Log text stream
+    void setLogStream(std::ostream* out) noexcept;
+
+    /// Frees device buffers
+    OperationStatus release();
+
+private:
+    using Parameters = AlgorithmParameters<DataType>;
+
+    /// Sorts on the device, growing its buffers if needed
+    OperationStatus SortOnDevice(cl::CommandQueue CommandQueue, std::span<DataType> keys);
+    /// Partitions by the most significant bits and sorts the partitions
+    void SortMSD(std::span<DataType> keys) const;
+
+    RadixSortGPU<DataType> mSorter;
+    cl::Device mDevice;
+    cl::Context mContext;
+    /// Set once initialize() succeeded
+    bool mDeviceReady{false};
+    /// Device keys, holds mCapacity keys
+    cl::Buffer mKeys;
+    size_t mCapacity{0U};
+    /// Keys fitting into the largest device buffer
+    size_t mMaxDeviceKeys{0U};
+
+    /// Number of host threads and partitions of the MSD sort
+    std::size_t mNumThreads{std::max(std::thread::hardware_concurrency(), 1U)};
+    std::size_t mNumPartitions{4U * mNumThreads};
+
+    StrategyCosts mCosts{};
+    std::vector<StrategyDecision> mDecisions;
+    std::ostream* mOutStream{nullptr};
+};
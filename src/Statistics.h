@@ -1,7 +1,10 @@
 #pragma once
 
+#include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <limits>
+#include <vector>
 
 struct Statistics
 {
@@ -30,3 +33,17 @@ struct Statistics
         }
     }
 };
+
+/// Returns the p-th percentile of samples using nearest-rank
+/// @param samples Unordered sample values, copied for sorting
+/// @param p Percentile in [0, 100]
+/// @return Percentile value, 0 if there are no samples
+inline double percentile(std::vector<double> samples, double p)
+{
+    if (samples.empty()) {
+        return 0.0;
+    }
+    std::sort(samples.begin(), samples.end());
+    const auto rank = static_cast<std::size_t>(std::ceil(p / 100.0 * samples.size()));
+    return samples[std::clamp<std::size_t>(rank, 1U, samples.size()) - 1U];
+}
@@ -12,21 +12,414 @@
 #define OFFSET (0)
 #endif
 
+#ifndef MAXVALUE
+#define MAXVALUE (0x7FFFFFFF)
+#endif
+
+// type of key positions and histogram entries, ulong for more than 2^32-1 keys
+#ifndef IndexType
+#define IndexType uint
+#endif
+
+// type of the sums of values reduced by key, 64 bits of the signedness of DataType
+#ifndef SumType
+#define SumType long
+#endif
+
+// computes minimum and maximum of the keys shifted into the unsigned
+// region for each group, each work item reduces a strided range first
+__kernel void keyrange(
+    const __global DataType* restrict d_Keys,
+          __global UnsignedDataType* restrict d_GroupRanges,
+          __local  UnsignedDataType* loc_min,
+          __local  UnsignedDataType* loc_max,
+    const IndexType n)
+{
+    const int it    = get_local_id(0);
+    const int items = get_local_size(0);
+
+    UnsignedDataType lo = ~(UnsignedDataType)0;
+    UnsignedDataType hi = 0;
+    for (IndexType k = get_global_id(0); k < n; k += get_global_size(0)) {
+        const UnsignedDataType key = d_Keys[k] + OFFSET;
+        lo = min(lo, key);
+        hi = max(hi, key);
+    }
+    loc_min[it] = lo;
+    loc_max[it] = hi;
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    // tree reduction, items is a power of two
+    for (int d = items >> 1; d > 0; d >>= 1) {
+        if (it < d) {
+            loc_min[it] = min(loc_min[it], loc_min[it + d]);
+            loc_max[it] = max(loc_max[it], loc_max[it + d]);
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+
+    if (it == 0) {
+        d_GroupRanges[2 * get_group_id(0)]     = loc_min[0];
+        d_GroupRanges[2 * get_group_id(0) + 1] = loc_max[0];
+    }
+}
+
+// count descents (key > next key) and ascents of d_Keys[offset, offset + n) per group
+__kernel void presortedness(
+    const __global DataType* restrict d_Keys,
+    const IndexType offset,
+    const IndexType n,
+          __global IndexType* restrict d_GroupCounts,
+          __local  IndexType* loc_descents,
+          __local  IndexType* loc_ascents)
+{
+    const int it    = get_local_id(0);
+    const int items = get_local_size(0);
+
+    IndexType descents = 0;
+    IndexType ascents  = 0;
+    for (IndexType k = get_global_id(0); k + 1 < n; k += get_global_size(0)) {
+        const DataType key  = d_Keys[offset + k];
+        const DataType next = d_Keys[offset + k + 1];
+        descents += key > next;
+        ascents  += key < next;
+    }
+    loc_descents[it] = descents;
+    loc_ascents[it]  = ascents;
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    // tree reduction, items is a power of two
+    for (int d = items >> 1; d > 0; d >>= 1) {
+        if (it < d) {
+            loc_descents[it] += loc_descents[it + d];
+            loc_ascents[it]  += loc_ascents[it + d];
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+
+    if (it == 0) {
+        d_GroupCounts[2 * get_group_id(0)]     = loc_descents[0];
+        d_GroupCounts[2 * get_group_id(0) + 1] = loc_ascents[0];
+    }
+}
+
+// append the positions after the descents of d_Keys[offset, offset + n) to d_RunStarts.
+// Only launched once presortedness counted few descents, so the atomic is rarely taken.
+__kernel void runstarts(
+    const __global DataType* restrict d_Keys,
+    const IndexType offset,
+    const IndexType n,
+          volatile __global uint* d_NumRunStarts,
+          __global IndexType* restrict d_RunStarts)
+{
+    for (IndexType k = get_global_id(0); k + 1 < n; k += get_global_size(0)) {
+        if (d_Keys[offset + k] > d_Keys[offset + k + 1]) {
+            d_RunStarts[atomic_inc(d_NumRunStarts)] = k + 1;
+        }
+    }
+}
+
+// reverse d_Keys[offset, offset + n) in place
+__kernel void reversekeys(
+          __global DataType* d_Keys,
+    const IndexType offset,
+    const IndexType n)
+{
+    for (IndexType k = get_global_id(0); k < n / 2; k += get_global_size(0)) {
+        const DataType key = d_Keys[offset + k];
+        d_Keys[offset + k] = d_Keys[offset + n - 1 - k];
+        d_Keys[offset + n - 1 - k] = key;
+    }
+}
+
+// merge pairs of neighbouring sorted runs, run r is [d_RunOffsets[r], d_RunOffsets[r + 1]).
+// Every key finds its position by a binary search in the other run of its pair,
+// equal keys of the left run go first. A last run without partner is copied.
+__kernel void mergeruns(
+    const __global DataType* restrict d_inKeys,
+          __global DataType* restrict d_outKeys,
+    const __global IndexType* restrict d_RunOffsets,
+    const uint numRuns,
+    const IndexType n)
+{
+    for (IndexType k = get_global_id(0); k < n; k += get_global_size(0)) {
+        // there are only a few runs
+        uint run = 0;
+        while (run + 1 < numRuns && d_RunOffsets[run + 1] <= k) {
+            run++;
+        }
+        const DataType key = d_inKeys[k];
+        const uint partner = run ^ 1;
+        if (partner >= numRuns) {
+            d_outKeys[k] = key;
+            continue;
+        }
+
+        const bool left = (run & 1) == 0;
+        const IndexType partnerBegin = d_RunOffsets[partner];
+        IndexType lo = partnerBegin;
+        IndexType hi = d_RunOffsets[partner + 1];
+        while (lo < hi) {
+            const IndexType mid = lo + (hi - lo) / 2;
+            const DataType other = d_inKeys[mid];
+            if (other < key || (!left && other == key)) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        d_outKeys[d_RunOffsets[run & ~1u] + (k - d_RunOffsets[run]) + (lo - partnerBegin)] = key;
+    }
+}
+
+// gather sampleSize keys of d_Keys[0, n) at the midpoints of equal parts
+__kernel void samplekeys(
+    const __global DataType* restrict d_Keys,
+          __global DataType* restrict d_Sample,
+    const IndexType n,
+    const uint sampleSize)
+{
+    for (uint i = get_global_id(0); i < sampleSize; i += get_global_size(0)) {
+        d_Sample[i] = d_Keys[(IndexType)((2 * (ulong)i + 1) * n / (2 * (ulong)sampleSize))];
+    }
+}
+
+// count the keys of d_Keys[0, n) per bin. Bins are the distances to the minimum
+// of d_KeyRange, or the positions in d_Dictionary if there is one. Keys missing
+// from the dictionary are flagged in d_Counts[numBins].
+__kernel void countkeys(
+    const __global DataType* restrict d_Keys,
+          volatile __global uint* d_Counts,
+    const __global UnsignedDataType* restrict d_KeyRange,
+    const __global DataType* restrict d_Dictionary,
+    const uint numDictionary,
+    const uint numBins,
+    const IndexType n)
+{
+    // each work-item counts a contiguous chunk, so that equal
+    // neighbours take a single atomic instead of one each
+    const IndexType chunk = (n + get_global_size(0) - 1) / get_global_size(0);
+    const IndexType begin = min((IndexType)get_global_id(0) * chunk, n);
+    const IndexType end   = min(begin + chunk, n);
+    const UnsignedDataType minKey = d_KeyRange[0];
+
+    uint bin = 0;
+    uint count = 0;
+    for (IndexType k = begin; k < end; k++) {
+        const DataType key = d_Keys[k];
+        uint b;
+        if (numDictionary > 0) {
+            uint lo = 0;
+            uint hi = numDictionary;
+            while (lo < hi) {
+                const uint mid = (lo + hi) / 2;
+                if (d_Dictionary[mid] < key) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+            if (lo == numDictionary || d_Dictionary[lo] != key) {
+                d_Counts[numBins] = 1;
+                return;
+            }
+            b = lo;
+        } else {
+            b = (uint)((UnsignedDataType)(key + OFFSET) - minKey);
+        }
+        if (count > 0 && b != bin) {
+            atomic_add(&d_Counts[bin], count);
+            count = 0;
+        }
+        bin = b;
+        count++;
+    }
+    if (count > 0) {
+        atomic_add(&d_Counts[bin], count);
+    }
+}
+
+// exclusive scan of d_Counts[0, numBins) by a single work-group,
+// every work-item scans a contiguous chunk after the chunk sums
+__kernel void scancounts(
+          __global uint* d_Counts,
+          __local  uint* loc_sums,
+    const uint numBins)
+{
+    const int it    = get_local_id(0);
+    const int items = get_local_size(0);
+    const uint chunk = (numBins + items - 1) / items;
+    const uint begin = min(it * chunk, numBins);
+    const uint end   = min(begin + chunk, numBins);
+
+    uint sum = 0;
+    for (uint b = begin; b < end; b++) {
+        sum += d_Counts[b];
+    }
+    loc_sums[it] = sum;
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    if (it == 0) {
+        uint total = 0;
+        for (int i = 0; i < items; i++) {
+            const uint s = loc_sums[i];
+            loc_sums[i] = total;
+            total += s;
+        }
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    uint offset = loc_sums[it];
+    for (uint b = begin; b < end; b++) {
+        const uint c = d_Counts[b];
+        d_Counts[b] = offset;
+        offset += c;
+    }
+}
+
+// write the key of every position of d_outKeys[0, n), its bin is the last one
+// starting at or before the position in the scanned counts d_Offsets
+__kernel void expandcounts(
+    const __global uint* restrict d_Offsets,
+          __global DataType* restrict d_outKeys,
+    const __global UnsignedDataType* restrict d_KeyRange,
+    const __global DataType* restrict d_Dictionary,
+    const uint numDictionary,
+    const uint numBins,
+    const IndexType n)
+{
+    const UnsignedDataType minKey = d_KeyRange[0];
+    for (IndexType k = get_global_id(0); k < n; k += get_global_size(0)) {
+        // empty bins share their offset with the next one
+        uint lo = 0;
+        uint hi = numBins;
+        while (lo < hi) {
+            const uint mid = (lo + hi) / 2;
+            if (d_Offsets[mid] <= k) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        const uint bin = lo - 1;
+        d_outKeys[k] = numDictionary > 0
+            ? d_Dictionary[bin]
+            : (DataType)((UnsignedDataType)(minKey + bin) - OFFSET);
+    }
+}
+
+#define _SELECT_RADIX (1 << _SELECT_BITS)
+
+// count the keys of d_Keys[offset, offset + n) per digit of _SELECT_BITS bits at
+// shift into d_Counts[histogram * _SELECT_RADIX, (histogram + 1) * _SELECT_RADIX),
+// only keys whose bits above the digit equal prefix are counted
+__kernel void selecthistogram(
+    const __global DataType* restrict d_Keys,
+    const IndexType offset,
+    const IndexType n,
+    const UnsignedDataType prefix,
+    const uint shift,
+          volatile __global uint* d_Counts,
+    const uint histogram,
+          volatile __local uint* loc_counts)
+{
+    const int it    = get_local_id(0);
+    const int items = get_local_size(0);
+
+    for (int b = it; b < _SELECT_RADIX; b += items) {
+        loc_counts[b] = 0;
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    // shifting by the width of the type is undefined, the top digit has no prefix
+    const bool hasPrefix = shift + _SELECT_BITS < _TOTALBITS;
+    for (IndexType k = get_global_id(0); k < n; k += get_global_size(0)) {
+        const UnsignedDataType key = d_Keys[offset + k] + OFFSET;
+        if (!hasPrefix || (key >> (shift + _SELECT_BITS)) == prefix) {
+            atomic_inc(&loc_counts[(key >> shift) & (_SELECT_RADIX - 1)]);
+        }
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    for (int b = it; b < _SELECT_RADIX; b += items) {
+        if (loc_counts[b] > 0) {
+            atomic_add(&d_Counts[histogram * _SELECT_RADIX + b], loc_counts[b]);
+        }
+    }
+}
+
+// split d_inKeys[offset, offset + n) into the keys before, equal to and after
+// pivot, in ascending or descending order. d_Offsets holds the start of each part
+// in d_outKeys and is advanced by one atomic per part and tile of a work-group.
+__kernel void partitionselect(
+    const __global DataType* restrict d_inKeys,
+    const IndexType offset,
+          __global DataType* restrict d_outKeys,
+    const UnsignedDataType pivot,
+    const uint descending,
+          volatile __global uint* d_Offsets,
+          volatile __local uint* loc_counts,
+          __local uint* loc_offsets,
+    const IndexType n)
+{
+    const int it    = get_local_id(0);
+    const int items = get_local_size(0);
+
+    // whole work-groups take a tile each, so that all items reach the barriers
+    for (IndexType base = (IndexType)get_group_id(0) * items; base < n; base += get_global_size(0)) {
+        if (it < 3) {
+            loc_counts[it] = 0;
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        const IndexType k = base + it;
+        DataType value = 0;
+        uint part = 3;
+        uint position = 0;
+        if (k < n) {
+            value = d_inKeys[offset + k];
+            const UnsignedDataType key = value + OFFSET;
+            part = key < pivot ? 0 : (key == pivot ? 1 : 2);
+            if (descending) {
+                part = 2 - part;
+            }
+            position = atomic_inc(&loc_counts[part]);
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        if (it < 3) {
+            loc_offsets[it] = atomic_add(&d_Offsets[it], loc_counts[it]);
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        if (part < 3) {
+            d_outKeys[loc_offsets[part] + position] = value;
+        }
+        // counts are cleared for the next tile
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+}
+
 // compute the histogram for each radix and each virtual processor for the pass
+// d_KeyRange holds the minimum key and the span of all keys, keys are sorted
+// by their distance to the minimum, larger ones (padding) count as the maximum
 __kernel void histogram(
             const __global DataType* restrict d_Keys,
-			      __global int*      restrict d_Histograms,
+			      __global IndexType* restrict d_Histograms,
 			const int pass,
-			       __local int* loc_histo,
-			const int n) 
+			       __local IndexType* loc_histo,
+			const IndexType n,
+            const __global UnsignedDataType* restrict d_KeyRange)
 {
   int it = get_local_id(0);  // i local number of the processor
-  int ig = get_global_id(0); // global number = i + g I
+  int ig = get_global_id(0); // global number = i + g I, includes the global offset
 
-  int gr = get_group_id(0); // gr group number
-
-  const int groups = get_num_groups(0);
   int items  = get_local_size(0);
+  // group number derived from the global id, since the kernel
+  // may be launched on a subset of the groups via a global offset
+  int gr = ig / items;
+
+  const int groups = _GROUPS;
 
   // initialize the local histograms to zero
   for(int ir = 0; ir < _RADIX; ir++) {
@@ -36,19 +429,21 @@ __kernel void histogram(
   barrier(CLK_LOCAL_MEM_FENCE);
 
   // range of keys that are analyzed by the work item
-  int sublist_size  = n/groups/items; // size of the sub-list
-  int sublist_start = ig * sublist_size; // beginning of the sub-list
+  IndexType sublist_size  = n/groups/items; // size of the sub-list
+  IndexType sublist_start = (IndexType)ig * sublist_size; // beginning of the sub-list
 
   UnsignedDataType key;
   UnsignedDataType shortkey;
-  int k;
+  IndexType k;
+  const UnsignedDataType minKey = d_KeyRange[0];
+  const UnsignedDataType span   = d_KeyRange[1];
 
   // compute the index
   // the computation depends on the transposition
-  for(int j = 0; j < sublist_size; j++) {
+  for(IndexType j = 0; j < sublist_size; j++) {
     k = j + sublist_start;
 
-    key = d_Keys[k] + OFFSET;
+    key = min((UnsignedDataType)(d_Keys[k] + OFFSET) - minKey, span);
 
     // extract the group of _BITS bits of the pass
     // the result is in the range 0.._RADIX-1
@@ -70,16 +465,19 @@ __kernel void histogram(
   }
 }
 
-// each virtual processor reorders its data using the scanned histogram
-__kernel void reorder(
+// each virtual processor reorders its data using the scanned histogram,
+// the permutations are moved along with the keys if permute is set
+void reorderkeys(
     const __global DataType* restrict d_inKeys,
           __global DataType* restrict d_outKeys,
-    const __global int* d_Histograms,
+    const __global IndexType* d_Histograms,
     const int pass,
           __global int* d_inPermut,
           __global int* d_outPermut,
-          __local  int* loc_histo,
-    const int n)
+          __local  IndexType* loc_histo,
+    const IndexType n,
+    const __global UnsignedDataType* restrict d_KeyRange,
+    const int permute)
 {
 
 	int it = get_local_id(0);  // i local number of the processor
@@ -89,8 +487,8 @@ __kernel void reorder(
     const int groups = get_num_groups(0);	// G: group count
     int items = get_local_size(0);			// group size
 
-	int start = ig *(n / groups / items);   // index of first elem this work-item processes
-    int size  = n / groups / items;			// count of elements this work-item processes
+	IndexType start = (IndexType)ig *(n / groups / items);   // index of first elem this work-item processes
+    IndexType size  = n / groups / items;			// count of elements this work-item processes
 
     // take the histogram in the cache
     for (int ir = 0; ir < _RADIX; ir++){
@@ -99,33 +497,70 @@ __kernel void reorder(
     }
     barrier(CLK_LOCAL_MEM_FENCE);
 
-	int newpos;					// new position of element
-	UnsignedDataType key;		// key element
+	IndexType newpos;			// new position of element
+	DataType value;				// key element
+	UnsignedDataType key;		// distance of the key to the minimum
 	UnsignedDataType shortkey;	// key element within cache (cache line)
-	int k;						// global position within input elements
+	IndexType k;				// global position within input elements
+    const UnsignedDataType minKey = d_KeyRange[0];
+    const UnsignedDataType span   = d_KeyRange[1];
 
-    for (int j = 0; j < size; j++) {
+    for (IndexType j = 0; j < size; j++) {
         k = j + start;
-        key = d_inKeys[k] + OFFSET;
+        value = d_inKeys[k];
+        key = min((UnsignedDataType)(value + OFFSET) - minKey, span);
         shortkey = ((key >> (pass * _BITS)) & (_RADIX - 1));	// shift element to relevant bit positions
 
         newpos = loc_histo[shortkey * items + it];
 
-        d_outKeys[newpos] = key - OFFSET;
+        d_outKeys[newpos] = value;
+        if (permute) {
+            d_outPermut[newpos] = d_inPermut[k];
+        }
 
         newpos++;
         loc_histo[shortkey * items + it] = newpos;
     }
 }
 
+__kernel void reorder(
+    const __global DataType* restrict d_inKeys,
+          __global DataType* restrict d_outKeys,
+    const __global IndexType* d_Histograms,
+    const int pass,
+          __global int* d_inPermut,
+          __global int* d_outPermut,
+          __local  IndexType* loc_histo,
+    const IndexType n,
+    const __global UnsignedDataType* restrict d_KeyRange)
+{
+    reorderkeys(d_inKeys, d_outKeys, d_Histograms, pass, d_inPermut, d_outPermut, loc_histo, n, d_KeyRange, 0);
+}
+
+// reorders the keys together with their permutations, the passes
+// are stable so that the permutations of equal keys stay ascending
+__kernel void reorderpairs(
+    const __global DataType* restrict d_inKeys,
+          __global DataType* restrict d_outKeys,
+    const __global IndexType* d_Histograms,
+    const int pass,
+          __global int* d_inPermut,
+          __global int* d_outPermut,
+          __local  IndexType* loc_histo,
+    const IndexType n,
+    const __global UnsignedDataType* restrict d_KeyRange)
+{
+    reorderkeys(d_inKeys, d_outKeys, d_Histograms, pass, d_inPermut, d_outPermut, loc_histo, n, d_KeyRange, 1);
+}
+
 
 // perform a parallel prefix sum (a scan) on the local histograms
 // (see Blelloch 1990) each workitem worries about two memories
 // see also http://http.developer.nvidia.com/GPUGems3/gpugems3_ch39.html
 __kernel void scanhistograms(
-    __global int* histo, 
-    __local int* temp, 
-    __global int* globsum) 
+    __global IndexType* histo, 
+    __local IndexType* temp, 
+    __global IndexType* globsum) 
 {
     int it = get_local_id(0);
     int ig = get_global_id(0);
@@ -168,7 +603,7 @@ __kernel void scanhistograms(
             int ai = decale*((it << 1) + 1) - 1;
             int bi = decale*((it << 1) + 2) - 1;
 
-            int t = temp[ai];
+            IndexType t = temp[ai];
             temp[ai] = temp[bi];
             temp[bi] += t;
         }
@@ -183,15 +618,273 @@ __kernel void scanhistograms(
 // use the global sum for updating the local histograms
 // each work item updates two values
 __kernel void pastehistograms(
-          __global int* restrict histo, 
-    const __global int* restrict globsum) 
+          __global IndexType* restrict histo, 
+    const __global IndexType* restrict globsum) 
 {
     int ig = get_global_id(0);
     int gr = get_group_id(0);
 
-    int s = globsum[gr];
+    IndexType s = globsum[gr];
 
     // write results to device memory
     histo[(ig << 1)]     += s;
     histo[(ig << 1) + 1] += s;
-}
\ No newline at end of file
+}
+
+// sorts small segments entirely in local memory with a bitonic network,
+// one work-group per segment. Segments are padded to sortSize (a power
+// of two) with the maximum value, which is not written back.
+__kernel void localsort(
+          __global DataType* restrict d_Keys,
+    const __global uint* restrict d_SegmentOffsets,
+    const __global uint* restrict d_SegmentIds,
+    const uint firstSegment,
+          __local DataType* loc_keys,
+    const uint sortSize)
+{
+    const uint segment = d_SegmentIds[firstSegment + get_group_id(0)];
+    const uint start   = d_SegmentOffsets[segment];
+    const uint size    = d_SegmentOffsets[segment + 1] - start;
+
+    const uint it    = get_local_id(0);
+    const uint items = get_local_size(0);
+
+    // load the segment into local memory
+    for (uint i = it; i < sortSize; i += items) {
+        loc_keys[i] = (i < size) ? d_Keys[start + i] : MAXVALUE;
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    // bitonic merges of growing size k, each work item handles
+    // the pairs (i, i^j) it owns
+    for (uint k = 2; k <= sortSize; k <<= 1) {
+        for (uint j = k >> 1; j > 0; j >>= 1) {
+            for (uint i = it; i < sortSize; i += items) {
+                const uint partner = i ^ j;
+                if (partner > i) {
+                    const DataType a = loc_keys[i];
+                    const DataType b = loc_keys[partner];
+                    const bool ascending = (i & k) == 0;
+                    if ((a > b) == ascending) {
+                        loc_keys[i]       = b;
+                        loc_keys[partner] = a;
+                    }
+                }
+            }
+            barrier(CLK_LOCAL_MEM_FENCE);
+        }
+    }
+
+    // write back the sorted segment without padding
+    for (uint i = it; i < size; i += items) {
+        d_Keys[start + i] = loc_keys[i];
+    }
+}
+
+// identity permutation of d_Permut[0, n), the position of every key before the sort.
+// Unsigned so that positions of up to 2^32 - 1 keys stay valid, the passes only move them.
+__kernel void initpermutation(
+          __global uint* restrict d_Permut,
+    const IndexType n)
+{
+    for (IndexType k = get_global_id(0); k < n; k += get_global_size(0)) {
+        d_Permut[k] = (uint)k;
+    }
+}
+
+// count, sum, minimum and maximum of the values of a run of equal keys,
+// minimum and maximum are undefined while count is 0
+typedef struct {
+    uint count;
+    SumType sum;
+    ValueType minimum;
+    ValueType maximum;
+} Aggregate;
+
+Aggregate aggregatevalue(Aggregate a, const ValueType value)
+{
+    a.minimum = a.count > 0 ? min(a.minimum, value) : value;
+    a.maximum = a.count > 0 ? max(a.maximum, value) : value;
+    // sums wrap around instead of overflowing
+    a.sum = (SumType)((ulong)a.sum + (ulong)(SumType)value);
+    a.count++;
+    return a;
+}
+
+// combines the aggregates of consecutive values, either may be empty
+Aggregate combineaggregates(Aggregate a, const Aggregate b)
+{
+    if (a.count == 0) {
+        return b;
+    }
+    if (b.count > 0) {
+        a.minimum = min(a.minimum, b.minimum);
+        a.maximum = max(a.maximum, b.maximum);
+        a.sum = (SumType)((ulong)a.sum + (ulong)b.sum);
+        a.count += b.count;
+    }
+    return a;
+}
+
+// a segment of equal keys starts at position k
+bool segmenthead(const __global DataType* restrict d_Keys, const IndexType k)
+{
+    return k == 0 || d_Keys[k] != d_Keys[k - 1];
+}
+
+// each work item reduces a contiguous chunk of the sorted keys d_Keys[0, n) into a
+// record: the number of segment heads in the chunk and the aggregate of the values
+// following its last head, of the whole chunk if it holds no head. Values are read
+// from d_Values[valueOffset, valueOffset + n) through the permutations of the sort.
+__kernel void segmentreduce(
+    const __global DataType* restrict d_Keys,
+    const __global uint* restrict d_Permut,
+    const __global ValueType* restrict d_Values,
+    const IndexType valueOffset,
+          __global uint* restrict d_Heads,
+          __global uint* restrict d_Counts,
+          __global SumType* restrict d_Sums,
+          __global ValueType* restrict d_Mins,
+          __global ValueType* restrict d_Maxs,
+    const IndexType n)
+{
+    const size_t ig = get_global_id(0);
+    const size_t numItems = get_global_size(0);
+    const IndexType begin = (IndexType)((ulong)n * ig / numItems);
+    const IndexType end   = (IndexType)((ulong)n * (ig + 1) / numItems);
+
+    uint heads = 0;
+    Aggregate a = {0, 0, 0, 0};
+    for (IndexType k = begin; k < end; k++) {
+        if (segmenthead(d_Keys, k)) {
+            heads++;
+            a.count = 0;
+            a.sum = 0;
+        }
+        a = aggregatevalue(a, d_Values[valueOffset + d_Permut[k]]);
+    }
+    d_Heads[ig]  = heads;
+    d_Counts[ig] = a.count;
+    d_Sums[ig]   = a.sum;
+    d_Mins[ig]   = a.minimum;
+    d_Maxs[ig]   = a.maximum;
+}
+
+// exclusive segmented scan of the numRecords records of segmentreduce by a single
+// work-group. Every record turns into the number of heads before its chunk and the
+// aggregate of the segment open at the start of the chunk, which restarts at every
+// chunk holding a head. The total number of heads is appended to d_Heads.
+__kernel void segmentscan(
+          __global uint* d_Heads,
+          __global uint* d_Counts,
+          __global SumType* d_Sums,
+          __global ValueType* d_Mins,
+          __global ValueType* d_Maxs,
+          __local  uint* loc_heads,
+          __local  uint* loc_counts,
+          __local  SumType* loc_sums,
+          __local  ValueType* loc_mins,
+          __local  ValueType* loc_maxs,
+    const uint numRecords)
+{
+    const int it    = get_local_id(0);
+    const int items = get_local_size(0);
+    const uint chunk = (numRecords + items - 1) / items;
+    const uint begin = min(it * chunk, numRecords);
+    const uint end   = min(begin + chunk, numRecords);
+
+    uint heads = 0;
+    Aggregate a = {0, 0, 0, 0};
+    for (uint r = begin; r < end; r++) {
+        const Aggregate b = {d_Counts[r], d_Sums[r], d_Mins[r], d_Maxs[r]};
+        a = d_Heads[r] > 0 ? b : combineaggregates(a, b);
+        heads += d_Heads[r];
+    }
+    loc_heads[it]  = heads;
+    loc_counts[it] = a.count;
+    loc_sums[it]   = a.sum;
+    loc_mins[it]   = a.minimum;
+    loc_maxs[it]   = a.maximum;
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    if (it == 0) {
+        uint total = 0;
+        Aggregate open = {0, 0, 0, 0};
+        for (int i = 0; i < items; i++) {
+            const uint h = loc_heads[i];
+            const Aggregate b = {loc_counts[i], loc_sums[i], loc_mins[i], loc_maxs[i]};
+            loc_heads[i]  = total;
+            loc_counts[i] = open.count;
+            loc_sums[i]   = open.sum;
+            loc_mins[i]   = open.minimum;
+            loc_maxs[i]   = open.maximum;
+            open = h > 0 ? b : combineaggregates(open, b);
+            total += h;
+        }
+        d_Heads[numRecords] = total;
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    heads = loc_heads[it];
+    a.count   = loc_counts[it];
+    a.sum     = loc_sums[it];
+    a.minimum = loc_mins[it];
+    a.maximum = loc_maxs[it];
+    for (uint r = begin; r < end; r++) {
+        const uint h = d_Heads[r];
+        const Aggregate b = {d_Counts[r], d_Sums[r], d_Mins[r], d_Maxs[r]};
+        d_Heads[r]  = heads;
+        d_Counts[r] = a.count;
+        d_Sums[r]   = a.sum;
+        d_Mins[r]   = a.minimum;
+        d_Maxs[r]   = a.maximum;
+        a = h > 0 ? b : combineaggregates(a, b);
+        heads += h;
+    }
+}
+
+// each work item continues the segment open at the start of its chunk of the sorted
+// keys d_Keys[0, n) from the scanned records and writes the key and aggregate of every
+// segment ending in the chunk at the position of the segment among all segments
+__kernel void segmentemit(
+    const __global DataType* restrict d_Keys,
+    const __global uint* restrict d_Permut,
+    const __global ValueType* restrict d_Values,
+    const IndexType valueOffset,
+    const __global uint* restrict d_Heads,
+    const __global uint* restrict d_Counts,
+    const __global SumType* restrict d_Sums,
+    const __global ValueType* restrict d_Mins,
+    const __global ValueType* restrict d_Maxs,
+          __global DataType* restrict d_outKeys,
+          __global uint* restrict d_outCounts,
+          __global SumType* restrict d_outSums,
+          __global ValueType* restrict d_outMins,
+          __global ValueType* restrict d_outMaxs,
+    const IndexType n)
+{
+    const size_t ig = get_global_id(0);
+    const size_t numItems = get_global_size(0);
+    const IndexType begin = (IndexType)((ulong)n * ig / numItems);
+    const IndexType end   = (IndexType)((ulong)n * (ig + 1) / numItems);
+
+    Aggregate a = {d_Counts[ig], d_Sums[ig], d_Mins[ig], d_Maxs[ig]};
+    // wraps around before the first head, the first key of all is one
+    uint segment = d_Heads[ig] - 1;
+    for (IndexType k = begin; k < end; k++) {
+        const DataType key = d_Keys[k];
+        if (segmenthead(d_Keys, k)) {
+            segment++;
+            a.count = 0;
+            a.sum = 0;
+        }
+        a = aggregatevalue(a, d_Values[valueOffset + d_Permut[k]]);
+        if (k + 1 == n || d_Keys[k + 1] != key) {
+            d_outKeys[segment]   = key;
+            d_outCounts[segment] = a.count;
+            d_outSums[segment]   = a.sum;
+            d_outMins[segment]   = a.minimum;
+            d_outMaxs[segment]   = a.maximum;
+        }
+    }
+}
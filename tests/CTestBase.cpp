@@ -14,7 +14,9 @@ CTestBase::CTestBase(std::vector<std::string> arguments /*= {}*/)
 
 bool CTestBase::InitCLContext()
 {
-    return m_computeState.init();
+    // Device options are consumed here, the remaining arguments go to the task
+    auto arguments = m_arguments;
+    return m_computeState.init(DeviceSelection::FromArguments(arguments));
 }
 
 bool CTestBase::RunComputeTask(IComputeTask& Task, const LocalWorkSize& LocalWorkSize)
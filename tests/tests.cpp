@@ -6,9 +6,30 @@
 #include "Dataset.h"
 #include "RadixSortOptions.h"
 #include "CRadixSortTask.h"
+#include "RadixSortPipeline.h"
+#include "SegmentedRadixSortGPU.h"
+#include "AutoRadixSort.h"
+#include "ChunkedRadixSort.h"
+#include "ExternalRadixSort.h"
+#include "MultiDeviceRadixSort.h"
+#include "HeterogeneousRadixSort.h"
+#include "ConcurrentRadixSort.h"
+#include "RadixSortAutotuner.h"
+#include "SortStrategy.h"
+#include "RadixSelect.h"
+#include "ReduceByKey.h"
+#include "CRadixSortCPU.h"
+#include "Common/MappedFile.h"
 #include <exception>
+#include <filesystem>
+#include <future>
+#include <fstream>
 #include <ranges>
 #include <algorithm>
+#include <numeric>
+#include <random>
+#include <limits>
+#include <bit>
 
 #include "Common/Util.hpp"
 // TODO: Move
@@ -26,6 +47,35 @@ auto DatasetCreator(size_t num_elements)
     );
 }
 
+/// Host buffers for a sorter of numRounded keys, holding the given keys
+template <typename DataType>
+HostData<DataType> CreateHostData(const std::vector<DataType>& keys, size_t numRounded)
+{
+    using Parameters = AlgorithmParameters<DataType>;
+    HostData<DataType> hostData;
+    hostData.m_hKeys.assign(numRounded, std::numeric_limits<DataType>::max());
+    std::ranges::copy(keys, hostData.m_hKeys.begin());
+    hostData.m_hHistograms.resize(Parameters::_RADIX * Parameters::_NUM_ITEMS);
+    hostData.m_hGlobsum.resize(Parameters::_NUM_HISTOSPLIT);
+    hostData.h_Permut.resize(numRounded);
+    std::iota(hostData.h_Permut.begin(), hostData.h_Permut.end(), 0U);
+    hostData.m_hResultFromGPU.resize(numRounded);
+    return hostData;
+}
+
+/// Non-owning view of host buffers
+template <typename DataType>
+HostSpans<DataType> SpansOf(HostData<DataType>& hostData)
+{
+    return {
+        {hostData.m_hKeys.data(), hostData.m_hKeys.size()},
+        {hostData.m_hHistograms.data(), hostData.m_hHistograms.size()},
+        {hostData.m_hGlobsum.data(), hostData.m_hGlobsum.size()},
+        {hostData.h_Permut.data(), hostData.h_Permut.size()},
+        {hostData.m_hResultFromGPU.data(), hostData.m_hResultFromGPU.size()},
+    };
+}
+
 class CRunner : public CTestBase
 {
 public:
@@ -87,15 +137,14 @@ bool CRunner::DoCompute()
     );
 }
 
-TEST_CASE( "Main test", "[main]" )
+namespace {
+/// Initializes OpenCL and runs all tasks, translating exceptions into failures
+void runChecked(CRunner& runner)
 {
-    // Non-interactive mode
-	CRunner radixSortRunner;
-
     try {
-        const auto initialized = radixSortRunner.InitCLContext();
+        const auto initialized = runner.InitCLContext();
         REQUIRE(initialized);
-        const auto status = radixSortRunner.DoCompute();
+        const auto status = runner.DoCompute();
         REQUIRE(status == true);
     } catch(const cl::Error& exc) {
         INFO("CL Error: " << std::string(exc.what()));
@@ -111,3 +160,995 @@ TEST_CASE( "Main test", "[main]" )
         REQUIRE(false);
     }
 }
+} // namespace
+
+TEST_CASE( "Main test", "[main]" )
+{
+    // Non-interactive mode
+	CRunner radixSortRunner;
+    runChecked(radixSortRunner);
+}
+
+TEST_CASE( "Zero-copy test", "[zerocopy]" )
+{
+	CRunner radixSortRunner({"--zero-copy", "--num-elements", "1048576"});
+    runChecked(radixSortRunner);
+}
+
+TEST_CASE( "Zero-copy odd passes test", "[zerocopy]" )
+{
+    ComputeState computeState;
+    REQUIRE(computeState.init());
+    auto queue = computeState.m_CLCommandQueue;
+
+    constexpr size_t numElements = 100000U;
+    RadixSortGPU<uint32_t> sorter;
+    sorter.setMemoryMode(MemoryMode::ZERO_COPY);
+    sorter.setLocalSortThreshold(0U);
+    sorter.setCountingSort(false);
+    sorter.setPresortedDetection(false);
+    auto hostData = CreateHostData(std::vector<uint32_t>(numElements), sorter.Resize(numElements));
+    REQUIRE(sorter.initialize(computeState.device(), computeState.m_CLContext, numElements, SpansOf(hostData)) == OperationStatus::OK);
+
+    // Keys of three radix digits leave the result after an odd number of swaps
+    const auto numBits = 3U * sorter.config().bitsPerRadix;
+    std::mt19937 generator(5U);
+    for (int batch = 0; batch < 2; batch++) {
+        std::vector<uint32_t> keys(numElements);
+        std::ranges::generate(keys, [&]() { return static_cast<uint32_t>(generator() % (1ULL << numBits)); });
+        std::ranges::copy(keys, hostData.m_hKeys.begin());
+        std::iota(hostData.h_Permut.begin(), hostData.h_Permut.end(), 0U);
+
+        REQUIRE(sorter.uploadData(queue) == OperationStatus::OK);
+        REQUIRE(sorter.calculate(queue) == OperationStatus::OK);
+        REQUIRE(sorter.downloadData(queue) == OperationStatus::OK);
+        REQUIRE(sorter.numPasses() % 2U == 1U);
+
+        // every batch is sorted from its own keys
+        std::ranges::sort(keys);
+        const std::vector<uint32_t> result(hostData.m_hResultFromGPU.begin(), hostData.m_hResultFromGPU.begin() + numElements);
+        REQUIRE(result == keys);
+    }
+    sorter.release();
+}
+
+TEST_CASE( "Staged transfer test", "[staged]" )
+{
+	CRunner radixSortRunner({"--staged", "--num-elements", "1048576"});
+    runChecked(radixSortRunner);
+}
+
+TEST_CASE( "Pipeline test", "[pipeline]" )
+{
+    ComputeState computeState;
+    REQUIRE(computeState.init());
+
+    constexpr size_t maxBatchSize = 1U << 16U;
+    constexpr size_t numBatches = 16U;
+    RadixSortPipeline<int32_t> pipeline;
+    REQUIRE(pipeline.initialize(computeState.device(), computeState.m_CLContext, maxBatchSize) == OperationStatus::OK);
+
+    std::vector<std::vector<int32_t>> expected;
+    std::vector<std::future<std::vector<int32_t>>> results;
+    for (size_t i = 0U; i < numBatches; i++) {
+        // Vary the batch size to exercise padding
+        Random<int32_t> dataset(maxBatchSize - i * 1000U);
+        expected.push_back(dataset.dataset);
+        std::ranges::sort(expected.back());
+        results.push_back(pipeline.submit(dataset.dataset));
+    }
+    for (size_t i = 0U; i < numBatches; i++) {
+        REQUIRE(results[i].get() == expected[i]);
+    }
+
+    const auto stats = pipeline.getStatistics();
+    REQUIRE(stats.numBatches == numBatches);
+    REQUIRE(stats.latencyP50 <= stats.latencyP99);
+}
+
+TEST_CASE( "Asynchronous sort test", "[async]" )
+{
+    ComputeState computeState;
+    REQUIRE(computeState.init());
+
+    constexpr uint32_t numElements = 1U << 18U;
+    RandomDistributed<uint64_t> dataset(numElements);
+    auto expected = dataset.dataset;
+    std::ranges::sort(expected);
+
+    RadixSortGPU<uint64_t> sorter;
+    auto hostData = CreateHostData(dataset.dataset, sorter.Resize(numElements));
+    REQUIRE(sorter.initialize(computeState.device(), computeState.m_CLContext, numElements, SpansOf(hostData)) == OperationStatus::OK);
+
+    const auto first = sorter.sortAsync(computeState.m_CLCommandQueue);
+    // Sorts the same input again, ordered after the first sort
+    const auto second = sorter.sortAsync(computeState.m_CLCommandQueue, first);
+    auto future = second.toFuture();
+    future.get();
+    REQUIRE(first.ready());
+    REQUIRE(second.ready());
+
+    const std::vector<uint64_t> result(hostData.m_hResultFromGPU.begin(), hostData.m_hResultFromGPU.begin() + numElements);
+    REQUIRE(result == expected);
+
+    // A failed sort reports its error, and so does a sort ordered after it
+    const SortHandle failed(cl::Event{}, CL_OUT_OF_RESOURCES);
+    REQUIRE(failed.ready());
+    REQUIRE(failed.status() == CL_OUT_OF_RESOURCES);
+    REQUIRE_THROWS_AS(failed.toFuture().get(), cl::Error);
+    const auto dependent = sorter.sortAsync(computeState.m_CLCommandQueue, failed);
+    REQUIRE(dependent.status() == CL_OUT_OF_RESOURCES);
+}
+
+TEST_CASE( "Segmented sort test", "[segmented]" )
+{
+    ComputeState computeState;
+    REQUIRE(computeState.init());
+
+    // Mix of empty, tiny, local memory sized and large segments
+    const std::vector<uint32_t> segmentSizes{0U, 1U, 2U, 3U, 17U, 64U, 100U, 1000U, 4096U, 5000U, 70000U, 7U};
+    std::vector<uint32_t> segmentOffsets{0U};
+    for (const auto size : segmentSizes) {
+        segmentOffsets.push_back(segmentOffsets.back() + size);
+    }
+
+    Random<int64_t> dataset(segmentOffsets.back());
+    auto keys = dataset.dataset;
+    auto expected = keys;
+    for (size_t i = 0U; i + 1U < segmentOffsets.size(); i++) {
+        std::sort(expected.begin() + segmentOffsets[i], expected.begin() + segmentOffsets[i + 1U]);
+    }
+
+    // The largest segment exceeds the initial size and grows the sorter
+    SegmentedRadixSortGPU<int64_t> sorter;
+    REQUIRE(sorter.initialize(computeState.device(), computeState.m_CLContext, 1U << 12U) == OperationStatus::OK);
+    REQUIRE(sorter.sort(computeState.m_CLCommandQueue, keys, segmentOffsets) == OperationStatus::OK);
+    REQUIRE(keys == expected);
+}
+
+TEST_CASE( "Local sort test", "[localsort]" )
+{
+    ComputeState computeState;
+    REQUIRE(computeState.init());
+
+    constexpr uint32_t numElements = 1500U;
+    Random<uint32_t> dataset(numElements);
+    auto expected = dataset.dataset;
+    std::ranges::sort(expected);
+
+    RadixSortGPU<uint32_t> sorter;
+    const auto numRounded = sorter.Resize(numElements);
+    auto hostData = CreateHostData(dataset.dataset, numRounded);
+    REQUIRE(sorter.initialize(computeState.device(), computeState.m_CLContext, numElements, SpansOf(hostData)) == OperationStatus::OK);
+    REQUIRE(sorter.localSortThreshold() <= sorter.localSortCapacity());
+
+    // Force the local sort regardless of the measured threshold
+    REQUIRE(sorter.localSortCapacity() >= std::bit_ceil(numRounded));
+    sorter.setLocalSortThreshold(sorter.localSortCapacity());
+    const auto queue = computeState.m_CLCommandQueue;
+    REQUIRE(sorter.uploadData(queue) == OperationStatus::OK);
+    REQUIRE(sorter.calculate(queue) == OperationStatus::OK);
+    REQUIRE(sorter.downloadData(queue) == OperationStatus::OK);
+    REQUIRE(sorter.getRuntimes().timeLocalSort.n == 1U);
+
+    const std::vector<uint32_t> result(hostData.m_hResultFromGPU.begin(), hostData.m_hResultFromGPU.begin() + numElements);
+    REQUIRE(result == expected);
+
+    // The sorted keys left on the device take the presorted path,
+    // each call is a single sample of the total time
+    REQUIRE(sorter.calculate(queue) == OperationStatus::OK);
+    REQUIRE(sorter.getRuntimes().path == SortPath::SORTED);
+    REQUIRE(sorter.getRuntimes().timeLocalSort.n == 1U);
+    REQUIRE(sorter.getRuntimes().timeTotal.n == 2U);
+}
+
+TEST_CASE( "Automatic dispatch test", "[dispatch]" )
+{
+    ComputeState computeState;
+    REQUIRE(computeState.init());
+
+    const auto calibrationFile = (std::filesystem::temp_directory_path() / "radixsort_calibration_test.txt").string();
+    std::filesystem::remove(calibrationFile);
+
+    AutoRadixSort<int32_t> sorter;
+    REQUIRE(sorter.initialize(computeState.device(), computeState.m_CLContext, calibrationFile) == OperationStatus::OK);
+    REQUIRE(std::filesystem::exists(calibrationFile));
+    REQUIRE(sorter.thresholds().maxSingleThreaded <= sorter.thresholds().maxHost);
+
+    // A second instance reuses the stored calibration
+    AutoRadixSort<int32_t> reloaded;
+    REQUIRE(reloaded.initialize(computeState.device(), computeState.m_CLContext, calibrationFile) == OperationStatus::OK);
+    REQUIRE(reloaded.thresholds().maxSingleThreaded == sorter.thresholds().maxSingleThreaded);
+    REQUIRE(reloaded.thresholds().maxHost == sorter.thresholds().maxHost);
+
+    // Route each size class to a different backend
+    sorter.setThresholds({1000U, 100000U});
+    for (const auto numElements : {500U, 50000U, 300000U}) {
+        Random<int32_t> dataset(numElements);
+        auto keys = dataset.dataset;
+        auto expected = keys;
+        std::ranges::sort(expected);
+        REQUIRE(sorter.sort(computeState.m_CLCommandQueue, keys) == OperationStatus::OK);
+        REQUIRE(keys == expected);
+    }
+
+    const auto& decisions = sorter.decisions();
+    REQUIRE(decisions.size() == 3U);
+    REQUIRE(decisions[0].backend == SortBackend::HOST_SINGLE_THREADED);
+    REQUIRE(decisions[1].backend == SortBackend::HOST_MULTITHREADED);
+    REQUIRE(decisions[2].backend == SortBackend::DEVICE);
+    std::filesystem::remove(calibrationFile);
+}
+
+TEST_CASE( "Large size test", "[large]" )
+{
+    // Sizes beyond 32 bits are parsed and rounded without truncation
+    const RadixSortOptions options({"--num-elements", "6000000001"});
+    REQUIRE(options.num_elements == 6000000001ULL);
+
+    RadixSortGPU<uint32_t> sorter;
+    const auto numRounded = sorter.Resize(options.num_elements);
+    REQUIRE(numRounded >= options.num_elements);
+    REQUIRE(numRounded % AlgorithmParameters<uint32_t>::_NUM_ITEMS == 0U);
+    REQUIRE(numRounded - options.num_elements < AlgorithmParameters<uint32_t>::_NUM_ITEMS);
+}
+
+TEST_CASE( "Chunked sort test", "[chunked]" )
+{
+    ComputeState computeState;
+    REQUIRE(computeState.init());
+
+    // Budget for two slots of 2^16 keys, the input needs four runs
+    constexpr size_t runSize = 1U << 16U;
+    size_t budget = 1U << 20U;
+    while (ChunkedRadixSort<int64_t>::RunSizeForBudget(budget, 2U) < runSize) {
+        budget += 1U << 16U;
+    }
+
+    ChunkedRadixSort<int64_t> sorter;
+    REQUIRE(sorter.initialize(computeState.device(), computeState.m_CLContext, budget, 2U) == OperationStatus::OK);
+    REQUIRE(sorter.runSize() >= runSize);
+    REQUIRE(sorter.runSize() < runSize + (1U << 12U));
+
+    Random<int64_t> dataset(3U * runSize + 12345U);
+    auto keys = dataset.dataset;
+    auto expected = keys;
+    std::ranges::sort(expected);
+    REQUIRE(sorter.sort(keys) == OperationStatus::OK);
+    REQUIRE(keys == expected);
+}
+
+TEST_CASE( "External sort test", "[external]" )
+{
+    ComputeState computeState;
+    REQUIRE(computeState.init());
+
+    const auto tempDirectory = std::filesystem::temp_directory_path();
+    const auto input = tempDirectory / "radixsort_external_input.bin";
+    const auto output = tempDirectory / "radixsort_external_output.bin";
+    const auto secondOutput = tempDirectory / "radixsort_external_output2.bin";
+    const auto runDirectory = tempDirectory / "radixsort_external_runs";
+    std::filesystem::create_directory(runDirectory);
+
+    constexpr size_t numElements = 100000U;
+    Random<int64_t> dataset(numElements);
+    {
+        std::ofstream file(input, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(dataset.dataset.data()), sizeof(int64_t) * numElements);
+    }
+
+    // A tiny budget forces many runs and an intermediate merge pass
+    ExternalSortOptions options;
+    options.memoryBudget = 1U << 16U;
+    options.minMergeBlock = 1U << 12U;
+    options.tempDirectory = runDirectory;
+    options.calibrationFile = (tempDirectory / "radixsort_calibration_external.txt").string();
+
+    // A concurrent sort sharing the temporary directory keeps its own runs
+    ExternalRadixSort<int64_t> sorter;
+    ExternalRadixSort<int64_t> secondSorter;
+    REQUIRE(sorter.initialize(computeState.device(), computeState.m_CLContext, options) == OperationStatus::OK);
+    REQUIRE(secondSorter.initialize(computeState.device(), computeState.m_CLContext, options) == OperationStatus::OK);
+    auto secondStatus = std::async(std::launch::async, [&]() { return secondSorter.sortFile(input, secondOutput); });
+    REQUIRE(sorter.sortFile(input, output) == OperationStatus::OK);
+    REQUIRE(secondStatus.get() == OperationStatus::OK);
+    REQUIRE(std::filesystem::is_empty(runDirectory));
+
+    const auto& stats = sorter.getStatistics();
+    REQUIRE(stats.numKeys == numElements);
+    REQUIRE(stats.numRuns > 7U);
+    REQUIRE(stats.numMergePasses == 2U);
+
+    std::vector<int64_t> result(numElements);
+    {
+        std::ifstream file(output, std::ios::binary);
+        file.read(reinterpret_cast<char*>(result.data()), sizeof(int64_t) * numElements);
+        REQUIRE(file.gcount() == static_cast<std::streamsize>(sizeof(int64_t) * numElements));
+    }
+    auto expected = dataset.dataset;
+    std::ranges::sort(expected);
+    REQUIRE(result == expected);
+    {
+        std::ifstream file(secondOutput, std::ios::binary);
+        file.read(reinterpret_cast<char*>(result.data()), sizeof(int64_t) * numElements);
+    }
+    REQUIRE(result == expected);
+    secondSorter.release();
+
+    std::filesystem::remove(input);
+    std::filesystem::remove(output);
+    std::filesystem::remove(secondOutput);
+    std::filesystem::remove(runDirectory);
+    std::filesystem::remove(options.calibrationFile);
+}
+
+TEST_CASE( "Multi-device sort test", "[multidevice]" )
+{
+    ComputeState computeState;
+    REQUIRE(computeState.init());
+
+    // Split a device into sub-devices where supported (e.g. PoCL CPU),
+    // otherwise run two partitions on the same device
+    auto device = computeState.device();
+    std::vector<cl::Device> devices;
+    cl::Context context = computeState.m_CLContext;
+    if (device.getInfo<CL_DEVICE_PARTITION_MAX_SUB_DEVICES>() >= 4U) {
+        const auto unitsPerDevice = std::max(device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>() / 4U, 1U);
+        const cl_device_partition_property properties[] = {
+            CL_DEVICE_PARTITION_EQUALLY, static_cast<cl_device_partition_property>(unitsPerDevice), 0
+        };
+        device.createSubDevices(properties, &devices);
+        context = cl::Context(devices);
+    } else {
+        devices = {device, device};
+    }
+
+    constexpr size_t numElements = (1U << 20U) + 123U;
+    Random<int32_t> dataset(numElements);
+    auto expected = dataset.dataset;
+    std::ranges::sort(expected);
+
+    for (const auto scheme : {PartitionScheme::TOP_BITS, PartitionScheme::SPLITTERS}) {
+        MultiDeviceRadixSort<int32_t> sorter;
+        REQUIRE(sorter.initialize(context, devices, scheme) == OperationStatus::OK);
+        REQUIRE(sorter.numDevices() == devices.size());
+
+        auto keys = dataset.dataset;
+        REQUIRE(sorter.sort(keys) == OperationStatus::OK);
+        REQUIRE(keys == expected);
+
+        // uniform keys spread evenly over the devices
+        size_t numSorted = 0U;
+        for (const auto& partition : sorter.lastPartitions()) {
+            REQUIRE(partition.numKeys > numElements / devices.size() / 2U);
+            numSorted += partition.numKeys;
+        }
+        REQUIRE(numSorted == numElements);
+    }
+}
+
+TEST_CASE( "Mapped file test", "[mappedfile]" )
+{
+    const auto path = std::filesystem::temp_directory_path() / "radixsort_mapped.bin";
+    constexpr size_t numElements = 100000U;
+    Random<uint32_t> dataset(numElements);
+    auto expected = dataset.dataset;
+    std::ranges::sort(expected);
+
+    // Sort in the writable mapping, as the radixsort tool does
+    {
+        MappedFile file(path, sizeof(uint32_t) * numElements);
+        auto keys = file.as<uint32_t>();
+        REQUIRE(keys.size() == numElements);
+        std::ranges::copy(dataset.dataset, keys.begin());
+        RadixSortCPU<uint32_t>::sort(keys);
+        file.flush();
+    }
+    {
+        const MappedFile file(path, MappedFile::Access::READ_ONLY);
+        const auto keys = file.as<uint32_t>();
+        REQUIRE(std::ranges::equal(keys, expected));
+    }
+    std::filesystem::remove(path);
+}
+
+TEST_CASE( "Heterogeneous sort test", "[cosort]" )
+{
+    ComputeState computeState;
+    REQUIRE(computeState.init());
+
+    HeterogeneousRadixSort<int64_t> sorter;
+    REQUIRE(sorter.initialize(computeState.device(), computeState.m_CLContext, 0.5) == OperationStatus::OK);
+
+    constexpr size_t numElements = 1U << 20U;
+    for (uint32_t run = 0U; run < 3U; run++) {
+        Random<int64_t> dataset(numElements);
+        auto keys = dataset.dataset;
+        auto expected = keys;
+        std::ranges::sort(expected);
+        REQUIRE(sorter.sort(computeState.m_CLCommandQueue, keys) == OperationStatus::OK);
+        REQUIRE(keys == expected);
+    }
+
+    // every run splits the keys and adapts the share
+    const auto& records = sorter.records();
+    REQUIRE(records.size() == 3U);
+    for (const auto& record : records) {
+        REQUIRE(record.deviceKeys + record.hostKeys == numElements);
+        REQUIRE(record.deviceKeys > 0U);
+        REQUIRE(record.hostKeys > 0U);
+    }
+    REQUIRE(sorter.deviceShare() > 0.0);
+    REQUIRE(sorter.deviceShare() < 1.0);
+}
+
+TEST_CASE( "Device selection test", "[devices]" )
+{
+    std::vector<std::string> args{"--num-elements", "1024", "--device-type", "all", "--device", "auto", "--profiling"};
+    const auto selection = DeviceSelection::FromArguments(args);
+    REQUIRE((args == std::vector<std::string>{"--num-elements", "1024"}));
+    REQUIRE(selection.type == CL_DEVICE_TYPE_ALL);
+    REQUIRE(selection.automatic);
+    REQUIRE(selection.queueProperties == CL_QUEUE_PROFILING_ENABLE);
+
+    // Benchmarks every device of any type and keeps the fastest
+    ComputeState computeState;
+    REQUIRE(computeState.init(selection));
+    REQUIRE(computeState.m_CLDevices.size() == 1U);
+    REQUIRE(computeState.m_CLCommandQueue.getInfo<CL_QUEUE_PROPERTIES>() == CL_QUEUE_PROFILING_ENABLE);
+    REQUIRE(ComputeState::BenchmarkDevice(computeState.device()) < std::numeric_limits<double>::infinity());
+
+    std::vector<std::string> invalid{"--device", "7", "--device-type", "cpu"};
+    auto indexed = DeviceSelection::FromArguments(invalid);
+    REQUIRE(invalid.empty());
+    REQUIRE(indexed.deviceIndex == 7U);
+    indexed.type = CL_DEVICE_TYPE_ALL;
+    indexed.deviceIndex = 1000U;
+    ComputeState outOfRange;
+    REQUIRE_FALSE(outOfRange.init(indexed));
+}
+
+TEST_CASE( "Concurrent sort test", "[concurrent]" )
+{
+    ComputeState computeState;
+    REQUIRE(computeState.init());
+
+    constexpr size_t maxKeys = 100000U;
+    std::vector<std::vector<uint32_t>> inputs;
+    for (size_t i = 0U; i < 10U; i++) {
+        inputs.push_back(Random<uint32_t>(maxKeys - 997U * i).dataset);
+    }
+
+    for (const auto mode : {QueueMode::OUT_OF_ORDER, QueueMode::QUEUE_POOL}) {
+        ConcurrentRadixSort<uint32_t> sorter;
+        REQUIRE(sorter.initialize(computeState.device(), computeState.m_CLContext, maxKeys, 3U, mode) == OperationStatus::OK);
+        if (mode == QueueMode::QUEUE_POOL) {
+            REQUIRE(sorter.queueMode() == QueueMode::QUEUE_POOL);
+        }
+
+        // more inputs than instances reuses each instance several times
+        auto keys = inputs;
+        std::vector<std::span<uint32_t>> spans(keys.begin(), keys.end());
+        REQUIRE(sorter.sort(spans) == OperationStatus::OK);
+        for (size_t i = 0U; i < keys.size(); i++) {
+            auto expected = inputs[i];
+            std::ranges::sort(expected);
+            REQUIRE(keys[i] == expected);
+        }
+    }
+}
+
+TEST_CASE( "Recorded passes test", "[replay]" )
+{
+    ComputeState computeState;
+    REQUIRE(computeState.init());
+    auto queue = computeState.m_CLCommandQueue;
+
+    constexpr size_t capacity = 1U << 18U;
+    RadixSortGPU<int64_t> sorter;
+    sorter.setLocalSortThreshold(0U);
+    REQUIRE(sorter.initialize(computeState.device(), computeState.m_CLContext, capacity, HostSpans<int64_t>{}) == OperationStatus::OK);
+    cl::Buffer deviceKeys(computeState.m_CLContext, CL_MEM_READ_WRITE, sizeof(int64_t) * capacity);
+
+    // Repeated sizes replay their recording, a new size records another one
+    for (const size_t numElements : {capacity, size_t{100000U}, capacity, size_t{100000U}, size_t{12345U}}) {
+        Random<int64_t> dataset(numElements);
+        auto expected = dataset.dataset;
+        std::ranges::sort(expected);
+
+        std::vector<int64_t> keys(numElements);
+        queue.enqueueWriteBuffer(deviceKeys, CL_TRUE, 0, sizeof(int64_t) * numElements, dataset.dataset.data());
+        REQUIRE(sorter.sortBuffer(queue, deviceKeys, 0U, numElements) == OperationStatus::OK);
+        queue.enqueueReadBuffer(deviceKeys, CL_TRUE, 0, sizeof(int64_t) * numElements, keys.data());
+        REQUIRE(keys == expected);
+    }
+}
+
+TEST_CASE( "Runtime parameters test", "[config]" )
+{
+    // Checks against the algorithm alone
+    constexpr auto defaults = RadixSortConfig::Defaults<int32_t>();
+    REQUIRE(defaults == RadixSortConfig{});
+    REQUIRE(defaults.validate(32U, 1024U, 1U << 16U, sizeof(cl_uint)).empty());
+    REQUIRE_FALSE((RadixSortConfig{48U, 16U, 512U, 4U}.validate(32U, 1024U, 1U << 16U, sizeof(cl_uint)).empty()));
+    REQUIRE_FALSE((RadixSortConfig{64U, 16U, 512U, 5U}.validate(32U, 1024U, 1U << 16U, sizeof(cl_uint)).empty()));
+    REQUIRE_FALSE((RadixSortConfig{64U, 16U, 512U, 8U}.validate(32U, 1024U, 1U << 12U, sizeof(cl_uint)).empty()));
+
+    ComputeState computeState;
+    REQUIRE(computeState.init());
+    auto queue = computeState.m_CLCommandQueue;
+
+    // Parameters beyond the device limits are rejected
+    {
+        RadixSortGPU<uint32_t> sorter;
+        sorter.setConfig({1U << 20U, 16U, 512U, 4U});
+        REQUIRE(sorter.initialize(computeState.device(), computeState.m_CLContext, 1U << 16U, HostSpans<uint32_t>{}) != OperationStatus::OK);
+    }
+
+    const RadixSortConfig config{16U, 8U, 256U, 8U};
+    constexpr size_t numElements = 100000U;
+    Random<uint32_t> dataset(numElements);
+    auto expected = dataset.dataset;
+    std::ranges::sort(expected);
+
+    RadixSortGPU<uint32_t> sorter;
+    sorter.setConfig(config);
+    sorter.setLocalSortThreshold(0U);
+    const auto numRounded = sorter.Resize(numElements);
+    REQUIRE(numRounded % config.numItems() == 0U);
+    REQUIRE(sorter.initialize(computeState.device(), computeState.m_CLContext, numElements, HostSpans<uint32_t>{}) == OperationStatus::OK);
+    REQUIRE(sorter.config() == config);
+
+    cl::Buffer deviceKeys(computeState.m_CLContext, CL_MEM_READ_WRITE, sizeof(uint32_t) * numElements);
+    queue.enqueueWriteBuffer(deviceKeys, CL_TRUE, 0, sizeof(uint32_t) * numElements, dataset.dataset.data());
+    REQUIRE(sorter.sortBuffer(queue, deviceKeys, 0U, numElements) == OperationStatus::OK);
+    std::vector<uint32_t> keys(numElements);
+    queue.enqueueReadBuffer(deviceKeys, CL_TRUE, 0, sizeof(uint32_t) * numElements, keys.data());
+    REQUIRE(keys == expected);
+    sorter.release();
+}
+
+TEST_CASE( "Autotuner test", "[tuning]" )
+{
+    ComputeState computeState;
+    REQUIRE(computeState.init());
+    const auto device = computeState.device();
+
+    constexpr size_t numElements = 1U << 16U;
+    const std::vector<std::shared_ptr<Dataset<int32_t>>> datasets {
+        std::make_shared<Random<int32_t>>(numElements),
+        std::make_shared<InvertedRange<int32_t>>(numElements),
+    };
+    TuningCandidates candidates;
+    candidates.itemsPerGroup = {32U, 64U};
+    candidates.groups = {16U, 32U};
+    candidates.bitsPerRadix = {4U};
+    candidates.histoSplit = {512U};
+
+    RadixSortAutotuner<int32_t> tuner;
+    REQUIRE(tuner.tune(device, computeState.m_CLContext, datasets, candidates) == OperationStatus::OK);
+    REQUIRE(tuner.results().size() == 4U);
+    REQUIRE(std::ranges::all_of(tuner.results(), [&](const auto& result) { return result.time >= tuner.best().time; }));
+
+    // The profile keeps the best configuration per key type
+    const auto path = std::filesystem::temp_directory_path() / "radixsort_profile_test.json";
+    REQUIRE(tuner.save(device, path));
+    const auto profile = DeviceProfile::Load(path);
+    REQUIRE(profile);
+    REQUIRE(profile->device == device.getInfo<CL_DEVICE_NAME>());
+    REQUIRE(profile->find("int") == tuner.best().config);
+    REQUIRE_FALSE(profile->find("long"));
+    std::filesystem::remove(path);
+}
+
+TEST_CASE( "Range reduction test", "[range]" )
+{
+    ComputeState computeState;
+    REQUIRE(computeState.init());
+    auto queue = computeState.m_CLCommandQueue;
+
+    // Small IDs in 64-bit keys only need the passes over their 12 varying bits
+    constexpr size_t numElements = 100000U;
+    std::vector<uint64_t> ids(numElements);
+    std::mt19937_64 generator(42U);
+    std::ranges::generate(ids, [&]() { return 1000000U + generator() % 4096U; });
+
+    RadixSortGPU<uint64_t> sorter;
+    sorter.setLocalSortThreshold(0U);
+    // the narrow range would be counted instead
+    sorter.setCountingSort(false);
+    REQUIRE(sorter.initialize(computeState.device(), computeState.m_CLContext, numElements, HostSpans<uint64_t>{}) == OperationStatus::OK);
+    cl::Buffer deviceKeys(computeState.m_CLContext, CL_MEM_READ_WRITE, sizeof(uint64_t) * numElements);
+    const auto bitsPerRadix = sorter.config().bitsPerRadix;
+
+    const auto sortOnDevice = [&](const std::vector<uint64_t>& input) {
+        std::vector<uint64_t> keys(input.size());
+        queue.enqueueWriteBuffer(deviceKeys, CL_TRUE, 0, sizeof(uint64_t) * input.size(), input.data());
+        REQUIRE(sorter.sortBuffer(queue, deviceKeys, 0U, input.size()) == OperationStatus::OK);
+        queue.enqueueReadBuffer(deviceKeys, CL_TRUE, 0, sizeof(uint64_t) * input.size(), keys.data());
+        return keys;
+    };
+
+    auto expected = ids;
+    std::ranges::sort(expected);
+    REQUIRE(sortOnDevice(ids) == expected);
+    REQUIRE(sorter.numPasses() == (12U + bitsPerRadix - 1U) / bitsPerRadix);
+
+    // Keys that are all equal need no pass, padding does not widen the range
+    const std::vector<uint64_t> equal(12345U, 77U);
+    REQUIRE(sortOnDevice(equal) == equal);
+    REQUIRE(sorter.numPasses() == 0U);
+
+    sorter.setRangeReduction(false);
+    REQUIRE(sortOnDevice(ids) == expected);
+    REQUIRE(sorter.numPasses() == 64U / bitsPerRadix);
+    sorter.release();
+
+    // Signed keys around zero
+    std::vector<int32_t> signedKeys(numElements);
+    std::ranges::generate(signedKeys, [&]() { return static_cast<int32_t>(generator() % 2001U) - 1000; });
+    auto expectedSigned = signedKeys;
+    std::ranges::sort(expectedSigned);
+    std::span<int32_t> cpuKeys(signedKeys);
+    RadixSortCPU<int32_t>::sortParallel(cpuKeys);
+    REQUIRE(signedKeys == expectedSigned);
+}
+
+TEST_CASE( "Presortedness test", "[presorted]" )
+{
+    ComputeState computeState;
+    REQUIRE(computeState.init());
+    auto queue = computeState.m_CLCommandQueue;
+
+    constexpr size_t numElements = 100000U;
+    std::mt19937 generator(7U);
+    std::vector<int32_t> random(numElements);
+    std::ranges::generate(random, [&]() { return static_cast<int32_t>(generator()); });
+    // five sorted runs with duplicates across them
+    auto runs = random;
+    for (size_t run = 0U; run < 5U; run++) {
+        std::ranges::transform(
+            runs.begin() + run * numElements / 5U, runs.begin() + (run + 1U) * numElements / 5U,
+            runs.begin() + run * numElements / 5U, [](int32_t key) { return key % 1000; });
+        std::sort(runs.begin() + run * numElements / 5U, runs.begin() + (run + 1U) * numElements / 5U);
+    }
+    const std::vector<std::pair<std::vector<int32_t>, SortPath>> inputs {
+        {Range<int32_t>(numElements).dataset, SortPath::SORTED},
+        {InvertedRange<int32_t>(numElements).dataset, SortPath::REVERSED},
+        {runs, SortPath::RUN_MERGE},
+        {random, SortPath::RADIX},
+    };
+
+    constexpr auto maxRuns = AlgorithmParameters<int32_t>::_MAX_MERGE_RUNS;
+    REQUIRE(selectSortPath(measurePresortedness(std::span<const int32_t>(runs), maxRuns), maxRuns) == SortPath::RUN_MERGE);
+    REQUIRE(measurePresortedness(std::span<const int32_t>(runs), maxRuns).runs() == 5U);
+    REQUIRE(runOffsets(std::span<const int32_t>(runs)).size() == 6U);
+    // equal keys are ascending
+    REQUIRE(selectSortPath(measurePresortedness(std::span<const int32_t>(std::vector<int32_t>(100U, 3)), maxRuns), maxRuns) == SortPath::SORTED);
+
+    RadixSortGPU<int32_t> sorter;
+    sorter.setLocalSortThreshold(0U);
+    REQUIRE(sorter.initialize(computeState.device(), computeState.m_CLContext, numElements, HostSpans<int32_t>{}) == OperationStatus::OK);
+    cl::Buffer deviceKeys(computeState.m_CLContext, CL_MEM_READ_WRITE, sizeof(int32_t) * numElements);
+
+    for (const auto& [input, path] : inputs) {
+        auto expected = input;
+        std::ranges::sort(expected);
+
+        auto keys = input;
+        std::span<int32_t> cpuKeys(keys);
+        REQUIRE(RadixSortCPU<int32_t>::sortAdaptive(cpuKeys) == path);
+        REQUIRE(keys == expected);
+
+        queue.enqueueWriteBuffer(deviceKeys, CL_TRUE, 0, sizeof(int32_t) * input.size(), input.data());
+        REQUIRE(sorter.sortBuffer(queue, deviceKeys, 0U, input.size()) == OperationStatus::OK);
+        queue.enqueueReadBuffer(deviceKeys, CL_TRUE, 0, sizeof(int32_t) * input.size(), keys.data());
+        REQUIRE(sorter.getRuntimes().path == path);
+        REQUIRE(keys == expected);
+    }
+
+    // Without the check every input takes the passes
+    sorter.setPresortedDetection(false);
+    const auto& sorted = inputs.front().first;
+    queue.enqueueWriteBuffer(deviceKeys, CL_TRUE, 0, sizeof(int32_t) * sorted.size(), sorted.data());
+    REQUIRE(sorter.sortBuffer(queue, deviceKeys, 0U, sorted.size()) == OperationStatus::OK);
+    REQUIRE(sorter.getRuntimes().path == SortPath::RADIX);
+    sorter.release();
+}
+
+TEST_CASE( "Counting sort test", "[counting]" )
+{
+    ComputeState computeState;
+    REQUIRE(computeState.init());
+    auto queue = computeState.m_CLCommandQueue;
+
+    constexpr size_t numElements = 100000U;
+    std::mt19937 generator(11U);
+    std::vector<int32_t> statusCodes(numElements);
+    std::ranges::generate(statusCodes, [&]() { return static_cast<int32_t>(100U + generator() % 500U); });
+    // few distinct keys spread over the whole range
+    std::vector<int32_t> shards(numElements);
+    std::ranges::generate(shards, [&]() { return static_cast<int32_t>(static_cast<int64_t>(generator() % 64U) * 33554393 - 1073741824); });
+    std::vector<int32_t> random(numElements);
+    std::ranges::generate(random, [&]() { return static_cast<int32_t>(generator()); });
+
+    // Host
+    for (const auto& input : {Zeros<int32_t>(numElements).dataset, statusCodes, shards}) {
+        auto keys = input;
+        auto expected = input;
+        std::ranges::sort(expected);
+        REQUIRE(countingSort(std::span<int32_t>(keys)));
+        REQUIRE(keys == expected);
+    }
+    auto randomKeys = random;
+    REQUIRE_FALSE(countingSort(std::span<int32_t>(randomKeys)));
+    REQUIRE(randomKeys == random);
+
+    // Device
+    RadixSortGPU<int32_t> sorter;
+    sorter.setLocalSortThreshold(0U);
+    REQUIRE(sorter.initialize(computeState.device(), computeState.m_CLContext, numElements, HostSpans<int32_t>{}) == OperationStatus::OK);
+    cl::Buffer deviceKeys(computeState.m_CLContext, CL_MEM_READ_WRITE, sizeof(int32_t) * numElements);
+    const std::vector<std::pair<std::vector<int32_t>, SortPath>> inputs {
+        {statusCodes, SortPath::COUNTING},
+        {shards, SortPath::COUNTING},
+        {random, SortPath::RADIX},
+    };
+    for (const auto& [input, path] : inputs) {
+        auto expected = input;
+        std::ranges::sort(expected);
+        std::vector<int32_t> keys(input.size());
+        queue.enqueueWriteBuffer(deviceKeys, CL_TRUE, 0, sizeof(int32_t) * input.size(), input.data());
+        REQUIRE(sorter.sortBuffer(queue, deviceKeys, 0U, input.size()) == OperationStatus::OK);
+        queue.enqueueReadBuffer(deviceKeys, CL_TRUE, 0, sizeof(int32_t) * input.size(), keys.data());
+        REQUIRE(sorter.getRuntimes().path == path);
+        REQUIRE(keys == expected);
+    }
+    sorter.release();
+}
+
+TEST_CASE( "Sort strategy test", "[strategy]" )
+{
+    constexpr size_t numElements = 1U << 20U;
+    std::mt19937 generator(13U);
+    std::vector<int32_t> statusCodes(numElements);
+    std::ranges::generate(statusCodes, [&]() { return static_cast<int32_t>(100U + generator() % 500U); });
+    std::vector<int32_t> tiny(100U);
+    std::ranges::generate(tiny, [&]() { return static_cast<int32_t>(generator()); });
+
+    // Decisions of the default costs, without a device
+    SortStrategy<int32_t> strategy;
+    const std::vector<std::pair<std::vector<int32_t>, SortAlgorithm>> inputs {
+        {tiny, SortAlgorithm::COMPARISON},
+        {Range<int32_t>(numElements).dataset, SortAlgorithm::HOST_PRESORTED},
+        {InvertedRange<int32_t>(numElements).dataset, SortAlgorithm::HOST_PRESORTED},
+        {statusCodes, SortAlgorithm::HOST_COUNTING},
+        {Random<int32_t>(numElements).dataset, SortAlgorithm::HOST_LSD},
+    };
+    for (const auto& [input, algorithm] : inputs) {
+        const auto decision = strategy.decide(input);
+        REQUIRE(decision.algorithm == algorithm);
+        REQUIRE(decision.predictedTime > 0.0);
+        REQUIRE(decision.candidates.front().algorithm == algorithm);
+        REQUIRE(std::ranges::is_sorted(decision.candidates, {}, &StrategyCandidate::predictedTime));
+    }
+    const auto statistics = SortStrategy<int32_t>::analyze(statusCodes, 16U);
+    REQUIRE(statistics.countable);
+    REQUIRE(statistics.range < 500U);
+    REQUIRE(statistics.distinct <= 500U);
+    REQUIRE(statistics.entropy > 8.0);
+    REQUIRE(statistics.entropy <= std::log2(500.0));
+
+    // Every algorithm sorts every dataset, the device included
+    ComputeState computeState;
+    REQUIRE(computeState.init());
+    auto queue = computeState.m_CLCommandQueue;
+    REQUIRE(strategy.initialize(computeState.device(), computeState.m_CLContext) == OperationStatus::OK);
+    for (const auto& dataset : DatasetCreator<int32_t>(numElements)) {
+        auto expected = dataset->dataset;
+        std::ranges::sort(expected);
+        for (const auto& candidate : strategy.decide(dataset->dataset).candidates) {
+            auto keys = dataset->dataset;
+            REQUIRE(strategy.run(queue, candidate.algorithm, keys) == OperationStatus::OK);
+            REQUIRE(keys == expected);
+        }
+        auto keys = dataset->dataset;
+        REQUIRE(strategy.sort(queue, keys) == OperationStatus::OK);
+        REQUIRE(keys == expected);
+    }
+    REQUIRE(strategy.decisions().size() == 5U);
+    strategy.release();
+}
+
+TEST_CASE( "Top-k test", "[topk]" )
+{
+    constexpr size_t numElements = 100000U;
+    std::mt19937 generator(17U);
+    std::vector<int32_t> random(numElements);
+    std::ranges::generate(random, [&]() { return static_cast<int32_t>(generator()); });
+    // many keys equal to the k-th one
+    std::vector<int32_t> ties(numElements);
+    std::ranges::generate(ties, [&]() { return static_cast<int32_t>(generator() % 8U) - 4; });
+
+    // Host
+    for (const auto& input : {random, ties, Range<int32_t>(numElements).dataset}) {
+        auto sorted = input;
+        std::ranges::sort(sorted);
+        for (const size_t k : {size_t{1U}, size_t{100U}, numElements / 2U, numElements}) {
+            const auto smallest = topK(std::span<const int32_t>(input), k);
+            REQUIRE(std::ranges::equal(smallest, std::span<const int32_t>(sorted).first(k)));
+            const auto largest = topK(std::span<const int32_t>(input), k, true);
+            REQUIRE(std::ranges::equal(largest, std::span<const int32_t>(sorted).last(k) | std::views::reverse));
+
+            auto keys = input;
+            partialSort(std::span<int32_t>(keys), k);
+            REQUIRE(std::ranges::equal(std::span<const int32_t>(keys).first(k), std::span<const int32_t>(sorted).first(k)));
+            std::ranges::sort(keys);
+            REQUIRE(keys == sorted);
+        }
+        const auto median = radixSelect(std::span<const int32_t>(input), numElements / 2U);
+        REQUIRE(median.key == sorted[numElements / 2U]);
+        REQUIRE(median.below == static_cast<size_t>(std::ranges::lower_bound(sorted, median.key) - sorted.begin()));
+    }
+
+    // Device
+    ComputeState computeState;
+    REQUIRE(computeState.init());
+    auto queue = computeState.m_CLCommandQueue;
+    RadixSortGPU<int32_t> sorter;
+    REQUIRE(sorter.initialize(computeState.device(), computeState.m_CLContext, numElements, HostSpans<int32_t>{}) == OperationStatus::OK);
+    cl::Buffer deviceKeys(computeState.m_CLContext, CL_MEM_READ_WRITE, sizeof(int32_t) * numElements);
+    for (const auto& input : {random, ties}) {
+        auto sorted = input;
+        std::ranges::sort(sorted);
+        for (const bool largest : {false, true}) {
+            constexpr size_t k = 1000U;
+            std::vector<int32_t> keys(numElements);
+            queue.enqueueWriteBuffer(deviceKeys, CL_TRUE, 0, sizeof(int32_t) * numElements, input.data());
+            REQUIRE(sorter.partialSortBuffer(queue, deviceKeys, 0U, numElements, k, largest) == OperationStatus::OK);
+            queue.enqueueReadBuffer(deviceKeys, CL_TRUE, 0, sizeof(int32_t) * numElements, keys.data());
+            if (largest) {
+                REQUIRE(std::ranges::equal(std::span<const int32_t>(keys).first(k), std::span<const int32_t>(sorted).last(k) | std::views::reverse));
+            } else {
+                REQUIRE(std::ranges::equal(std::span<const int32_t>(keys).first(k), std::span<const int32_t>(sorted).first(k)));
+            }
+            // the other keys are kept
+            std::ranges::sort(keys);
+            REQUIRE(keys == sorted);
+        }
+    }
+    sorter.release();
+}
+
+TEST_CASE( "Radix select test", "[select]" )
+{
+    constexpr size_t numElements = 100000U;
+    std::mt19937_64 generator(19U);
+    std::vector<int64_t> random(numElements);
+    std::ranges::generate(random, [&]() { return static_cast<int64_t>(generator()); });
+    // latencies with a long tail
+    std::vector<int64_t> latencies(numElements);
+    std::ranges::generate(latencies, [&]() { return static_cast<int64_t>(1000U + generator() % 1000U) * (generator() % 100U == 0U ? 50 : 1); });
+    const std::vector<double> probabilities {0.0, 0.5, 0.9, 0.99, 0.999, 1.0};
+
+    ComputeState computeState;
+    REQUIRE(computeState.init());
+    auto queue = computeState.m_CLCommandQueue;
+    RadixSortGPU<int64_t> sorter;
+    REQUIRE(sorter.initialize(computeState.device(), computeState.m_CLContext, numElements, HostSpans<int64_t>{}) == OperationStatus::OK);
+    cl::Buffer deviceKeys(computeState.m_CLContext, CL_MEM_READ_WRITE, sizeof(int64_t) * numElements);
+
+    for (const auto& input : {random, latencies, InvertedRange<int64_t>(numElements).dataset}) {
+        auto sorted = input;
+        std::ranges::sort(sorted);
+        std::vector<int64_t> expected;
+        for (const auto p : probabilities) {
+            expected.push_back(sorted[quantileRank(p, numElements)]);
+        }
+
+        // Host
+        REQUIRE(quantiles(std::span<const int64_t>(input), std::span<const double>(probabilities)) == expected);
+        auto keys = input;
+        nthElement(std::span<int64_t>(keys), numElements / 2U);
+        REQUIRE(keys[numElements / 2U] == sorted[numElements / 2U]);
+        REQUIRE(std::ranges::all_of(std::span<const int64_t>(keys).first(numElements / 2U), [&](int64_t key) { return key <= sorted[numElements / 2U]; }));
+
+        // Device, the keys stay in place
+        queue.enqueueWriteBuffer(deviceKeys, CL_TRUE, 0, sizeof(int64_t) * numElements, input.data());
+        int64_t median = 0;
+        REQUIRE(sorter.selectBuffer(queue, deviceKeys, 0U, numElements, numElements / 2U, median) == OperationStatus::OK);
+        REQUIRE(median == sorted[numElements / 2U]);
+        std::vector<int64_t> deviceQuantiles;
+        REQUIRE(sorter.quantilesBuffer(queue, deviceKeys, 0U, numElements, probabilities, deviceQuantiles) == OperationStatus::OK);
+        REQUIRE(deviceQuantiles == expected);
+        queue.enqueueReadBuffer(deviceKeys, CL_TRUE, 0, sizeof(int64_t) * numElements, keys.data());
+        REQUIRE(keys == input);
+    }
+    sorter.release();
+}
+
+TEST_CASE( "Reduce by key test", "[reduce]" )
+{
+    // not a multiple of the number of work items, keys of few and of many values
+    constexpr size_t numElements = 100003U;
+    std::mt19937 generator(23U);
+    std::vector<int32_t> keys(numElements);
+    std::vector<int64_t> values(numElements);
+    std::ranges::generate(keys, [&]() { return static_cast<int32_t>(generator() % 1000U) - 500; });
+    // values beyond 32 bits whose sums do not overflow
+    std::ranges::generate(values, [&]() { return (static_cast<int64_t>(generator()) - 0x80000000LL) << 12; });
+    std::fill_n(keys.begin(), numElements / 4U, 7);
+
+    // reference by sorting indices by key
+    std::vector<size_t> order(numElements);
+    std::iota(order.begin(), order.end(), size_t{0U});
+    std::ranges::stable_sort(order, {}, [&](size_t i) { return keys[i]; });
+    const auto reference = [&]<typename V>(const std::vector<V>& vals) {
+        std::vector<KeyAggregate<int32_t, V>> expected;
+        for (const auto i : order) {
+            if (expected.empty() || expected.back().key != keys[i]) {
+                expected.push_back({keys[i], 0U, 0, vals[i], vals[i]});
+            }
+            auto& aggregate = expected.back();
+            aggregate.count++;
+            aggregate.sum += vals[i];
+            aggregate.min = std::min(aggregate.min, vals[i]);
+            aggregate.max = std::max(aggregate.max, vals[i]);
+        }
+        return expected;
+    };
+    const auto expected = reference(values);
+
+    // Host
+    REQUIRE(reduceByKey(std::span<const int32_t>(keys), std::span<const int64_t>(values)) == expected);
+    REQUIRE(reduceByKey(std::span<const int32_t>(keys), std::span<const int64_t>(values), 1U) == expected);
+
+    // Device, the sorted pairs stay on the device
+    ComputeState computeState;
+    REQUIRE(computeState.init());
+    auto queue = computeState.m_CLCommandQueue;
+    const auto& context = computeState.m_CLContext;
+    RadixSortGPU<int32_t> sorter;
+    REQUIRE(sorter.initialize(computeState.device(), context, numElements, HostSpans<int32_t>{}) == OperationStatus::OK);
+    cl::Buffer deviceKeys(context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, sizeof(int32_t) * numElements, keys.data());
+
+    // values of the key type and of a wider type
+    const auto reduceOnDevice = [&]<typename V>(std::vector<V> vals) {
+        cl::Buffer deviceValues(context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, sizeof(V) * numElements, vals.data());
+        const AggregateBuffers<int32_t, V> result {
+            cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(int32_t) * numElements),
+            cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(cl_uint) * numElements),
+            cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(int64_t) * numElements),
+            cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(V) * numElements),
+            cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(V) * numElements),
+        };
+        size_t numUnique = 0U;
+        REQUIRE(sorter.reduceByKeyBuffer(queue, deviceKeys, deviceValues, 0U, numElements, result, numUnique) == OperationStatus::OK);
+        const auto reduced = reference(vals);
+        REQUIRE(numUnique == reduced.size());
+
+        std::vector<int32_t> uniqueKeys(numUnique);
+        std::vector<cl_uint> counts(numUnique);
+        std::vector<int64_t> sums(numUnique);
+        std::vector<V> mins(numUnique);
+        std::vector<V> maxs(numUnique);
+        queue.enqueueReadBuffer(result.keys, CL_TRUE, 0, sizeof(int32_t) * numUnique, uniqueKeys.data());
+        queue.enqueueReadBuffer(result.counts, CL_TRUE, 0, sizeof(cl_uint) * numUnique, counts.data());
+        queue.enqueueReadBuffer(result.sums, CL_TRUE, 0, sizeof(int64_t) * numUnique, sums.data());
+        queue.enqueueReadBuffer(result.mins, CL_TRUE, 0, sizeof(V) * numUnique, mins.data());
+        queue.enqueueReadBuffer(result.maxs, CL_TRUE, 0, sizeof(V) * numUnique, maxs.data());
+        for (size_t i = 0U; i < numUnique; i++) {
+            REQUIRE((KeyAggregate<int32_t, V>{uniqueKeys[i], counts[i], sums[i], mins[i], maxs[i]} == reduced[i]));
+        }
+    };
+    std::vector<int32_t> narrowValues(numElements);
+    std::ranges::transform(values, narrowValues.begin(), [](int64_t value) { return static_cast<int32_t>(value >> 12); });
+    reduceOnDevice(narrowValues);
+    reduceOnDevice(values);
+
+    // the input keys are left unchanged
+    std::vector<int32_t> readBack(numElements);
+    queue.enqueueReadBuffer(deviceKeys, CL_TRUE, 0, sizeof(int32_t) * numElements, readBack.data());
+    REQUIRE(readBack == keys);
+    sorter.release();
+}
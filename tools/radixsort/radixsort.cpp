@@ -0,0 +1,475 @@
+/// @file radixsort.cpp
+/// @brief Sorts a raw binary file of native endian keys in place or into
+///        an output file. The file is memory mapped, keys are sorted
+///        directly in the mapping without copying them into a vector.
+///
+/// Usage:
+///   radixsort [--type int32|int64|uint32|uint64] [--backend cpu|cpu-mt|opencl|auto]
+///             [--output <file>] [-v] [device options] <input>
+///   radixsort --tune [--tune-keys <n>] [--type ...] [device options]
+///   radixsort --validate-strategy [--tune-keys <n>] [--type ...] [device options]
+///   radixsort --quantiles <p>[,<p>...] [--type ...] [--backend ...] [device options] <input>
+///
+/// Tuning benchmarks algorithm parameters on the device and stores the
+/// fastest in the device profile, which the device sort loads from then on.
+/// The auto backend samples the keys and selects a host or device algorithm,
+/// validation runs every applicable algorithm on the benchmark datasets and
+/// compares the predicted to the measured times. Quantiles are found by a
+/// radix select without sorting or modifying the file.
+///
+/// Device options are those of DeviceSelection, e.g. --device-type cpu or --device auto.
+
+#include "Common/ComputeState.h"
+#include "Common/CTimer.h"
+#include "Common/MappedFile.h"
+#include "CRadixSortCPU.h"
+#include "RadixSortGPU.h"
+#include "RadixSortAutotuner.h"
+#include "SortStrategy.h"
+#include "RadixSelect.h"
+#include "Dataset.h"
+
+#include <CL/Utils/Error.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace {
+
+struct ToolOptions
+{
+    std::filesystem::path input;
+    /// Sorted in place if empty
+    std::filesystem::path output;
+    std::string type{"uint32"};
+    std::string backend{"opencl"};
+    DeviceSelection device;
+    bool verbose{false};
+    bool help{false};
+    /// Tunes the device instead of sorting a file
+    bool tune{false};
+    /// Validates the sort strategy instead of sorting a file
+    bool validateStrategy{false};
+    /// Probabilities of the quantiles printed instead of sorting the file
+    std::vector<double> quantiles;
+    /// Size of the tuning and validation datasets
+    std::size_t tuneKeys{std::size_t{1U} << 22U};
+
+    explicit ToolOptions(std::vector<std::string> args)
+        : device(DeviceSelection::FromArguments(args))
+    {
+        for (std::size_t i = 0; i < args.size(); i++) {
+            const auto& arg = args[i];
+            const auto hasValue = i + 1 < args.size();
+            if (arg == "--type" && hasValue) {
+                type = args[++i];
+            } else if (arg == "--backend" && hasValue) {
+                backend = args[++i];
+            } else if ((arg == "-o" || arg == "--output") && hasValue) {
+                output = args[++i];
+            } else if (arg == "-v" || arg == "--verbose") {
+                verbose = true;
+            } else if (arg == "-h" || arg == "--help") {
+                help = true;
+            } else if (arg == "--tune") {
+                tune = true;
+            } else if (arg == "--validate-strategy") {
+                validateStrategy = true;
+            } else if (arg == "--quantiles" && hasValue) {
+                std::istringstream list(args[++i]);
+                std::string p;
+                while (std::getline(list, p, ',')) {
+                    quantiles.push_back(std::stod(p));
+                }
+            } else if (arg == "--tune-keys" && hasValue) {
+                tuneKeys = std::stoull(args[++i]);
+            } else {
+                input = arg;
+            }
+        }
+    }
+};
+
+/// Wall clock times of the phases in ms
+struct Timings
+{
+    /// Device setup and program build, not part of the total
+    double setup{0.0};
+    /// Mapping, copying to the output file and write back
+    double io{0.0};
+    /// Host to device and device to host copies
+    double transfer{0.0};
+    double compute{0.0};
+};
+
+void PrintUsage()
+{
+    std::cout << "Usage: radixsort [--type int32|int64|uint32|uint64] [--backend cpu|cpu-mt|opencl|auto]\n"
+              << "                 [--output <file>] [-v] <input>\n"
+              << "       radixsort --tune [--tune-keys <n>] [--type ...]\n"
+              << "       radixsort --validate-strategy [--tune-keys <n>] [--type ...]\n"
+              << "       radixsort --quantiles <p>[,<p>...] [--type ...] [--backend ...] <input>\n"
+              << "Device options: --device-type gpu|cpu|accelerator|all --platform <index|name>\n"
+              << "                --device <index|auto>\n"
+              << "Sorts a raw binary file of native endian keys, in place unless an output is given.\n"
+              << "--tune stores the fastest algorithm parameters of the device in its profile.\n"
+              << "--validate-strategy compares predicted and measured times of all algorithms.\n"
+              << "--quantiles prints quantiles of the keys, e.g. 0.5,0.99, without sorting them.\n";
+}
+
+/// Sorts keys of the mapping on the device, they pass through a device buffer
+template <typename DataType>
+bool SortOnDevice(std::span<DataType> keys, const DeviceSelection& selection, Timings& timings, bool verbose)
+{
+    CTimer timer;
+    timer.Start();
+    ComputeState computeState;
+    if (!computeState.init(selection)) {
+        return false;
+    }
+    auto queue = computeState.m_CLCommandQueue;
+    RadixSortGPU<DataType> sorter;
+    if (sorter.initialize(computeState.device(), computeState.m_CLContext, keys.size(), HostSpans<DataType>{}) != OperationStatus::OK) {
+        std::cerr << "Failed to initialize the device sort\n";
+        return false;
+    }
+    const auto sizeBytes = sizeof(DataType) * keys.size();
+    cl::Buffer deviceKeys(computeState.m_CLContext, CL_MEM_READ_WRITE, sizeBytes);
+    timer.Stop();
+    timings.setup += timer.GetElapsedMilliseconds();
+    if (verbose) {
+        std::cout << "Device: " << computeState.device().getInfo<CL_DEVICE_NAME>() << "\n";
+    }
+
+    timer.Start();
+    queue.enqueueWriteBuffer(deviceKeys, CL_TRUE, 0, sizeBytes, keys.data());
+    timer.Stop();
+    timings.transfer += timer.GetElapsedMilliseconds();
+
+    timer.Start();
+    const auto status = sorter.sortBuffer(queue, deviceKeys, 0U, keys.size());
+    timer.Stop();
+    timings.compute += timer.GetElapsedMilliseconds();
+    if (status != OperationStatus::OK) {
+        std::cerr << "Sorting on the device failed\n";
+        return false;
+    }
+
+    timer.Start();
+    queue.enqueueReadBuffer(deviceKeys, CL_TRUE, 0, sizeBytes, keys.data());
+    timer.Stop();
+    timings.transfer += timer.GetElapsedMilliseconds();
+    sorter.release();
+    return true;
+}
+
+/// Tunes the device for a key type on the standard datasets
+template <typename DataType>
+int Tune(const ToolOptions& options)
+{
+    ComputeState computeState;
+    if (!computeState.init(options.device)) {
+        return EXIT_FAILURE;
+    }
+    const auto device = computeState.device();
+    const std::vector<std::shared_ptr<Dataset<DataType>>> datasets {
+        std::make_shared<Random<DataType>>(options.tuneKeys),
+        std::make_shared<RandomDistributed<DataType>>(options.tuneKeys),
+        std::make_shared<Range<DataType>>(options.tuneKeys),
+        std::make_shared<InvertedRange<DataType>>(options.tuneKeys),
+    };
+
+    RadixSortAutotuner<DataType> tuner;
+    if (tuner.tune(device, computeState.m_CLContext, datasets) != OperationStatus::OK) {
+        std::cerr << "No configuration could be run on " << device.getInfo<CL_DEVICE_NAME>() << "\n";
+        return EXIT_FAILURE;
+    }
+    if (options.verbose) {
+        for (const auto& [config, time] : tuner.results()) {
+            std::cout << std::setw(4) << config.itemsPerGroup << " items x " << std::setw(4) << config.groups
+                      << " groups, " << config.bitsPerRadix << " bits, " << std::setw(4) << config.histoSplit
+                      << " splits: " << time << " ms\n";
+        }
+    }
+
+    const auto path = DeviceProfile::PathFor(device);
+    const auto& [best, time] = tuner.best();
+    std::cout << "Fastest on " << device.getInfo<CL_DEVICE_NAME>() << ": " << best.itemsPerGroup << " items x "
+              << best.groups << " groups, " << best.bitsPerRadix << " bits, " << best.histoSplit << " splits, "
+              << time << " ms per " << options.tuneKeys << " " << options.type << " keys\n";
+    if (!tuner.save(device, path)) {
+        std::cerr << "Failed to write " << path << "\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << "Profile written to " << path << std::endl;
+    return EXIT_SUCCESS;
+}
+
+/// Sorts keys of the mapping with the algorithm the strategy selects,
+/// host algorithms only if no device is available
+template <typename DataType>
+bool SortWithStrategy(std::span<DataType> keys, const DeviceSelection& selection, Timings& timings, bool verbose)
+{
+    CTimer timer;
+    timer.Start();
+    ComputeState computeState;
+    SortStrategy<DataType> strategy;
+    cl::CommandQueue queue;
+    if (computeState.init(selection)) {
+        queue = computeState.m_CLCommandQueue;
+        if (strategy.initialize(computeState.device(), computeState.m_CLContext) != OperationStatus::OK) {
+            std::cerr << "Failed to initialize the device sort, sorting on the host\n";
+        }
+    }
+    timer.Stop();
+    timings.setup += timer.GetElapsedMilliseconds();
+
+    timer.Start();
+    const auto status = strategy.sort(queue, keys);
+    timer.Stop();
+    timings.compute += timer.GetElapsedMilliseconds();
+    if (status != OperationStatus::OK) {
+        std::cerr << "Sorting with the selected algorithm failed\n";
+        return false;
+    }
+    if (verbose) {
+        const auto& decision = strategy.decisions().back();
+        for (const auto& candidate : decision.candidates) {
+            std::cout << (candidate.algorithm == decision.algorithm ? "* " : "  ") << std::setw(16)
+                      << toString(candidate.algorithm) << ": " << candidate.predictedTime << " ms predicted\n";
+        }
+    }
+    return true;
+}
+
+/// Runs every applicable algorithm on the standard datasets and
+/// reports the predicted and measured times
+template <typename DataType>
+int ValidateStrategy(const ToolOptions& options)
+{
+    ComputeState computeState;
+    if (!computeState.init(options.device)) {
+        return EXIT_FAILURE;
+    }
+    auto queue = computeState.m_CLCommandQueue;
+    SortStrategy<DataType> strategy;
+    if (strategy.initialize(computeState.device(), computeState.m_CLContext) != OperationStatus::OK
+        || strategy.calibrate(queue) != OperationStatus::OK) {
+        std::cerr << "Failed to calibrate the sort strategy\n";
+        return EXIT_FAILURE;
+    }
+    const std::vector<std::shared_ptr<Dataset<DataType>>> datasets {
+        std::make_shared<Zeros<DataType>>(options.tuneKeys),
+        std::make_shared<RandomDistributed<DataType>>(options.tuneKeys),
+        std::make_shared<Random<DataType>>(options.tuneKeys),
+        std::make_shared<Range<DataType>>(options.tuneKeys),
+        std::make_shared<InvertedRange<DataType>>(options.tuneKeys),
+    };
+
+    std::size_t hits = 0U;
+    for (const auto& dataset : datasets) {
+        const auto decision = strategy.decide(dataset->dataset);
+        std::cout << dataset->name() << ": entropy " << decision.statistics.entropy << " bits, range "
+                  << decision.statistics.range << ", sortedness " << decision.statistics.sortedness << "\n";
+
+        auto fastest = decision.algorithm;
+        auto fastestTime = std::numeric_limits<double>::max();
+        for (const auto& candidate : decision.candidates) {
+            auto keys = dataset->dataset;
+            CTimer timer;
+            timer.Start();
+            const auto status = strategy.run(queue, candidate.algorithm, keys);
+            timer.Stop();
+            if (status != OperationStatus::OK || !std::ranges::is_sorted(keys)) {
+                std::cerr << toString(candidate.algorithm) << " failed on " << dataset->name() << "\n";
+                return EXIT_FAILURE;
+            }
+            const auto time = timer.GetElapsedMilliseconds();
+            if (time < fastestTime) {
+                fastest = candidate.algorithm;
+                fastestTime = time;
+            }
+            std::cout << (candidate.algorithm == decision.algorithm ? "* " : "  ") << std::setw(16)
+                      << toString(candidate.algorithm) << ": " << std::setw(10) << candidate.predictedTime
+                      << " ms predicted, " << std::setw(10) << time << " ms measured\n";
+        }
+        hits += static_cast<std::size_t>(fastest == decision.algorithm);
+    }
+    std::cout << "Selected the fastest algorithm on " << hits << " of " << datasets.size()
+              << " datasets of " << options.tuneKeys << " " << options.type << " keys" << std::endl;
+    return EXIT_SUCCESS;
+}
+
+/// Prints quantiles of the keys of a file, the file is only read
+template <typename DataType>
+int PrintQuantiles(const ToolOptions& options)
+{
+    const MappedFile file(options.input, MappedFile::Access::READ_ONLY);
+    file.prefetch();
+    const auto keys = file.as<DataType>();
+    if (keys.empty()) {
+        std::cerr << options.input << " holds no keys\n";
+        return EXIT_FAILURE;
+    }
+
+    CTimer timer;
+    timer.Start();
+    std::vector<DataType> result;
+    if (options.backend == "cpu" || options.backend == "cpu-mt") {
+        result = quantiles(keys, std::span<const double>(options.quantiles), options.backend == "cpu" ? 1U : 0U);
+    } else if (options.backend == "opencl") {
+        ComputeState computeState;
+        if (!computeState.init(options.device)) {
+            return EXIT_FAILURE;
+        }
+        auto queue = computeState.m_CLCommandQueue;
+        RadixSortGPU<DataType> sorter;
+        sorter.setLocalSortThreshold(0U);
+        if (sorter.initialize(computeState.device(), computeState.m_CLContext, keys.size(), HostSpans<DataType>{}) != OperationStatus::OK) {
+            std::cerr << "Failed to initialize the device sort\n";
+            return EXIT_FAILURE;
+        }
+        const auto sizeBytes = sizeof(DataType) * keys.size();
+        cl::Buffer deviceKeys(computeState.m_CLContext, CL_MEM_READ_ONLY, sizeBytes);
+        queue.enqueueWriteBuffer(deviceKeys, CL_TRUE, 0, sizeBytes, keys.data());
+        if (sorter.quantilesBuffer(queue, deviceKeys, 0U, keys.size(), options.quantiles, result) != OperationStatus::OK) {
+            std::cerr << "Selecting on the device failed\n";
+            return EXIT_FAILURE;
+        }
+    } else {
+        std::cerr << "Unknown backend " << options.backend << "\n";
+        return EXIT_FAILURE;
+    }
+    timer.Stop();
+
+    for (std::size_t i = 0U; i < result.size(); i++) {
+        std::cout << "  p" << options.quantiles[i] << ": " << +result[i] << "\n";
+    }
+    std::cout << "Selected " << result.size() << " quantiles of " << keys.size() << " " << options.type
+              << " keys on " << options.backend << " in " << timer.GetElapsedMilliseconds() << " ms" << std::endl;
+    return EXIT_SUCCESS;
+}
+
+template <typename DataType>
+int Run(const ToolOptions& options)
+{
+    if (options.tune) {
+        return Tune<DataType>(options);
+    }
+    if (options.validateStrategy) {
+        return ValidateStrategy<DataType>(options);
+    }
+    if (!options.quantiles.empty()) {
+        return PrintQuantiles<DataType>(options);
+    }
+
+    Timings timings;
+    CTimer timer;
+
+    // The sort works on the mapping of the output, which is either the
+    // input itself or a copy of it
+    timer.Start();
+    MappedFile file = [&]() {
+        if (options.output.empty()) {
+            return MappedFile(options.input, MappedFile::Access::READ_WRITE);
+        }
+        const MappedFile input(options.input, MappedFile::Access::READ_ONLY);
+        input.prefetch();
+        MappedFile output(options.output, input.size());
+        if (input.size()) {
+            std::memcpy(output.data(), input.data(), input.size());
+        }
+        return output;
+    }();
+    file.prefetch();
+    timer.Stop();
+    timings.io += timer.GetElapsedMilliseconds();
+
+    if (file.size() % sizeof(DataType) != 0U) {
+        std::cerr << options.input << " is not a file of " << sizeof(DataType) << " byte keys\n";
+        return EXIT_FAILURE;
+    }
+    auto keys = file.as<DataType>();
+
+    if (!keys.empty()) {
+        if (options.backend == "cpu") {
+            timer.Start();
+            RadixSortCPU<DataType>::sort(keys);
+            timer.Stop();
+            timings.compute += timer.GetElapsedMilliseconds();
+        } else if (options.backend == "cpu-mt") {
+            timer.Start();
+            RadixSortCPU<DataType>::sortParallel(keys);
+            timer.Stop();
+            timings.compute += timer.GetElapsedMilliseconds();
+        } else if (options.backend == "opencl") {
+            if (!SortOnDevice(keys, options.device, timings, options.verbose)) {
+                return EXIT_FAILURE;
+            }
+        } else if (options.backend == "auto") {
+            if (!SortWithStrategy(keys, options.device, timings, options.verbose)) {
+                return EXIT_FAILURE;
+            }
+        } else {
+            std::cerr << "Unknown backend " << options.backend << "\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    timer.Start();
+    file.flush();
+    timer.Stop();
+    timings.io += timer.GetElapsedMilliseconds();
+
+    const auto total = timings.io + timings.transfer + timings.compute;
+    const auto throughput = [&](double ms) { return ms > 0.0 ? 1.0e-6 * static_cast<double>(keys.size()) / ms : 0.0; };
+    std::cout << "Sorted " << keys.size() << " " << options.type << " keys on " << options.backend << "\n"
+              << "  setup:    " << std::setw(10) << timings.setup << " ms\n"
+              << "  I/O:      " << std::setw(10) << timings.io << " ms\n"
+              << "  transfer: " << std::setw(10) << timings.transfer << " ms\n"
+              << "  compute:  " << std::setw(10) << timings.compute << " ms, throughput: " << throughput(timings.compute) << " Gelem/s\n"
+              << " -----------------------------------------------\n"
+              << "  total:    " << std::setw(10) << total << " ms, throughput: " << throughput(total) << " Gelem/s" << std::endl;
+    return EXIT_SUCCESS;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    const ToolOptions options({argv + 1, argv + argc});
+    if (options.help || (options.input.empty() && !options.tune && !options.validateStrategy)) {
+        PrintUsage();
+        return options.help ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    try {
+        if (options.type == "int32") {
+            return Run<int32_t>(options);
+        } else if (options.type == "int64") {
+            return Run<int64_t>(options);
+        } else if (options.type == "uint32") {
+            return Run<uint32_t>(options);
+        } else if (options.type == "uint64") {
+            return Run<uint64_t>(options);
+        }
+        std::cerr << "Unknown key type " << options.type << "\n";
+    } catch (const cl::util::Error& e) {
+        std::cerr << "OpenCL error: " << e.what() << "\n";
+    } catch (const cl::Error& e) {
+        std::cerr << "OpenCL error: " << e.what() << " (" << e.err() << ")\n";
+    } catch (const std::system_error& e) {
+        std::cerr << e.what() << "\n";
+    }
+    return EXIT_FAILURE;
+}